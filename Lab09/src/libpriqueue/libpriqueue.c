@@ -0,0 +1,1203 @@
+/** @file libpriqueue.c
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "libpriqueue.h"
+
+/* Pairing heap nodes are allocated this many at a time and recycled through a free list. */
+#define NODE_CHUNK_SIZE 256
+
+typedef struct _node_chunk_t
+{
+  struct _node_chunk_t *next;
+  priqueue_node_t nodes[NODE_CHUNK_SIZE];
+} node_chunk_t;
+
+
+/**
+  Decides which of two entries leaves the queue first.
+
+  The queue used to be a sorted array where a new element was moved forward only while the
+  element in front of it compared greater. That order is reproduced here for any comparer, even
+  the constant FCFScompare: of two entries, the older one goes first unless the comparer ranks the
+  newer one strictly ahead of it.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param a the first entry
+  @param b the second entry
+  @return nonzero if a must leave the queue before b
+ */
+static int precedes(priqueue_t *q, const priqueue_entry_t *a, const priqueue_entry_t *b)
+{
+  if( a->seq < b->seq )
+  {
+    return q->comparer(a->data, b->data) <= 0;
+  }
+  return q->comparer(b->data, a->data) > 0;
+}
+
+
+/**
+  Makes room for one more entry in a growable array, doubling its capacity when it is full.
+
+  @param heap the array
+ */
+static void heap_reserve(priqueue_heap_t *heap)
+{
+  if( heap->size == heap->capacity )
+  {
+    heap->capacity = heap->capacity ? 2 * heap->capacity : 2;
+    heap->entries = realloc(heap->entries, heap->capacity * sizeof(priqueue_entry_t));
+  }
+}
+
+
+/**
+  Takes a free handle, growing the slot array when none is left.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param seq the sequence number of the entry the handle is for
+  @return the handle
+ */
+static priqueue_handle_t alloc_handle(priqueue_t *q, unsigned long long seq)
+{
+  if( q->free_handle < 0 )
+  {
+    unsigned int old_capacity = q->slots_capacity;
+    q->slots_capacity = old_capacity ? 2 * old_capacity : 2;
+    q->slots = realloc(q->slots, q->slots_capacity * sizeof(priqueue_slot_t));
+    /* Chaining the new slots into the free list, lowest handle first. */
+    for( unsigned int i = q->slots_capacity; i > old_capacity; i-- )
+    {
+      q->slots[i - 1].index = q->free_handle;
+      q->slots[i - 1].live = 0;
+      q->free_handle = i - 1;
+    }
+  }
+  priqueue_handle_t handle = q->free_handle;
+  q->free_handle = q->slots[handle].index;
+  q->slots[handle].live = 1;
+  q->slots[handle].seq = seq;
+  return handle;
+}
+
+
+/**
+  Returns the handle of an entry that left the queue to the free list.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param handle the handle
+ */
+static void free_handle(priqueue_t *q, priqueue_handle_t handle)
+{
+  q->slots[handle].live = 0;
+  q->slots[handle].index = q->free_handle;
+  q->free_handle = handle;
+}
+
+
+/**
+  Stores an entry at a position of a heap and, when the heap belongs to the queue, records the
+  position in the slot of the entry's handle.
+
+  @param slots the handle slots of the queue, or NULL for a scratch copy
+  @param heap the entries
+  @param index the position
+  @param entry the entry
+ */
+static inline void place(priqueue_slot_t *slots, priqueue_entry_t *heap, unsigned int index, priqueue_entry_t entry)
+{
+  heap[index] = entry;
+  if( slots != NULL )
+  {
+    slots[entry.handle].index = index;
+  }
+}
+
+
+/**
+  Moves the entry at index up a d-ary heap until its parent precedes it.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param slots the handle slots to update, or NULL
+  @param heap the entries
+  @param arity the number of children of a node
+  @param index position of the entry to move
+  @return the final position of the entry
+ */
+static unsigned int sift_up(priqueue_t *q, priqueue_slot_t *slots, priqueue_entry_t *heap, unsigned int arity, unsigned int index)
+{
+  priqueue_entry_t moving = heap[index];
+  while( index > 0 )
+  {
+    unsigned int parent = (index - 1) / arity;
+    if( !precedes(q, &moving, &heap[parent]) )
+    {
+      break;
+    }
+    place(slots, heap, index, heap[parent]);
+    index = parent;
+  }
+  place(slots, heap, index, moving);
+  return index;
+}
+
+
+/**
+  Returns the child of a node that goes first, or 0 if the node is a leaf.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param heap the entries
+  @param size the number of entries in the heap
+  @param arity the number of children of a node
+  @param index position of the node
+  @return the position of the child
+ */
+static unsigned int first_child(priqueue_t *q, priqueue_entry_t *heap, unsigned int size, unsigned int arity, unsigned int index)
+{
+  unsigned int child = arity * index + 1;
+  if( child >= size )
+  {
+    return 0;
+  }
+  unsigned int last = size - child > arity ? child + arity : size;
+  unsigned int best = child;
+  for( child++; child < last; child++ )
+  {
+    if( precedes(q, &heap[child], &heap[best]) )
+    {
+      best = child;
+    }
+  }
+  return best;
+}
+
+
+/**
+  Moves the entry at index down a d-ary heap until it precedes all of its children.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param slots the handle slots to update, or NULL
+  @param heap the entries
+  @param size the number of entries in the heap
+  @param arity the number of children of a node
+  @param index position of the entry to move
+  @return the final position of the entry
+ */
+static unsigned int sift_down(priqueue_t *q, priqueue_slot_t *slots, priqueue_entry_t *heap, unsigned int size, unsigned int arity, unsigned int index)
+{
+  priqueue_entry_t moving = heap[index];
+  unsigned int child;
+  while( (child = first_child(q, heap, size, arity, index)) != 0 && precedes(q, &heap[child], &moving) )
+  {
+    place(slots, heap, index, heap[child]);
+    index = child;
+  }
+  place(slots, heap, index, moving);
+  return index;
+}
+
+
+/**
+  Restores the heap order of a whole array bottom-up, in O(n).
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param slots the handle slots to update, or NULL
+  @param heap the entries
+  @param size the number of entries in the heap
+  @param arity the number of children of a node
+ */
+static void heapify(priqueue_t *q, priqueue_slot_t *slots, priqueue_entry_t *heap, unsigned int size, unsigned int arity)
+{
+  if( size < 2 )
+  {
+    return;
+  }
+  for( unsigned int i = (size - 2) / arity + 1; i > 0; i-- )
+  {
+    sift_down(q, slots, heap, size, arity, i - 1);
+  }
+}
+
+
+/**
+  Adds an entry to a d-ary heap.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param heap the heap
+  @param arity the number of children of a node
+  @param entry the entry
+  @return the position of the entry in the heap
+ */
+static unsigned int heap_push(priqueue_t *q, priqueue_heap_t *heap, unsigned int arity, priqueue_entry_t entry)
+{
+  heap_reserve(heap);
+  heap->entries[heap->size++] = entry;
+  return sift_up(q, q->slots, heap->entries, arity, heap->size - 1);
+}
+
+
+/**
+  Removes the entry at a position of a d-ary heap. The hole it leaves is first moved down to a
+  leaf, always promoting the child that goes first, and the last entry of the heap is then placed
+  in the hole and moved up. The last entry usually belongs near the bottom, so this takes about
+  half the comparisons of moving it down from the top.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param heap the heap
+  @param arity the number of children of a node
+  @param index position of the entry to remove
+  @return the removed entry
+ */
+static priqueue_entry_t heap_remove(priqueue_t *q, priqueue_heap_t *heap, unsigned int arity, unsigned int index)
+{
+  priqueue_entry_t *entries = heap->entries;
+  priqueue_entry_t removed = entries[index];
+  unsigned int size = --heap->size;
+  if( index == size )
+  {
+    return removed;
+  }
+
+  unsigned int child;
+  while( (child = first_child(q, entries, size, arity, index)) != 0 )
+  {
+    place(q->slots, entries, index, entries[child]);
+    index = child;
+  }
+  place(q->slots, entries, index, entries[size]);
+  sift_up(q, q->slots, entries, arity, index);
+  return removed;
+}
+
+
+/**
+  Melds two pairing heaps: the root that goes second becomes the first child of the other root.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param a the first heap, or NULL
+  @param b the second heap, or NULL
+  @return the root of the melded heap
+ */
+static priqueue_node_t *pairing_meld(priqueue_t *q, priqueue_node_t *a, priqueue_node_t *b)
+{
+  if( a == NULL )
+  {
+    return b;
+  }
+  if( b == NULL )
+  {
+    return a;
+  }
+  if( precedes(q, &b->entry, &a->entry) )
+  {
+    priqueue_node_t *swap = a;
+    a = b;
+    b = swap;
+  }
+  b->sibling = a->child;
+  if( a->child != NULL )
+  {
+    a->child->prev = b;
+  }
+  b->prev = a;
+  a->child = b;
+  return a;
+}
+
+
+/**
+  Combines the children of a removed pairing heap root with the standard two passes: melding
+  them in pairs from left to right, then melding the pairs into one heap from right to left.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param first the first child
+  @return the root of the combined heap
+ */
+static priqueue_node_t *pairing_merge_pairs(priqueue_t *q, priqueue_node_t *first)
+{
+  /* The melded pairs are chained through their sibling links, last pair first. */
+  priqueue_node_t *pairs = NULL;
+  while( first != NULL )
+  {
+    priqueue_node_t *a = first;
+    priqueue_node_t *b = a->sibling;
+    first = b != NULL ? b->sibling : NULL;
+    a->sibling = NULL;
+    if( b != NULL )
+    {
+      b->sibling = NULL;
+    }
+    priqueue_node_t *pair = pairing_meld(q, a, b);
+    pair->sibling = pairs;
+    pairs = pair;
+  }
+
+  priqueue_node_t *root = NULL;
+  while( pairs != NULL )
+  {
+    priqueue_node_t *next = pairs->sibling;
+    pairs->sibling = NULL;
+    root = pairing_meld(q, pairs, root);
+    pairs = next;
+  }
+  if( root != NULL )
+  {
+    root->prev = NULL;
+  }
+  return root;
+}
+
+
+/**
+  Unlinks a node, with its subtree, from the pairing heap. The node must not be the root.
+
+  @param node the node
+ */
+static void pairing_detach(priqueue_node_t *node)
+{
+  if( node->prev->child == node )
+  {
+    node->prev->child = node->sibling;
+  }
+  else
+  {
+    node->prev->sibling = node->sibling;
+  }
+  if( node->sibling != NULL )
+  {
+    node->sibling->prev = node->prev;
+  }
+  node->sibling = NULL;
+  node->prev = NULL;
+}
+
+
+/**
+  Removes any node from the pairing heap, in amortized O(log n): the node is unlinked, and its
+  children are combined into one heap that is melded back under the root.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param node the node
+ */
+static void pairing_remove(priqueue_t *q, priqueue_node_t *node)
+{
+  priqueue_node_t *children = pairing_merge_pairs(q, node->child);
+  node->child = NULL;
+  if( node == q->root )
+  {
+    q->root = children;
+  }
+  else
+  {
+    pairing_detach(node);
+    q->root = pairing_meld(q, q->root, children);
+  }
+}
+
+
+/**
+  Takes a pairing heap node from the free list, allocating a new chunk of nodes when it is empty.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @return the node
+ */
+static priqueue_node_t *node_alloc(priqueue_t *q)
+{
+  if( q->free_nodes == NULL )
+  {
+    node_chunk_t *chunk = malloc(sizeof(node_chunk_t));
+    chunk->next = q->node_chunks;
+    q->node_chunks = chunk;
+    for( int i = NODE_CHUNK_SIZE - 1; i >= 0; i-- )
+    {
+      chunk->nodes[i].sibling = q->free_nodes;
+      q->free_nodes = &chunk->nodes[i];
+    }
+  }
+  priqueue_node_t *node = q->free_nodes;
+  q->free_nodes = node->sibling;
+  node->child = NULL;
+  node->sibling = NULL;
+  node->prev = NULL;
+  return node;
+}
+
+
+/**
+  Returns a pairing heap node to the free list.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param node the node
+ */
+static void node_free(priqueue_t *q, priqueue_node_t *node)
+{
+  node->sibling = q->free_nodes;
+  q->free_nodes = node;
+}
+
+
+/**
+  Maps an element to its bucket. Keys outside the bucket range are clamped to the first or the
+  last bucket, which keeps the buckets in key order; entries that share a bucket are ordered by
+  the heap of that bucket.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param data the element
+  @return the bucket index
+ */
+static unsigned int bucket_of(priqueue_t *q, const void *data)
+{
+  int key = q->key(data);
+  if( key < 0 )
+  {
+    return 0;
+  }
+  return key < PRIQUEUE_BUCKET_COUNT ? (unsigned int)key : PRIQUEUE_BUCKET_COUNT - 1;
+}
+
+
+/**
+  Returns the first bucket that holds an entry, found with a find-first-set over the bitmap of
+  non-empty buckets. The queue must not be empty.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @return the bucket index
+ */
+static unsigned int lowest_bucket(priqueue_t *q)
+{
+  unsigned int word = 0;
+  while( q->bucket_bits[word] == 0 )
+  {
+    word++;
+  }
+  return word * 64 + __builtin_ctzll(q->bucket_bits[word]);
+}
+
+
+/**
+  Returns the entry at the head of the selected backend. The queue must not be empty.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @return the head entry
+ */
+static priqueue_entry_t *head_entry(priqueue_t *q)
+{
+  switch( q->backend )
+  {
+    case PRIQUEUE_PAIRING_HEAP:
+      return &q->root->entry;
+    case PRIQUEUE_FIFO_RING:
+      return &q->heap.entries[q->ring_head];
+    case PRIQUEUE_BUCKET_QUEUE:
+      return &q->buckets[lowest_bucket(q)].entries[0];
+    default:
+      return &q->heap.entries[0];
+  }
+}
+
+
+/**
+  Adds an entry to the selected backend.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param entry the entry
+  @return the position of the entry in the heap or the ring; the other backends report 0 if the
+  entry became the head and the size of the queue otherwise
+ */
+static int insert_entry(priqueue_t *q, priqueue_entry_t entry)
+{
+  int position;
+  switch( q->backend )
+  {
+    case PRIQUEUE_PAIRING_HEAP:
+    {
+      priqueue_node_t *node = node_alloc(q);
+      node->entry = entry;
+      q->slots[entry.handle].node = node;
+      q->root = pairing_meld(q, q->root, node);
+      position = q->root == node ? 0 : q->curr_size;
+      break;
+    }
+
+    case PRIQUEUE_FIFO_RING:
+      /* When the ring is full, the entries that wrapped around to the front of the array are moved
+      past the old end, so the ring stays contiguous from ring_head in the doubled array. */
+      if( q->heap.size == q->heap.capacity )
+      {
+        unsigned int old_capacity = q->heap.capacity;
+        heap_reserve(&q->heap);
+        memcpy(q->heap.entries + old_capacity, q->heap.entries, q->ring_head * sizeof(priqueue_entry_t));
+      }
+      q->heap.entries[(q->ring_head + q->heap.size) % q->heap.capacity] = entry;
+      position = q->heap.size++;
+      break;
+
+    case PRIQUEUE_BUCKET_QUEUE:
+    {
+      unsigned int bucket = bucket_of(q, entry.data);
+      q->slots[entry.handle].bucket = bucket;
+      heap_push(q, &q->buckets[bucket], 2, entry);
+      q->bucket_bits[bucket / 64] |= 1ULL << (bucket % 64);
+      position = head_entry(q)->seq == entry.seq ? 0 : q->curr_size;
+      break;
+    }
+
+    default:
+      position = heap_push(q, &q->heap, q->arity, entry);
+      break;
+  }
+  q->curr_size++;
+  q->sorted_valid = 0;
+  return position;
+}
+
+
+/**
+  Removes the head of the selected backend. The queue must not be empty.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @return the head entry
+ */
+static priqueue_entry_t remove_head(priqueue_t *q)
+{
+  priqueue_entry_t head;
+  switch( q->backend )
+  {
+    case PRIQUEUE_PAIRING_HEAP:
+    {
+      priqueue_node_t *root = q->root;
+      head = root->entry;
+      q->root = pairing_merge_pairs(q, root->child);
+      node_free(q, root);
+      break;
+    }
+
+    case PRIQUEUE_FIFO_RING:
+      head = q->heap.entries[q->ring_head];
+      q->ring_head = (q->ring_head + 1) % q->heap.capacity;
+      q->heap.size--;
+      break;
+
+    case PRIQUEUE_BUCKET_QUEUE:
+    {
+      unsigned int bucket = lowest_bucket(q);
+      head = heap_remove(q, &q->buckets[bucket], 2, 0);
+      if( q->buckets[bucket].size == 0 )
+      {
+        q->bucket_bits[bucket / 64] &= ~(1ULL << (bucket % 64));
+      }
+      break;
+    }
+
+    default:
+      head = heap_remove(q, &q->heap, q->arity, 0);
+      break;
+  }
+  q->curr_size--;
+  q->sorted_valid = 0;
+  free_handle(q, head.handle);
+  return head;
+}
+
+
+/**
+  Copies every entry of the queue, in no particular order, into an array of curr_size entries.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param out the array
+ */
+static void collect_entries(priqueue_t *q, priqueue_entry_t *out)
+{
+  unsigned int count = 0;
+  switch( q->backend )
+  {
+    case PRIQUEUE_PAIRING_HEAP:
+    {
+      /* Walking the child and sibling links with an explicit stack; a node is pushed at most once. */
+      priqueue_node_t **stack = malloc((q->curr_size + 1) * sizeof(priqueue_node_t *));
+      unsigned int depth = 0;
+      if( q->root != NULL )
+      {
+        stack[depth++] = q->root;
+      }
+      while( depth > 0 )
+      {
+        priqueue_node_t *node = stack[--depth];
+        out[count++] = node->entry;
+        if( node->sibling != NULL )
+        {
+          stack[depth++] = node->sibling;
+        }
+        if( node->child != NULL )
+        {
+          stack[depth++] = node->child;
+        }
+      }
+      free(stack);
+      break;
+    }
+
+    case PRIQUEUE_FIFO_RING:
+      for( unsigned int i = 0; i < q->heap.size; i++ )
+      {
+        out[count++] = q->heap.entries[(q->ring_head + i) % q->heap.capacity];
+      }
+      break;
+
+    case PRIQUEUE_BUCKET_QUEUE:
+      for( unsigned int bucket = 0; bucket < PRIQUEUE_BUCKET_COUNT; bucket++ )
+      {
+        if( q->buckets[bucket].size > 0 )
+        {
+          memcpy(out + count, q->buckets[bucket].entries, q->buckets[bucket].size * sizeof(priqueue_entry_t));
+          count += q->buckets[bucket].size;
+        }
+      }
+      break;
+
+    default:
+      if( q->heap.size > 0 )
+      {
+        memcpy(out, q->heap.entries, q->heap.size * sizeof(priqueue_entry_t));
+      }
+      break;
+  }
+}
+
+
+/**
+  Empties the selected backend, keeping its memory for reuse.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+ */
+static void clear_entries(priqueue_t *q)
+{
+  /* Every pairing heap node goes back to the free list. A node's children are spliced in front of
+  the nodes still pending, so the walk needs no extra memory. */
+  priqueue_node_t *pending = q->root;
+  while( pending != NULL )
+  {
+    priqueue_node_t *node = pending;
+    pending = node->sibling;
+    if( node->child != NULL )
+    {
+      priqueue_node_t *last = node->child;
+      while( last->sibling != NULL )
+      {
+        last = last->sibling;
+      }
+      last->sibling = pending;
+      pending = node->child;
+    }
+    node_free(q, node);
+  }
+  q->root = NULL;
+
+  if( q->buckets != NULL )
+  {
+    for( unsigned int bucket = 0; bucket < PRIQUEUE_BUCKET_COUNT; bucket++ )
+    {
+      q->buckets[bucket].size = 0;
+    }
+  }
+  memset(q->bucket_bits, 0, sizeof(q->bucket_bits));
+  q->heap.size = 0;
+  q->ring_head = 0;
+  q->curr_size = 0;
+  q->sorted_valid = 0;
+}
+
+
+/**
+  Sorts entries into reverse priority order in place, with a heap sort: the entry that goes first
+  ends up in the last slot.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param entries the entries
+  @param size the number of entries
+ */
+static void sort_entries(priqueue_t *q, priqueue_entry_t *entries, unsigned int size)
+{
+  heapify(q, NULL, entries, size, 2);
+  for( ; size > 1; size-- )
+  {
+    priqueue_entry_t head = entries[0];
+    entries[0] = entries[size - 1];
+    entries[size - 1] = head;
+    sift_down(q, NULL, entries, size - 1, 2, 0);
+  }
+}
+
+
+/**
+  Builds the priority-order copy of the queue used by priqueue_at().
+
+  @param q a pointer to an instance of the priqueue_t data structure
+ */
+static void build_sorted(priqueue_t *q)
+{
+  if( q->sorted_capacity < q->curr_size )
+  {
+    q->sorted_capacity = q->curr_size;
+    q->sorted = realloc(q->sorted, q->sorted_capacity * sizeof(priqueue_entry_t));
+  }
+  collect_entries(q, q->sorted);
+  sort_entries(q, q->sorted, q->curr_size);
+  q->sorted_valid = 1;
+}
+
+
+/**
+  Removes the entries whose data is ptr, or the one entry with sequence number seq when ptr is
+  NULL. The heaps drop the entries in place and are rebuilt bottom-up in O(n). The other backends
+  are emptied and refilled in priority order with the entries that are kept, under their original
+  sequence numbers so that ties keep their order.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param ptr the data to remove, or NULL to remove by sequence number
+  @param seq the sequence number to remove when ptr is NULL
+  @param removed receives the data of the last removed entry
+  @return the number of entries removed
+ */
+static int remove_entries(priqueue_t *q, void *ptr, unsigned long long seq, void **removed)
+{
+  unsigned int size = q->curr_size;
+  unsigned int kept = 0;
+  priqueue_entry_t *entries;
+  int heap_backend = q->backend == PRIQUEUE_BINARY_HEAP || q->backend == PRIQUEUE_DARY_HEAP;
+
+  if( heap_backend )
+  {
+    entries = q->heap.entries;
+  }
+  else
+  {
+    entries = malloc((size + 1) * sizeof(priqueue_entry_t));
+    collect_entries(q, entries);
+  }
+
+  for( unsigned int i = 0; i < size; i++ )
+  {
+    if( ptr != NULL ? entries[i].data == ptr : entries[i].seq == seq )
+    {
+      *removed = entries[i].data;
+      free_handle(q, entries[i].handle);
+    }
+    else
+    {
+      place(heap_backend ? q->slots : NULL, entries, kept++, entries[i]);
+    }
+  }
+  if( kept == size )
+  {
+    if( !heap_backend )
+    {
+      free(entries);
+    }
+    return 0;
+  }
+
+  if( heap_backend )
+  {
+    q->heap.size = kept;
+    q->curr_size = kept;
+    q->sorted_valid = 0;
+    heapify(q, q->slots, entries, kept, q->arity);
+  }
+  else
+  {
+    clear_entries(q);
+    sort_entries(q, entries, kept);
+    for( unsigned int i = kept; i > 0; i-- )
+    {
+      insert_entry(q, entries[i - 1]);
+    }
+    free(entries);
+  }
+  return size - kept;
+}
+
+
+/**
+  Initializes the priqueue_t data structure.
+
+  Assumtions
+    - You may assume this function will only be called once per instance of priqueue_t
+    - You may assume this function will be the first function called using an instance of priqueue_t.
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param comparer a function pointer that compares two elements.
+  See also @ref comparer-page
+ */
+void priqueue_init(priqueue_t *q, int(*comparer)(const void *, const void *))
+{
+  priqueue_init_backend(q, comparer, PRIQUEUE_BINARY_HEAP, NULL);
+}
+
+
+/**
+  Initializes the priqueue_t data structure on a chosen backend.
+
+  The order in which elements leave the queue is the same for every backend; see
+  priqueue_backend_t for what each one is fast at and for the comparers each one accepts.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param comparer a function pointer that compares two elements.
+  @param backend the data structure the queue is built on
+  @param key a function returning the integer key of an element, used by PRIQUEUE_BUCKET_QUEUE only
+ */
+void priqueue_init_backend(priqueue_t *q, int(*comparer)(const void *, const void *),
+                           priqueue_backend_t backend, key_func_t key)
+{
+  memset(q, 0, sizeof(priqueue_t));
+  q->backend = backend;
+  q->comparer = comparer;
+  q->key = key;
+  q->arity = backend == PRIQUEUE_DARY_HEAP ? PRIQUEUE_DARY_ARITY : 2;
+  q->free_handle = -1;
+  if( backend == PRIQUEUE_BUCKET_QUEUE )
+  {
+    q->buckets = calloc(PRIQUEUE_BUCKET_COUNT, sizeof(priqueue_heap_t));
+  }
+}
+
+
+/**
+  Insert the specified element into this priority queue.
+
+  Offers are O(log n) on the heaps and O(1) on the pairing heap and the FIFO ring. On the bucket
+  queue they are O(log m), for the m elements that share the element's bucket.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param ptr a pointer to the data to be inserted into the priority queue
+  @return The zero-based position of ptr in the queue's storage, where 0 indicates that ptr was stored at the front of the priority queue.
+ */
+int priqueue_offer(priqueue_t *q, void *ptr)
+{
+  priqueue_entry_t entry = { ptr, q->next_seq, alloc_handle(q, q->next_seq) };
+  q->next_seq++;
+  return insert_entry(q, entry);
+}
+
+
+/**
+  Retrieves, but does not remove, the head of this queue, returning NULL if this queue is empty.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @return pointer to element at the head of the queue
+  @return NULL if the queue is empty
+ */
+void *priqueue_peek(priqueue_t *q)
+{
+  if( q->curr_size == 0 )
+  {
+    return NULL;
+  }
+  return head_entry(q)->data;
+}
+
+
+/**
+  Retrieves and removes the head of this queue, or NULL if this queue is empty.
+
+  Polls are O(log n) on the heaps and amortized O(log n) on the pairing heap. On the FIFO ring
+  they are O(1), and on the bucket queue O(log m) plus a scan of the bucket bitmap.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @return the head of this queue
+  @return NULL if this queue is empty
+ */
+void *priqueue_poll(priqueue_t *q)
+{
+  if( q->curr_size == 0 )
+  {
+    return NULL;
+  }
+  return remove_head(q).data;
+}
+
+
+/**
+  Returns the element at the specified position in this list, or NULL if the queue does not contain an index'th element.
+
+  Positions follow the priority order. The first call after the queue changed sorts a copy of
+  the queue in O(n log n); further calls are O(1) until the next change, so walking the whole
+  queue with increasing indices stays cheap.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param index position of retrieved element
+  @return the index'th element in the queue
+  @return NULL if the queue does not contain the index'th element
+ */
+void *priqueue_at(priqueue_t *q, int index)
+{
+  if( index < 0 || (unsigned int)index >= q->curr_size )
+  {
+    return NULL;
+  }
+  if( index == 0 )
+  {
+    return head_entry(q)->data;
+  }
+  if( !q->sorted_valid )
+  {
+    build_sorted(q);
+  }
+  return q->sorted[q->curr_size - 1 - index].data;
+}
+
+
+/**
+  Removes all instances of ptr from the queue.
+
+  This function should not use the comparer function, but check if the data contained in each element of the queue is equal (==) to ptr.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param ptr address of element to be removed
+  @return the number of entries removed
+ */
+int priqueue_remove(priqueue_t *q, void *ptr)
+{
+  void *removed;
+  if( ptr == NULL )
+  {
+    return 0;
+  }
+  return remove_entries(q, ptr, 0, &removed);
+}
+
+
+/**
+  Removes the specified index from the queue, moving later elements up
+  a spot in the queue to fill the gap.
+
+  The index is a position in priority order, as in priqueue_at().
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param index position of element to be removed
+  @return the element removed from the queue
+  @return NULL if the specified index does not exist
+ */
+void *priqueue_remove_at(priqueue_t *q, int index)
+{
+  if( index < 0 || (unsigned int)index >= q->curr_size )
+  {
+    return NULL;
+  }
+  if( index == 0 )
+  {
+    return remove_head(q).data;
+  }
+  if( !q->sorted_valid )
+  {
+    build_sorted(q);
+  }
+  return priqueue_remove_handle(q, q->sorted[q->curr_size - 1 - index].handle);
+}
+
+
+/**
+  Return the number of elements in the queue.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @return the number of elements in the queue
+ */
+int priqueue_size(priqueue_t *q)
+{
+	return q->curr_size;
+}
+
+
+/**
+  Insert the specified element into this priority queue, returning a handle to it.
+
+  The handle stays valid until the element leaves the queue, and lets priqueue_remove_handle()
+  and priqueue_update_key() find the element without searching for it.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param ptr a pointer to the data to be inserted into the priority queue
+  @return the handle of the element
+ */
+priqueue_handle_t priqueue_offer_handle(priqueue_t *q, void *ptr)
+{
+  priqueue_handle_t handle = alloc_handle(q, q->next_seq);
+  priqueue_entry_t entry = { ptr, q->next_seq++, handle };
+  insert_entry(q, entry);
+  return handle;
+}
+
+
+/**
+  Removes the element of a handle from the queue.
+
+  This is O(log n) on the heaps and the bucket queue, and amortized O(log n) on the pairing heap.
+  The FIFO ring has no fast way to close a gap and rebuilds itself in O(n).
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param handle the handle returned when the element was offered
+  @return the element removed from the queue
+  @return NULL if the handle does not belong to an element of the queue
+ */
+void *priqueue_remove_handle(priqueue_t *q, priqueue_handle_t handle)
+{
+  if( handle < 0 || (unsigned int)handle >= q->slots_capacity || !q->slots[handle].live )
+  {
+    return NULL;
+  }
+
+  priqueue_slot_t *slot = &q->slots[handle];
+  void *data = NULL;
+  switch( q->backend )
+  {
+    case PRIQUEUE_PAIRING_HEAP:
+      data = slot->node->entry.data;
+      pairing_remove(q, slot->node);
+      node_free(q, slot->node);
+      break;
+
+    case PRIQUEUE_FIFO_RING:
+      remove_entries(q, NULL, slot->seq, &data);
+      return data;
+
+    case PRIQUEUE_BUCKET_QUEUE:
+    {
+      unsigned int bucket = slot->bucket;
+      data = heap_remove(q, &q->buckets[bucket], 2, slot->index).data;
+      if( q->buckets[bucket].size == 0 )
+      {
+        q->bucket_bits[bucket / 64] &= ~(1ULL << (bucket % 64));
+      }
+      break;
+    }
+
+    default:
+      data = heap_remove(q, &q->heap, q->arity, slot->index).data;
+      break;
+  }
+  q->curr_size--;
+  q->sorted_valid = 0;
+  free_handle(q, handle);
+  return data;
+}
+
+
+/**
+  Moves the element of a handle to its new place after the caller changed the fields the comparer
+  (or the bucket key) looks at. The element keeps its place in the order of insertion, so ties
+  with other elements are broken as before.
+
+  This is O(log n) on the heaps and the bucket queue, and amortized O(log n) on the pairing heap.
+  The FIFO ring orders by insertion only, so nothing moves.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param handle the handle returned when the element was offered
+  @return 0 if the element is now at the head of the queue, 1 if it is not
+  @return -1 if the handle does not belong to an element of the queue
+ */
+int priqueue_update_key(priqueue_t *q, priqueue_handle_t handle)
+{
+  if( handle < 0 || (unsigned int)handle >= q->slots_capacity || !q->slots[handle].live )
+  {
+    return -1;
+  }
+
+  priqueue_slot_t *slot = &q->slots[handle];
+  switch( q->backend )
+  {
+    case PRIQUEUE_PAIRING_HEAP:
+    {
+      priqueue_node_t *node = slot->node;
+      pairing_remove(q, node);
+      q->root = pairing_meld(q, q->root, node);
+      break;
+    }
+
+    case PRIQUEUE_FIFO_RING:
+      break;
+
+    case PRIQUEUE_BUCKET_QUEUE:
+    {
+      unsigned int bucket = slot->bucket;
+      priqueue_heap_t *heap = &q->buckets[bucket];
+      unsigned int index = slot->index;
+      if( bucket_of(q, heap->entries[index].data) == bucket )
+      {
+        if( sift_up(q, q->slots, heap->entries, 2, index) == index )
+        {
+          sift_down(q, q->slots, heap->entries, heap->size, 2, index);
+        }
+        break;
+      }
+      /* The key moved the element to another bucket. */
+      priqueue_entry_t entry = heap_remove(q, heap, 2, index);
+      if( heap->size == 0 )
+      {
+        q->bucket_bits[bucket / 64] &= ~(1ULL << (bucket % 64));
+      }
+      bucket = bucket_of(q, entry.data);
+      slot->bucket = bucket;
+      heap_push(q, &q->buckets[bucket], 2, entry);
+      q->bucket_bits[bucket / 64] |= 1ULL << (bucket % 64);
+      break;
+    }
+
+    default:
+    {
+      unsigned int index = slot->index;
+      if( sift_up(q, q->slots, q->heap.entries, q->arity, index) == index )
+      {
+        sift_down(q, q->slots, q->heap.entries, q->heap.size, q->arity, index);
+      }
+      break;
+    }
+  }
+  q->sorted_valid = 0;
+  return head_entry(q)->handle == handle ? 0 : 1;
+}
+
+
+/**
+  Destroys and frees all the memory associated with q.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+ */
+void priqueue_destroy(priqueue_t *q)
+{
+  free( q->heap.entries );
+  free( q->sorted );
+  free( q->slots );
+  if( q->buckets != NULL )
+  {
+    for( unsigned int bucket = 0; bucket < PRIQUEUE_BUCKET_COUNT; bucket++ )
+    {
+      free( q->buckets[bucket].entries );
+    }
+    free( q->buckets );
+  }
+  while( q->node_chunks != NULL )
+  {
+    node_chunk_t *chunk = q->node_chunks;
+    q->node_chunks = chunk->next;
+    free( chunk );
+  }
+}
+
+
+/**
+  Returns the name of a backend, as printed by the benchmarks.
+
+  @param backend the backend
+  @return the name of the backend
+ */
+const char *priqueue_backend_name(priqueue_backend_t backend)
+{
+  static const char *names[PRIQUEUE_BACKEND_COUNT] = { "binary-heap", "4-ary-heap", "pairing-heap", "fifo-ring", "bucket-queue" };
+  if( (unsigned int)backend >= PRIQUEUE_BACKEND_COUNT )
+  {
+    return "unknown";
+  }
+  return names[backend];
+}
@@ -0,0 +1,145 @@
+/** @file libpriqueue.h
+ */
+
+#ifndef LIBPRIQUEUE_H_
+#define LIBPRIQUEUE_H_
+
+/**
+  Priqueue Data Structure
+*/
+
+typedef int (*compare_func_t) ( const void *a, const void *b);
+typedef int (*key_func_t) ( const void *a);
+
+/**
+  The data structures a priqueue_t can be built on. They all serve elements in the same order;
+  they differ in what they are fast at.
+    - PRIQUEUE_BINARY_HEAP: the general-purpose default.
+    - PRIQUEUE_DARY_HEAP: a 4-ary heap, shallower, so polls touch fewer cache lines.
+    - PRIQUEUE_PAIRING_HEAP: O(1) offers, for queues that take many more offers than polls.
+    - PRIQUEUE_FIFO_RING: a ring buffer, only for comparers under which insertion order is the
+      priority order (such as a comparer that always returns -1).
+    - PRIQUEUE_BUCKET_QUEUE: one small heap per integer key, for small integer priorities. The
+      key function must agree with the comparer: a smaller key never goes after a larger one.
+*/
+typedef enum {
+  PRIQUEUE_BINARY_HEAP = 0,
+  PRIQUEUE_DARY_HEAP,
+  PRIQUEUE_PAIRING_HEAP,
+  PRIQUEUE_FIFO_RING,
+  PRIQUEUE_BUCKET_QUEUE
+} priqueue_backend_t;
+
+#define PRIQUEUE_BACKEND_COUNT 5
+#define PRIQUEUE_DARY_ARITY 4
+#define PRIQUEUE_BUCKET_COUNT 256
+
+/**
+  Identifies one queued element for priqueue_remove_handle() and priqueue_update_key(). A handle
+  is valid from the offer that returned it until the element leaves the queue; handles are then
+  reused.
+*/
+typedef int priqueue_handle_t;
+
+/**
+  One queued element. The sequence number records the order of insertion, so elements the
+  comparer considers equal leave the queue in the order they were offered.
+*/
+typedef struct _priqueue_entry_t
+{
+  void *data;
+  unsigned long long seq;
+  priqueue_handle_t handle;
+} priqueue_entry_t;
+
+/**
+  A growable array of entries: a heap, a bucket of the bucket queue, or the ring buffer.
+*/
+typedef struct _priqueue_heap_t
+{
+  priqueue_entry_t *entries;
+  unsigned int size;
+  unsigned int capacity;
+} priqueue_heap_t;
+
+/**
+  A node of the pairing heap, linked to its first child and to its next sibling. prev is the
+  previous sibling, or the parent for a first child.
+*/
+typedef struct _priqueue_node_t
+{
+  priqueue_entry_t entry;
+  struct _priqueue_node_t *child;
+  struct _priqueue_node_t *sibling;
+  struct _priqueue_node_t *prev;
+} priqueue_node_t;
+
+/**
+  Where the element of a handle is stored: its index in the heap or in the bucket, its bucket,
+  or its pairing heap node. A free slot links to the next free handle through index.
+*/
+typedef struct _priqueue_slot_t
+{
+  unsigned int index;
+  unsigned int bucket;
+  priqueue_node_t *node;
+  unsigned long long seq;
+  int live;
+} priqueue_slot_t;
+
+/**
+  A priority queue. Only the fields of the selected backend are used. `slots` maps every handle
+  to the place of its element and is kept up to date as elements move. `sorted` is a
+  priority-order copy of the queue that priqueue_at() builds on demand; any change to the queue
+  invalidates it.
+*/
+typedef struct _priqueue_t
+{
+  priqueue_backend_t backend;
+  compare_func_t comparer;
+  key_func_t key;
+  unsigned int arity;
+  unsigned int curr_size;
+  unsigned long long next_seq;
+
+  priqueue_heap_t heap;
+  unsigned int ring_head;
+
+  priqueue_node_t *root;
+  priqueue_node_t *free_nodes;
+  void *node_chunks;
+
+  priqueue_heap_t *buckets;
+  unsigned long long bucket_bits[PRIQUEUE_BUCKET_COUNT / 64];
+
+  priqueue_slot_t *slots;
+  unsigned int slots_capacity;
+  int free_handle;
+
+  priqueue_entry_t *sorted;
+  unsigned int sorted_capacity;
+  int sorted_valid;
+} priqueue_t;
+
+
+void   priqueue_init     (priqueue_t *q, int(*comparer)(const void *, const void *));
+void   priqueue_init_backend(priqueue_t *q, int(*comparer)(const void *, const void *),
+                             priqueue_backend_t backend, key_func_t key);
+
+int    priqueue_offer    (priqueue_t *q, void *ptr);
+void * priqueue_peek     (priqueue_t *q);
+void * priqueue_poll     (priqueue_t *q);
+void * priqueue_at       (priqueue_t *q, int index);
+int    priqueue_remove   (priqueue_t *q, void *ptr);
+void * priqueue_remove_at(priqueue_t *q, int index);
+int    priqueue_size     (priqueue_t *q);
+
+priqueue_handle_t priqueue_offer_handle(priqueue_t *q, void *ptr);
+void * priqueue_remove_handle(priqueue_t *q, priqueue_handle_t handle);
+int    priqueue_update_key(priqueue_t *q, priqueue_handle_t handle);
+
+void   priqueue_destroy  (priqueue_t *q);
+
+const char *priqueue_backend_name(priqueue_backend_t backend);
+
+#endif /* LIBPQUEUE_H_ */
@@ -0,0 +1,1329 @@
+/** @file libscheduler.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libscheduler.h"
+#include "../libpriqueue/libpriqueue.h"
+
+
+/**
+  Stores information making up a job to be scheduled including any statistics.
+
+  You may need to define some global variables or a struct to store your job queue elements. 
+*/
+typedef struct _job_t
+{
+  int pid;
+  int arrival_time;
+  int priority;
+  int used_time;
+  int total_time_needed;
+  int last_start_time;
+  int job_response_time;
+  int core;
+  priqueue_handle_t running_handle;
+  int level;
+  int level_used;
+  int level_start;
+  int boost_epoch;
+  long long vruntime;
+  int weight;
+  int slice;
+  int deadline;
+} job_t;
+
+/**
+ * The weight of each nice value from -20 to 19 under CFS, as in Linux: a job gets about 25% more of
+ * a core than a job one nice value above it.
+ */
+static const int cfs_weights[40] =
+{
+  88761, 71755, 56483, 46273, 36291,
+  29154, 23254, 18705, 14949, 11916,
+  9548, 7620, 6100, 4904, 3906,
+  3121, 2501, 1991, 1586, 1277,
+  1024, 820, 655, 526, 423,
+  335, 272, 215, 172, 137,
+  110, 87, 70, 56, 45,
+  36, 29, 23, 18, 15,
+};
+
+/* The weight of nice 0. The virtual runtime of a job advances by CFS_NICE_0_WEIGHT / weight
+units for every unit of time it runs, scaled by CFS_VRUNTIME_SCALE to keep it an integer. */
+#define CFS_NICE_0_WEIGHT 1024
+#define CFS_VRUNTIME_SCALE 1024
+
+/**
+ * The function calculates the remaining time needed for a job by subtracting the used time from the
+ * total time needed.
+ * 
+ * @param job The parameter "job" is a pointer to a structure of type "job_t".
+ * 
+ * @return the remaining time needed for a job.
+ */
+int remainingTime(const job_t *job)
+{
+  return job->total_time_needed - job->used_time;
+}
+
+/**
+ * The `scheduler_t` type represents a scheduler with various properties and statistics.
+ * @property {scheme_t} scheduler_scheme - The scheduling scheme used by the scheduler. It could be a
+ * round-robin, priority-based, or any other scheduling algorithm.
+ * @property {priqueue_t} job_queue - The job_queue is a priority queue that stores the jobs to be
+ * scheduled. Jobs are added to the queue based on their priority, and the scheduler selects the
+ * highest priority job to be executed next.
+ * @property {int} core_count - The number of cores available in the scheduler.
+ * @property {job_t} current_jobs_on_cores - A pointer to an array of job_t pointers. It represents the 
+ * jobs currently running on each core in the scheduler.
+ * @property {int} total_wait_time - The total amount of time that all jobs have spent waiting in the
+ * job queue before being executed.
+ * @property {int} total_response_time - The total amount of time it takes for a job to receive its
+ * first response from the scheduler.
+ * @property {int} total_turn_around_time - The total turn around time is the sum of the time taken for
+ * each job to complete, from the moment it enters the scheduler until it finishes execution.
+ * @property {int} total_jobs_count - The total number of jobs that have been processed by the scheduler.
+ * @property {int} quantum - The quantum of RR, as given to scheduler_create(). The caller times the
+ * quantum and calls scheduler_quantum_expired_r() when it runs out.
+ * @property {unsigned long long} idle_cores - A bitmap with a set bit for each idle core.
+ * @property {unsigned long long} idle_words - A bitmap with a set bit for each word of idle_cores
+ * that has an idle core, so the lowest idle core is found in a couple of steps.
+ * @property {priqueue_t} running_jobs - Under PSJF, PPRI, MLFQ and PEDF, the jobs on the cores, with the
+ * job a new job would preempt first at the head.
+ * @property {int} mlfq_levels - Under MLFQ, the number of levels, and mlfq_quanta the quantum of each.
+ * @property {int} boost_interval - Under MLFQ, the time between two priority boosts, 0 for none, and
+ * next_boost the time of the next one.
+ * @property {int} boosts - Under MLFQ, the number of boosts so far. A waiting job whose boost_epoch is
+ * older was boosted while it waited, and its level counts as the top level.
+ * @property {int} latency - Under CFS, the time in which every waiting job should get to run once.
+ * @property {long long} min_vruntime - Under CFS, the virtual runtime new jobs start at. It follows
+ * the lowest virtual runtime of the queue and never goes back.
+ * @property {long long} total_weight - Under CFS, the weight of all the jobs that have not finished.
+ * @property {int} deadline_jobs_count - The number of finished jobs that had a deadline, and
+ * deadline_misses the number of them that finished after it.
+ * @property {long long} total_lateness - The sum over the finished jobs with a deadline of the time
+ * they finished after it, negative for the jobs that finished early, and max_lateness the largest.
+ */
+struct _scheduler_t
+{
+  scheme_t scheduler_scheme;
+  priqueue_t job_queue;
+  int core_count;
+  int quantum;
+  job_t** current_jobs_on_cores;
+  int total_wait_time;
+  int total_response_time;
+  int total_turn_around_time;
+  int total_jobs_count;
+  unsigned long long *idle_cores;
+  unsigned long long *idle_words;
+  priqueue_t running_jobs;
+  int mlfq_levels;
+  int mlfq_quanta[MLFQ_MAX_LEVELS];
+  int boost_interval;
+  int next_boost;
+  int boosts;
+  int latency;
+  long long min_vruntime;
+  long long total_weight;
+  int deadline_jobs_count;
+  int deadline_misses;
+  long long total_lateness;
+  int max_lateness;
+};
+
+/* The scheduler behind the scheduler_*() functions that take no scheduler_t, created by
+scheduler_start_up() and destroyed by scheduler_clean_up(). */
+scheduler_t *scheduler_ptr;
+
+
+/**
+ * The code defines three comparison functions for different scheduling algorithms.
+ * @param a The parameter "a" is a pointer to a constant void type. It is used as a parameter for the
+ * comparison function in the qsort() function.
+ * @param b The parameter "b" is a pointer to a constant void object.
+ */
+int FCFScompare(const void *a, const void *b)
+{
+  return -1;
+}
+
+/**
+ * The function SJFcompare compares two job_t objects based on their remaining time and arrival time.
+ * 
+ * @return the result of the comparison between two job_t objects. If the remaining time of the left
+ * job is equal to the remaining time of the right job, it returns the difference between their arrival
+ * times. Otherwise, it returns the difference between their remaining times.
+ */
+int SJFcompare(const void *a, const void *b)
+{
+  /* Casting the void pointer `a` to a pointer of type `job_t const *`. This is done to access the members 
+  of the `job_t` structure in the comparison function. By casting `a` to `job_t const *`, we can treat `a` 
+  as a pointer to a `job_t` object and access its members. */
+  job_t const *left = (job_t*)a;
+  job_t const *right = (job_t*)b;
+
+  /* Checking if the remaining time of the left job is equal to the remaining time of the right job. 
+  It is used in the SJF comparison function to determine the order in which jobs should be scheduled. 
+  If two jobs have the same remaining time, the comparison function will then compare their arrival 
+  times to determine the order. */
+  if( remainingTime(left) == remainingTime(right) )
+  {
+    return ( left->arrival_time - right->arrival_time ) ;
+  }
+  else
+  {
+    return ( remainingTime(left) - remainingTime(right) ) ;
+  }
+}
+
+/**
+ * The function `PRIcompare` compares two job_t structs based on their priority and arrival time.
+ * 
+ * @param a A pointer to the first element to be compared.
+ * @param b The parameter "b" is a pointer to a constant void type.
+ * 
+ * @return an integer value.
+ */
+int PRIcompare(const void *a, const void *b)
+{
+  job_t const *left = (job_t*)a;
+  job_t const *right = (job_t*)b;
+
+  /* Checking if the priority of the left job is equal to the priority of the right job. This comparison 
+  is used in the PRIcompare function to determine the order in which jobs should be scheduled. If two jobs 
+  have the same priority, the comparison function will then compare their arrival times to determine the order. */
+  if( left->priority == right->priority)
+  {
+    return (right->arrival_time - left->arrival_time) * -1;
+  }
+  else
+  {
+    return (right->priority - left->priority) * -1;
+  }
+}
+
+/**
+ * The function `longestRemainingCompare` orders the jobs on the cores for PSJF: the job with the most
+ * remaining time first, then the one that arrived last, then the one on the lowest core. The head is
+ * the job a shorter new job preempts.
+ *
+ * @param a A pointer to the first job.
+ * @param b A pointer to the second job.
+ *
+ * @return an integer value.
+ */
+int longestRemainingCompare(const void *a, const void *b)
+{
+  job_t const *left = (job_t*)a;
+  job_t const *right = (job_t*)b;
+
+  if( remainingTime(left) != remainingTime(right) )
+  {
+    return remainingTime(right) - remainingTime(left);
+  }
+  else if( left->arrival_time != right->arrival_time )
+  {
+    return right->arrival_time - left->arrival_time;
+  }
+  return left->core - right->core;
+}
+
+/**
+ * The function `worstPriorityCompare` orders the jobs on the cores for PPRI: the job with the worst
+ * (highest) priority value first, then the one that arrived last, then the one on the lowest core.
+ * The head is the job a higher priority new job preempts.
+ *
+ * @param a A pointer to the first job.
+ * @param b A pointer to the second job.
+ *
+ * @return an integer value.
+ */
+int worstPriorityCompare(const void *a, const void *b)
+{
+  job_t const *left = (job_t*)a;
+  job_t const *right = (job_t*)b;
+
+  if( left->priority != right->priority )
+  {
+    return right->priority - left->priority;
+  }
+  else if( left->arrival_time != right->arrival_time )
+  {
+    return right->arrival_time - left->arrival_time;
+  }
+  return left->core - right->core;
+}
+
+/**
+ * The function `lowestLevelCompare` orders the jobs on the cores for MLFQ: the job on the lowest level
+ * (the highest level number) first, then the one that arrived last, then the one on the lowest core.
+ * The head is the job a new job, which enters the top level, preempts.
+ *
+ * @param a A pointer to the first job.
+ * @param b A pointer to the second job.
+ *
+ * @return an integer value.
+ */
+int lowestLevelCompare(const void *a, const void *b)
+{
+  job_t const *left = (job_t*)a;
+  job_t const *right = (job_t*)b;
+
+  if( left->level != right->level )
+  {
+    return right->level - left->level;
+  }
+  else if( left->arrival_time != right->arrival_time )
+  {
+    return right->arrival_time - left->arrival_time;
+  }
+  return left->core - right->core;
+}
+
+/**
+ * The function `MLFQcompare` orders the waiting jobs of MLFQ by the boost they were queued after,
+ * then by level. A boost moves every waiting job to the top level ahead of the jobs queued after it,
+ * in the order they were in, which is the order of the earlier boost epoch. Jobs of the same epoch
+ * and level are served in the order they were queued.
+ *
+ * @param a A pointer to the first job.
+ * @param b A pointer to the second job.
+ *
+ * @return an integer value.
+ */
+int MLFQcompare(const void *a, const void *b)
+{
+  job_t const *left = (job_t*)a;
+  job_t const *right = (job_t*)b;
+
+  if( left->boost_epoch != right->boost_epoch )
+  {
+    return left->boost_epoch < right->boost_epoch ? -1 : 1;
+  }
+  return left->level - right->level;
+}
+
+/**
+ * The function `CFScompare` orders the waiting jobs of CFS by virtual runtime, then by arrival time
+ * and job number.
+ *
+ * @param a A pointer to the first job.
+ * @param b A pointer to the second job.
+ *
+ * @return an integer value.
+ */
+int CFScompare(const void *a, const void *b)
+{
+  job_t const *left = (job_t*)a;
+  job_t const *right = (job_t*)b;
+
+  if( left->vruntime != right->vruntime )
+  {
+    return left->vruntime < right->vruntime ? -1 : 1;
+  }
+  else if( left->arrival_time != right->arrival_time )
+  {
+    return left->arrival_time - right->arrival_time;
+  }
+  return left->pid - right->pid;
+}
+
+/**
+ * The function `EDFcompare` orders jobs by deadline, the earliest first, with the jobs that have no
+ * deadline after all the others. Jobs with the same deadline go by arrival time.
+ *
+ * @param a A pointer to the first job.
+ * @param b A pointer to the second job.
+ *
+ * @return an integer value.
+ */
+int EDFcompare(const void *a, const void *b)
+{
+  job_t const *left = (job_t*)a;
+  job_t const *right = (job_t*)b;
+
+  if( left->deadline != right->deadline )
+  {
+    if( left->deadline == NO_DEADLINE || right->deadline == NO_DEADLINE )
+    {
+      return left->deadline == NO_DEADLINE ? 1 : -1;
+    }
+    return left->deadline - right->deadline;
+  }
+  return left->arrival_time - right->arrival_time;
+}
+
+/**
+ * The function `latestDeadlineCompare` orders the jobs on the cores for PEDF: the job EDF would run
+ * last first, then the one on the lowest core. The head is the job a new job with an earlier deadline
+ * preempts.
+ *
+ * @param a A pointer to the first job.
+ * @param b A pointer to the second job.
+ *
+ * @return an integer value.
+ */
+int latestDeadlineCompare(const void *a, const void *b)
+{
+  int order = EDFcompare( b, a );
+  if( order != 0 )
+  {
+    return order;
+  }
+  return ((job_t const *)a)->core - ((job_t const *)b)->core;
+}
+
+/**
+ * The function `PRIkey` returns the priority of a job as the bucket key of the job queue. A lower
+ * priority value is scheduled first, which is the order PRIcompare gives.
+ * 
+ * @param a A pointer to the job.
+ * 
+ * @return the priority of the job.
+ */
+int PRIkey(const void *a)
+{
+  return ((job_t const *)a)->priority;
+}
+
+/**
+  Creates a scheduler. Schedulers share no state, so any number of them can be used at once, each
+  from one thread at a time.
+
+  @param cores the number of cores that is available by the scheduler. These cores will be known as core(id=0), core(id=1), ..., core(id=cores-1).
+  @param scheme  the scheduling scheme that should be used. This value will be one of the six enum values of scheme_t
+  @param quantum the quantum of RR. It is only recorded: the caller times it and calls scheduler_quantum_expired_r().
+  @return the scheduler, or NULL if out of memory.
+*/
+scheduler_t *scheduler_create(int cores, scheme_t scheme, int quantum)
+{
+/* Initializing the scheduler by allocating memory for the `scheduler_t` object and setting its properties. */
+  scheduler_t *scheduler = (scheduler_t *) calloc( 1, sizeof(scheduler_t));
+  if( scheduler == NULL )
+  {
+    return NULL;
+  }
+	/* Assigning the value of the `cores` parameter to the `core_count` property of the scheduler. 
+  This property represents the number of cores available in the scheduler. */
+  scheduler->core_count = cores;
+  scheduler->quantum = quantum;
+	/* Allocating memory for an array of job_t pointers, one per core, all NULL to begin with. This
+  property represents the jobs currently running on each core in the scheduler. */
+  scheduler->current_jobs_on_cores = (job_t **) calloc( cores , sizeof(job_t*));
+  /* Every core starts idle: all of its bits in `idle_cores` are set, and so are the bits of the words
+  of `idle_cores` in `idle_words`. */
+  int words = (cores + 63) / 64;
+  scheduler->idle_cores = (unsigned long long *) calloc( words, sizeof(unsigned long long));
+  scheduler->idle_words = (unsigned long long *) calloc( (words + 63) / 64, sizeof(unsigned long long));
+  if( scheduler->current_jobs_on_cores == NULL || scheduler->idle_cores == NULL || scheduler->idle_words == NULL )
+  {
+    free( scheduler->current_jobs_on_cores );
+    free( scheduler->idle_cores );
+    free( scheduler->idle_words );
+    free( scheduler );
+    return NULL;
+  }
+  for(int i = 0; i < cores; i++)
+  {
+    scheduler->idle_cores[i / 64] |= 1ULL << (i % 64);
+  }
+  for(int i = 0; i < words; i++)
+  {
+    scheduler->idle_words[i / 64] |= 1ULL << (i % 64);
+  }
+  scheduler->scheduler_scheme = scheme;
+
+  /* The preemptive schemes keep the jobs on the cores in a heap, so the job to preempt is at its head. */
+  if( scheme == PSJF )
+  {
+    priqueue_init_backend(&scheduler->running_jobs, longestRemainingCompare, PRIQUEUE_BINARY_HEAP, NULL);
+  }
+  else if( scheme == PPRI )
+  {
+    priqueue_init_backend(&scheduler->running_jobs, worstPriorityCompare, PRIQUEUE_BINARY_HEAP, NULL);
+  }
+  else if( scheme == MLFQ )
+  {
+    priqueue_init_backend(&scheduler->running_jobs, lowestLevelCompare, PRIQUEUE_BINARY_HEAP, NULL);
+  }
+  else if( scheme == PEDF )
+  {
+    priqueue_init_backend(&scheduler->running_jobs, latestDeadlineCompare, PRIQUEUE_BINARY_HEAP, NULL);
+  }
+
+  /* MLFQ starts with levels whose quanta double from 2; CFS takes its target latency from the quantum. */
+  scheduler->mlfq_levels = MLFQ_DEFAULT_LEVELS;
+  for(int i = 0; i < MLFQ_DEFAULT_LEVELS; i++)
+  {
+    scheduler->mlfq_quanta[i] = 2 << i;
+  }
+  scheduler->boost_interval = MLFQ_DEFAULT_BOOST;
+  scheduler->next_boost = MLFQ_DEFAULT_BOOST;
+  scheduler->latency = quantum > 0 ? quantum : CFS_DEFAULT_LATENCY;
+
+  /* Initializing a priority queue based on the value of the "scheme" variable. If the value of "scheme"
+  is FCFS or RR, the priority queue is initialized with the function FCFScompare. If the value of "scheme" 
+  is SJF or PSJF, the priority queue is initialized with the function SJFcompare. If the value of "scheme" 
+  is PRI or PPRI, the priority queue is initialized with the function PRIcompare. 
+  Each scheme also gets a backend picked with `queuetest --bench-backends`: a ring buffer for the pure
+  FIFO order of FCFS and RR, and one bucket per priority for PRI and PPRI, which were fastest at every
+  queue length measured. SJF and PSJF get a pairing heap, which was fastest by a factor of 3 to 4 with
+  100 and 10^4 waiting jobs but the slowest with 10^6 (about 1.5 times the binary heap there); traces
+  keep far fewer than 10^6 jobs waiting at once, so the common case decides. MLFQ orders its jobs by
+  boost epoch before level, which outgrows the keys of a bucket queue; it gets a pairing heap too,
+  about 1.3 times faster than the binary heap on traces of 2*10^5 and 10^6 jobs. */
+	switch(scheme)
+	{
+	  case FCFS:
+		case RR:
+			priqueue_init_backend(&scheduler->job_queue, FCFScompare, PRIQUEUE_FIFO_RING, NULL);
+			break;
+		case SJF:
+		case PSJF:
+			priqueue_init_backend(&scheduler->job_queue, SJFcompare, PRIQUEUE_PAIRING_HEAP, NULL);
+			break;
+		case PRI:
+		case PPRI:
+			priqueue_init_backend(&scheduler->job_queue, PRIcompare, PRIQUEUE_BUCKET_QUEUE, PRIkey);
+			break;
+		case MLFQ:
+			priqueue_init_backend(&scheduler->job_queue, MLFQcompare, PRIQUEUE_PAIRING_HEAP, NULL);
+			break;
+		case CFS:
+			priqueue_init_backend(&scheduler->job_queue, CFScompare, PRIQUEUE_BINARY_HEAP, NULL);
+			break;
+		case EDF:
+		case PEDF:
+			priqueue_init_backend(&scheduler->job_queue, EDFcompare, PRIQUEUE_BINARY_HEAP, NULL);
+			break;
+	}
+  return scheduler;
+}
+
+/**
+  Sets the levels of an MLFQ scheduler before it gets its first job. By default there are three
+  levels with quanta of 2, 4 and 8 and a boost every 100 time units.
+
+  @param scheduler the scheduler.
+  @param levels the number of levels, from 1 to MLFQ_MAX_LEVELS.
+  @param quanta the quantum of each level, from the top level down. Each must be positive.
+  @param boost_interval the time between two priority boosts, or 0 for no boosts.
+  @return 0, or -1 if the levels are not valid.
+*/
+int scheduler_set_mlfq_r(scheduler_t *scheduler, int levels, const int *quanta, int boost_interval)
+{
+  if( levels < 1 || levels > MLFQ_MAX_LEVELS || boost_interval < 0 )
+  {
+    return -1;
+  }
+  for(int i = 0; i < levels; i++)
+  {
+    if( quanta[i] <= 0 )
+    {
+      return -1;
+    }
+  }
+
+  scheduler->mlfq_levels = levels;
+  memcpy( scheduler->mlfq_quanta, quanta, levels * sizeof(int) );
+  scheduler->boost_interval = boost_interval;
+  scheduler->next_boost = boost_interval;
+  return 0;
+}
+
+/**
+  Initalizes the scheduler used by the scheduler_*() functions that take no scheduler_t.
+ 
+  Assumptions:
+    - You may assume this will be the first scheduler function called.
+    - You may assume this function will be called once once.
+    - You may assume that cores is a positive, non-zero number.
+    - You may assume that scheme is a valid scheduling scheme.
+
+  @param cores the number of cores that is available by the scheduler. These cores will be known as core(id=0), core(id=1), ..., core(id=cores-1).
+  @param scheme  the scheduling scheme that should be used. This value will be one of the six enum values of scheme_t
+*/
+void scheduler_start_up(int cores, scheme_t scheme)
+{
+  scheduler_ptr = scheduler_create( cores, scheme, 0 );
+}
+
+/**
+ * Returns the lowest idle core.
+ * 
+ * @return The function `idleCore()` returns the index of an idle core (a core that does not currently
+ * have any job running on it). If there are several, it returns the lowest index. If there are
+ * no idle cores, the function returns -1.
+ */
+int idleCore(scheduler_t *scheduler)
+{
+  /* The lowest set bit of `idle_words` gives the first word of `idle_cores` with an idle core, and
+  the lowest set bit of that word gives the core. */
+  int summary_words = ((scheduler->core_count + 63) / 64 + 63) / 64;
+  for(int i = 0; i < summary_words; i++)
+	{
+		if( scheduler->idle_words[i] != 0 )
+		{
+      int word = i * 64 + __builtin_ctzll( scheduler->idle_words[i] );
+			return word * 64 + __builtin_ctzll( scheduler->idle_cores[word] );
+		}
+	}
+	return -1;
+}
+
+/**
+ * Tells whether the scheme keeps the jobs on the cores in `running_jobs`.
+ *
+ * @param scheduler the scheduler.
+ *
+ * @return 1 under PSJF, PPRI, MLFQ and PEDF, 0 otherwise.
+ */
+int hasRunningJobs(scheduler_t *scheduler)
+{
+  const scheme_t scheme = scheduler->scheduler_scheme;
+  return scheme == PSJF || scheme == PPRI || scheme == MLFQ || scheme == PEDF;
+}
+
+/**
+ * Puts a job on an idle core: records it on the core, marks the core busy and, under the preemptive
+ * schemes, adds the job to the running jobs.
+ *
+ * @param scheduler the scheduler.
+ * @param core_id the core.
+ * @param job the job.
+ */
+void placeJob(scheduler_t *scheduler, int core_id, job_t *job)
+{
+  int word = core_id / 64;
+  scheduler->current_jobs_on_cores[core_id] = job;
+  job->core = core_id;
+  job->level_start = job->last_start_time;
+
+  /* A job that was boosted while it waited starts over on the top level. */
+  if( job->boost_epoch != scheduler->boosts )
+  {
+    job->boost_epoch = scheduler->boosts;
+    job->level = 0;
+    job->level_used = 0;
+  }
+
+  /* Under CFS the job gets a share of the target latency in proportion to its weight. Every core
+  serves its share of the waiting jobs, so the share is taken over the weight per core. */
+  if( scheduler->scheduler_scheme == CFS )
+  {
+    long long slice = scheduler->latency * (long long) job->weight * scheduler->core_count / scheduler->total_weight;
+    job->slice = slice < 1 ? 1 : slice > scheduler->latency ? scheduler->latency : (int) slice;
+    if( job->vruntime > scheduler->min_vruntime )
+    {
+      scheduler->min_vruntime = job->vruntime;
+    }
+  }
+
+  scheduler->idle_cores[word] &= ~(1ULL << (core_id % 64));
+  if( scheduler->idle_cores[word] == 0 )
+  {
+    scheduler->idle_words[word / 64] &= ~(1ULL << (word % 64));
+  }
+
+  if( hasRunningJobs( scheduler ) )
+  {
+    job->running_handle = priqueue_offer_handle( &scheduler->running_jobs, job );
+  }
+}
+
+/**
+ * Takes the job off a core, the reverse of placeJob().
+ *
+ * @param scheduler the scheduler.
+ * @param core_id the core.
+ *
+ * @return the job that was on the core.
+ */
+job_t *takeJob(scheduler_t *scheduler, int core_id)
+{
+  int word = core_id / 64;
+  job_t *job = scheduler->current_jobs_on_cores[core_id];
+  scheduler->current_jobs_on_cores[core_id] = NULL;
+  job->core = -1;
+
+  scheduler->idle_cores[word] |= 1ULL << (core_id % 64);
+  scheduler->idle_words[word / 64] |= 1ULL << (word % 64);
+
+  if( hasRunningJobs( scheduler ) )
+  {
+    priqueue_remove_handle( &scheduler->running_jobs, job->running_handle );
+  }
+  return job;
+}
+
+/**
+ * Charges a job that leaves its core for the time it ran there: its used time, under MLFQ the time it
+ * used at its level, moving it down a level once it used up the quantum of the level, and under CFS
+ * its virtual runtime.
+ *
+ * @param scheduler the scheduler.
+ * @param job the job, taken off its core.
+ * @param time the current time of the simulator.
+ */
+void chargeJob(scheduler_t *scheduler, job_t *job, int time)
+{
+  job->used_time += ( time - job->last_start_time );
+
+  if( scheduler->scheduler_scheme == MLFQ )
+  {
+    job->level_used += ( time - job->level_start );
+    if( job->level_used >= scheduler->mlfq_quanta[job->level] )
+    {
+      if( job->level < scheduler->mlfq_levels - 1 )
+      {
+        job->level++;
+      }
+      job->level_used = 0;
+    }
+  }
+  else if( scheduler->scheduler_scheme == CFS )
+  {
+    job->vruntime += (long long)( time - job->last_start_time ) * CFS_NICE_0_WEIGHT * CFS_VRUNTIME_SCALE / job->weight;
+  }
+}
+
+/**
+ * Under MLFQ, moves every job back to the top level if a priority boost is due. Boosts are only made
+ * when the scheduler is called, so one that falls between two calls happens at the second.
+ *
+ * @param scheduler the scheduler.
+ * @param time the current time of the simulator.
+ */
+void boostJobs(scheduler_t *scheduler, int time)
+{
+  if( scheduler->scheduler_scheme != MLFQ || scheduler->boost_interval == 0 || time < scheduler->next_boost )
+  {
+    return;
+  }
+  scheduler->next_boost = time - time % scheduler->boost_interval + scheduler->boost_interval;
+
+  /* The waiting jobs are not touched: starting a new epoch puts them ahead of every job queued from
+  now on, and placeJob() moves each one to the top level when it gets a core. */
+  scheduler->boosts++;
+
+  /* The jobs on the cores start their new allotment now. */
+  for(int i = 0; i < scheduler->core_count; i++)
+  {
+    job_t *job = scheduler->current_jobs_on_cores[i];
+    if( job != NULL )
+    {
+      job->boost_epoch = scheduler->boosts;
+      job->level = 0;
+      job->level_used = 0;
+      job->level_start = time;
+      priqueue_update_key( &scheduler->running_jobs, job->running_handle );
+    }
+  }
+}
+
+/**
+ * The function returns the index of the core with the longest remaining job, prioritizing the job with 
+ * the latest arrival time in case of a tie, then the lowest core.
+ * 
+ * @return the index of the core with the longest remaining job, or -1 if no core is busy.
+ */
+int findLongestRemainingJob(scheduler_t *scheduler)
+{
+  job_t *job = priqueue_peek( &scheduler->running_jobs );
+  return job ? job->core : -1;
+}
+
+/**
+ * Finds the core with the worst priority job, prioritizing the job with the latest arrival time in
+ * case of a tie, then the lowest core.
+ * 
+ * @return the index of the core with the worst priority job, or -1 if no core is busy.
+ */
+int findWorstPriorityJob(scheduler_t *scheduler)
+{
+  job_t *job = priqueue_peek( &scheduler->running_jobs );
+  return job ? job->core : -1;
+}
+
+/**
+  Called when a new job arrives.
+ 
+  If multiple cores are idle, the job should be assigned to the core with the
+  lowest id.
+  If the job arriving should be scheduled to run during the next
+  time cycle, return the zero-based index of the core the job should be
+  scheduled on. If another job is already running on the core specified,
+  this will preempt the currently running job.
+  Assumption:
+    - You may assume that every job wil have a unique arrival time.
+
+  @param scheduler the scheduler.
+  @param job_number a globally unique identification number of the job arriving.
+  @param time the current time of the simulator.
+  @param running_time the total number of time units this job will run before it will be finished.
+  @param priority the priority of the job. (The lower the value, the higher the priority.)
+  @return index of core job should be scheduled on
+  @return -1 if no scheduling changes should be made. 
+ 
+ */
+int scheduler_new_job_r(scheduler_t *scheduler, int job_number, int time, int running_time, int priority)
+{
+  return scheduler_new_deadline_job_r( scheduler, job_number, time, running_time, priority, NO_DEADLINE );
+}
+
+
+/**
+  Called when a new job with a deadline arrives, as scheduler_new_job_r(). EDF and PEDF schedule by
+  the deadline; every scheme counts the jobs that miss theirs.
+
+  @param scheduler the scheduler.
+  @param job_number a globally unique identification number of the job arriving.
+  @param time the current time of the simulator.
+  @param running_time the total number of time units this job will run before it will be finished.
+  @param priority the priority of the job. (The lower the value, the higher the priority.)
+  @param deadline the time by which the job should finish, or NO_DEADLINE (any negative value).
+  @return index of core job should be scheduled on
+  @return -1 if no scheduling changes should be made.
+ */
+int scheduler_new_deadline_job_r(scheduler_t *scheduler, int job_number, int time, int running_time, int priority, int deadline)
+{
+  /* Allocating memory for a job_t structure using the calloc function. Setting the memory to zero 
+  and returning a pointer to the allocated memory. */
+  job_t* job = calloc( 1, sizeof(job_t));
+  job->pid = job_number;
+  job->arrival_time = time;
+  job->priority = priority;
+  job->total_time_needed = running_time;
+  job->used_time = 0;
+  job->last_start_time = 0;
+  job->job_response_time = 0;
+  job->core = -1;
+  job->deadline = deadline < 0 ? NO_DEADLINE : deadline;
+  const scheme_t scheme = scheduler->scheduler_scheme;
+  boostJobs( scheduler, time );
+  job->boost_epoch = scheduler->boosts;
+
+  /* Under CFS a new job joins at the current minimum virtual runtime, so it neither starves the
+  others nor waits for the time they already ran. */
+  if( scheme == CFS )
+  {
+    int nice = priority < -20 ? -20 : priority > 19 ? 19 : priority;
+    job->weight = cfs_weights[nice + 20];
+    job->vruntime = scheduler->min_vruntime;
+    scheduler->total_weight += job->weight;
+  }
+  //either schedule it or place it in the queue;
+
+  int first_core = idleCore( scheduler );
+  /* Checking if the variable "first_core" is not equal to -1. If it is not equal to -1, it assigns
+  the job to the current_jobs_on_cores array at the index specified by first_core. It also sets the 
+  last_start_time of the job to the value of time. Finally, it returns the value of first_core. */
+  if( first_core != -1 )
+  {
+    job->last_start_time = time;
+    placeJob( scheduler, first_core, job );
+    return first_core;
+  }
+  /* Checking if the current scheduling scheme is PSJF. If it is, the code finds the longest remaining 
+  job on the cores and calculates its current remaining time. If the current remaining time of the longest 
+  job is less than or equal to the total time needed for the new job, the new job is added to the job queue 
+  with a higher priority. */
+  if( scheme == PSJF )
+  {
+    int longest_job = findLongestRemainingJob( scheduler );
+    int longest_job_last_remaining_time = remainingTime( scheduler->current_jobs_on_cores[longest_job] );
+    int longest_job_current_remaining_time = longest_job_last_remaining_time - ( time - scheduler->current_jobs_on_cores[longest_job]->last_start_time );
+
+    if( longest_job_current_remaining_time <=  job->total_time_needed )
+    {
+      // all jobs on cores have lower times, thus higher priority, add this one to queue
+      priqueue_offer ( &scheduler->job_queue, job );
+      return -1;
+    }
+    else
+    {
+      //remove old
+      job_t *old_job = takeJob( scheduler, longest_job );
+      //log how much time it used
+      chargeJob( scheduler, old_job, time );
+      //replace with new
+      job->last_start_time = time;
+      placeJob( scheduler, longest_job, job );
+      //push old to queue
+      priqueue_offer ( &scheduler->job_queue, old_job );
+      return longest_job;
+    }
+  }
+  /* Checks if a job has a higher priority than the current jobs on the cores, and either adds it to the 
+  queue or replaces the lowest priority job on a core with the new job. */
+  else if( scheme == PPRI )
+  {
+    int worst_priority_idx =  findWorstPriorityJob( scheduler );
+    /* Checking if the priority of the current job on the worst priority index core is less than or
+    equal to the priority of the new job. If it is, then the new job is added to the job queue and -1 
+    is returned. */
+    if( scheduler->current_jobs_on_cores[worst_priority_idx]->priority <= job->priority )
+    {
+      // all jobs on cores have lower times, thus higher priority, add this one to queue
+      priqueue_offer ( &scheduler->job_queue, job );
+      return -1;
+    }
+    else
+    {
+      //remove old
+      job_t *old_job = takeJob( scheduler, worst_priority_idx );
+      //log how much time it used
+      chargeJob( scheduler, old_job, time );
+      //replace with new
+      job->last_start_time = time;
+      placeJob( scheduler, worst_priority_idx, job );
+      //push old to queue
+      priqueue_offer ( &scheduler->job_queue, old_job );
+      return worst_priority_idx;
+    }
+  }
+  /* Under MLFQ the new job enters the top level, so it preempts the job on the lowest level if that
+  job is below the top level. */
+  else if( scheme == MLFQ )
+  {
+    job_t *lowest_job = priqueue_peek( &scheduler->running_jobs );
+    if( lowest_job->level <= job->level )
+    {
+      priqueue_offer ( &scheduler->job_queue, job );
+      return -1;
+    }
+    else
+    {
+      int lowest_level_idx = lowest_job->core;
+      job_t *old_job = takeJob( scheduler, lowest_level_idx );
+      chargeJob( scheduler, old_job, time );
+      job->last_start_time = time;
+      placeJob( scheduler, lowest_level_idx, job );
+      priqueue_offer ( &scheduler->job_queue, old_job );
+      return lowest_level_idx;
+    }
+  }
+  /* Under PEDF the new job preempts the job with the latest deadline if its own is earlier. */
+  else if( scheme == PEDF )
+  {
+    job_t *latest_job = priqueue_peek( &scheduler->running_jobs );
+    if( EDFcompare( latest_job, job ) <= 0 )
+    {
+      priqueue_offer ( &scheduler->job_queue, job );
+      return -1;
+    }
+    else
+    {
+      int latest_deadline_idx = latest_job->core;
+      job_t *old_job = takeJob( scheduler, latest_deadline_idx );
+      chargeJob( scheduler, old_job, time );
+      job->last_start_time = time;
+      placeJob( scheduler, latest_deadline_idx, job );
+      priqueue_offer ( &scheduler->job_queue, old_job );
+      return latest_deadline_idx;
+    }
+  }
+  /* If the scheme is RR, PRI, FCFS, SJF, CFS or EDF and the first core is not assigned, the job is added to
+  the job queue. CFS does not preempt on arrival: the new job gets its turn when a time slice ends. */
+  else if( scheme == RR || scheme == PRI || scheme == FCFS || scheme == SJF || scheme == CFS || scheme == EDF )
+  {
+    if( first_core == -1 )
+    {
+      priqueue_offer ( &scheduler->job_queue, job);
+    }
+  }
+  return -1;
+}
+
+
+/**
+  Called when a job has completed execution.
+ 
+  The core_id, job_number and time parameters are provided for convenience. 
+  You may be able to calculate the values with your own data structure.
+  If any job should be scheduled to run on the core freed up by the
+  finished job, return the job_number of the job that should be scheduled to
+  run on core core_id.
+ 
+  @param scheduler the scheduler.
+  @param core_id the zero-based index of the core where the job was located.
+  @param job_number a globally unique identification number of the job.
+  @param time the current time of the simulator.
+  @return job_number of the job that should be scheduled to run on core core_id
+  @return -1 if core should remain idle.
+ */
+int scheduler_job_finished_r(scheduler_t *scheduler, int core_id, int job_number, int time)
+{
+  boostJobs( scheduler, time );
+  job_t *old_job = takeJob( scheduler, core_id );
+  if( scheduler->scheduler_scheme == CFS )
+  {
+    scheduler->total_weight -= old_job->weight;
+  }
+  scheduler->total_jobs_count++;
+  scheduler->total_wait_time += (time - old_job->arrival_time - old_job->total_time_needed);
+  scheduler->total_turn_around_time += (time - old_job->arrival_time);
+  scheduler->total_response_time += old_job->job_response_time;
+  if( old_job->deadline != NO_DEADLINE )
+  {
+    int lateness = time - old_job->deadline;
+    if( scheduler->deadline_jobs_count == 0 || lateness > scheduler->max_lateness )
+    {
+      scheduler->max_lateness = lateness;
+    }
+    scheduler->deadline_jobs_count++;
+    scheduler->deadline_misses += lateness > 0;
+    scheduler->total_lateness += lateness;
+  }
+  free( old_job );
+
+  // Check for a new job
+  job_t *new_job = priqueue_poll( &scheduler->job_queue );
+  if( !new_job )
+  {
+    return -1;
+  }
+  /* Checking if a new job has been scheduled for execution on a core. If the job has not been 
+  scheduled before, it updates the response time of the job. Then, it places the job on a core 
+  and updates its last start time. Finally, it returns the process ID of the job. */
+  else
+  {
+    if( 0 == new_job->used_time )
+    {
+      // this is the first time we have scheduled it, update response time as such.
+      new_job->job_response_time = ( time - new_job->arrival_time );
+    }
+    // place it on a core, and update its last start time
+    new_job->last_start_time = time;
+    placeJob( scheduler, core_id, new_job );
+    return new_job->pid;
+	}
+}
+
+
+/**
+  When the scheme is set to RR, MLFQ or CFS, called when the time slice given by
+  scheduler_time_slice_r() has expired on a core.
+ 
+  If any job should be scheduled to run on the core free'd up by
+  the quantum expiration, return the job_number of the job that should be
+  scheduled to run on core core_id.
+
+  @param scheduler the scheduler.
+  @param core_id the zero-based index of the core where the quantum has expired.
+  @param time the current time of the simulator. 
+  @return job_number of the job that should be scheduled on core cord_id
+  @return -1 if core should remain idle
+ */
+int scheduler_quantum_expired_r(scheduler_t *scheduler, int core_id, int time)
+{
+  boostJobs( scheduler, time );
+  job_t *old = takeJob( scheduler, core_id );
+  chargeJob( scheduler, old, time );
+  priqueue_offer( &scheduler->job_queue, old);
+
+  /* Using the priqueue_poll function to remove and return the highest priority job from the
+  job_queue of the scheduler. If there is no job in the queue, it returns -1. */
+  job_t *new = priqueue_poll(&scheduler->job_queue);
+  if( !new )
+  {
+    return -1;
+  }
+  /* Checking if a job has been scheduled for the first time or not. If it is the first time, it
+  updates the response time of the job. Then, it updates the start time of the job and assigns it
+  to a specific core in the scheduler's data structure. Finally, it returns the process ID of the job.*/
+  else
+  {
+    if( 0 == new->used_time )
+    {
+      // this is the first time we have scheduled it, update response time as such.
+      new->job_response_time = ( time - new->arrival_time );
+    }
+    new->last_start_time = time;
+    placeJob( scheduler, core_id, new );
+    return new->pid;
+  }
+}
+
+
+/**
+  Returns how long the job on a core may run before scheduler_quantum_expired_r() should be called:
+  the quantum under RR, what is left of the quantum of its level under MLFQ, and its share of the
+  target latency under CFS. The value holds from the time the job was put on the core.
+
+  @param scheduler the scheduler.
+  @param core_id the zero-based index of the core.
+  @return the time slice, or 0 if the job runs until it finishes or is preempted.
+ */
+int scheduler_time_slice_r(scheduler_t *scheduler, int core_id)
+{
+  job_t *job = scheduler->current_jobs_on_cores[core_id];
+  if( job == NULL )
+  {
+    return 0;
+  }
+
+  switch( scheduler->scheduler_scheme )
+  {
+    case RR:
+      return scheduler->quantum;
+    case MLFQ:
+      return scheduler->mlfq_quanta[job->level] - job->level_used;
+    case CFS:
+      return job->slice;
+    default:
+      return 0;
+  }
+}
+
+
+/**
+  Returns the average waiting time of all jobs scheduled by your scheduler.
+
+  Assumptions:
+    - This function will only be called after all scheduling is complete (all jobs that have arrived 
+    will have finished and no new jobs will arrive).
+  @param scheduler the scheduler.
+  @return the average waiting time of all jobs scheduled.
+ */
+float scheduler_average_waiting_time_r(scheduler_t *scheduler)
+{
+  /* Calculating average wait time for jobs in a scheduler. It first checks if the total number of
+  jobs in the scheduler is 0. If it is, it returns 0. Otherwise, it calculates the average wait time
+  by dividing the total wait time by the total number of jobs and returns the result as a float. */
+  if(scheduler->total_jobs_count == 0) 
+  {
+		return 0;
+  }
+	else
+  {
+		return (float)scheduler->total_wait_time/(float)scheduler->total_jobs_count;
+  }
+}
+
+
+/**
+  Returns the average turnaround time of all jobs scheduled by your scheduler.
+
+  Assumptions:
+    - This function will only be called after all scheduling is complete (all jobs that have arrived 
+    will have finished and no new jobs will arrive).
+  @param scheduler the scheduler.
+  @return the average turnaround time of all jobs scheduled.
+ */
+float scheduler_average_turnaround_time_r(scheduler_t *scheduler)
+{
+  /* Calculating the average turnaround time for a scheduler. It first checks if the total number of
+  jobs in the scheduler is 0. If it is, it returns 0.0. Otherwise, it calculates the average
+  turnaround time by dividing the total turnaround time by the total number of jobs, and returns the
+  result as a float. */
+  if(scheduler->total_jobs_count == 0) 
+  {
+    return 0.0;
+  }
+  else
+  {
+    return (float)scheduler->total_turn_around_time/(float)scheduler->total_jobs_count;
+  }
+}
+
+
+/**
+  Returns the average response time of all jobs scheduled by your scheduler.
+
+  Assumptions:
+    - This function will only be called after all scheduling is complete (all jobs that have arrived 
+    will have finished and no new jobs will arrive).
+  @param scheduler the scheduler.
+  @return the average response time of all jobs scheduled.
+ */
+float scheduler_average_response_time_r(scheduler_t *scheduler)
+{
+  /* Calculating the average response time of a scheduler. It checks if the total number of jobs
+  in the scheduler is zero. If it is zero, it returns 0.0. Otherwise, it calculates the average
+  response time by dividing the total response time by the total number of jobs and returns the
+  result as a float. */
+  if(scheduler->total_jobs_count == 0)
+  {
+		return 0.0;
+  }
+	else
+  {
+		return (float)scheduler->total_response_time/(float)scheduler->total_jobs_count;
+  }
+}  
+
+
+/**
+  Returns the number of jobs that finished after their deadline.
+
+  @param scheduler the scheduler.
+  @return the number of deadline misses.
+ */
+int scheduler_deadline_misses_r(scheduler_t *scheduler)
+{
+  return scheduler->deadline_misses;
+}
+
+
+/**
+  Returns the average lateness of the jobs that had a deadline: the time they finished after it,
+  negative if they finished early.
+
+  @param scheduler the scheduler.
+  @return the average lateness, or 0 if no job had a deadline.
+ */
+float scheduler_average_lateness_r(scheduler_t *scheduler)
+{
+  if( scheduler->deadline_jobs_count == 0 )
+  {
+    return 0.0;
+  }
+  return (float)scheduler->total_lateness/(float)scheduler->deadline_jobs_count;
+}
+
+
+/**
+  Returns the largest lateness of the jobs that had a deadline.
+
+  @param scheduler the scheduler.
+  @return the maximum lateness, or 0 if no job had a deadline.
+ */
+int scheduler_maximum_lateness_r(scheduler_t *scheduler)
+{
+  return scheduler->max_lateness;
+}
+
+
+/**
+  Frees a scheduler and the jobs it still holds.
+
+  @param scheduler the scheduler.
+*/
+void scheduler_destroy(scheduler_t *scheduler)
+{
+  job_t *job;
+  while( (job = priqueue_poll( &scheduler->job_queue )) != NULL )
+  {
+    free( job );
+  }
+  for(int i = 0; i < scheduler->core_count; i++)
+  {
+    free( scheduler->current_jobs_on_cores[i] );
+  }
+  priqueue_destroy( &scheduler->job_queue );
+  if( hasRunningJobs( scheduler ) )
+  {
+    priqueue_destroy( &scheduler->running_jobs );
+  }
+	free( scheduler->current_jobs_on_cores );
+	free( scheduler->idle_cores );
+	free( scheduler->idle_words );
+	free( scheduler );
+}
+
+
+/**
+  Free any memory associated with your scheduler.
+ 
+  Assumption:
+    - This function will be the last function called in your library.
+*/
+void scheduler_clean_up()
+{
+  scheduler_destroy( scheduler_ptr );
+  scheduler_ptr = NULL;
+}
+
+
+/**
+  This function may print out any debugging information you choose. This function will be called 
+  by the simulator after every call the simulator makes to your scheduler.
+
+  In our provided output, we have implemented this function to list the jobs in the order they 
+  are to be scheduled.  Furthermore, we have also listed the current state of the job (either 
+  running on a given core or idle).  For example, if we have a non-preemptive algorithm and job(id=4) 
+  has began running, job(id=2) arrives with a higher priority, and job(id=1) arrives with a lower 
+  priority, the output in our sample output will be:
+
+    2(-1) 4(0) 1(-1)  
+  
+  This function is not required and will not be graded. You may leave it
+  blank if you do not find it useful.
+
+  @param scheduler the scheduler.
+ */
+void scheduler_show_queue_r(scheduler_t *scheduler)
+{
+
+}
+
+
+/*
+  The scheduler_*() functions below run on the scheduler created by scheduler_start_up(); see
+  their scheduler_*_r() counterparts above.
+ */
+
+int scheduler_new_job(int job_number, int time, int running_time, int priority)
+{
+  return scheduler_new_job_r( scheduler_ptr, job_number, time, running_time, priority );
+}
+
+int scheduler_new_deadline_job(int job_number, int time, int running_time, int priority, int deadline)
+{
+  return scheduler_new_deadline_job_r( scheduler_ptr, job_number, time, running_time, priority, deadline );
+}
+
+int scheduler_job_finished(int core_id, int job_number, int time)
+{
+  return scheduler_job_finished_r( scheduler_ptr, core_id, job_number, time );
+}
+
+int scheduler_quantum_expired(int core_id, int time)
+{
+  return scheduler_quantum_expired_r( scheduler_ptr, core_id, time );
+}
+
+int scheduler_time_slice(int core_id)
+{
+  return scheduler_time_slice_r( scheduler_ptr, core_id );
+}
+
+float scheduler_average_waiting_time()
+{
+  return scheduler_average_waiting_time_r( scheduler_ptr );
+}
+
+float scheduler_average_turnaround_time()
+{
+  return scheduler_average_turnaround_time_r( scheduler_ptr );
+}
+
+float scheduler_average_response_time()
+{
+  return scheduler_average_response_time_r( scheduler_ptr );
+}
+
+int scheduler_deadline_misses()
+{
+  return scheduler_deadline_misses_r( scheduler_ptr );
+}
+
+float scheduler_average_lateness()
+{
+  return scheduler_average_lateness_r( scheduler_ptr );
+}
+
+int scheduler_maximum_lateness()
+{
+  return scheduler_maximum_lateness_r( scheduler_ptr );
+}
+
+void scheduler_show_queue()
+{
+  scheduler_show_queue_r( scheduler_ptr );
+}
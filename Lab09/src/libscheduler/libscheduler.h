@@ -0,0 +1,67 @@
+/** @file libscheduler.h
+ */
+
+#ifndef LIBSCHEDULER_H_
+#define LIBSCHEDULER_H_
+
+/**
+  Constants which represent the different scheduling algorithms
+    - MLFQ: multi-level feedback queue. A new job enters the top level and preempts a job of a lower
+      level. A job that uses up the quantum of its level moves down one level, and every job goes
+      back to the top level at each priority boost. See scheduler_set_mlfq_r().
+    - CFS: fair scheduling on virtual runtime, in the style of the Linux CFS. The priority of a job
+      is its nice value (-20 to 19); the lower it is, the more of the cores the job gets.
+    - EDF, PEDF: earliest deadline first, without and with preemption. Jobs without a deadline run
+      after every job that has one. See scheduler_new_deadline_job_r().
+*/
+typedef enum {FCFS = 0, SJF, PSJF, PRI, PPRI, RR, MLFQ, CFS, EDF, PEDF} scheme_t;
+
+#define MLFQ_MAX_LEVELS 16
+#define MLFQ_DEFAULT_LEVELS 3
+#define MLFQ_DEFAULT_BOOST 100
+#define CFS_DEFAULT_LATENCY 8
+
+/* The deadline of a job that has none. */
+#define NO_DEADLINE -1
+
+/**
+  One independent scheduler. The scheduler_*_r() functions work on the scheduler they are given;
+  the others work on a single scheduler kept by the library, from scheduler_start_up() to
+  scheduler_clean_up().
+*/
+typedef struct _scheduler_t scheduler_t;
+
+scheduler_t *scheduler_create          (int cores, scheme_t scheme, int quantum);
+int   scheduler_set_mlfq_r             (scheduler_t *scheduler, int levels, const int *quanta, int boost_interval);
+int   scheduler_time_slice_r           (scheduler_t *scheduler, int core_id);
+int   scheduler_new_job_r              (scheduler_t *scheduler, int job_number, int time, int running_time, int priority);
+int   scheduler_new_deadline_job_r     (scheduler_t *scheduler, int job_number, int time, int running_time, int priority, int deadline);
+int   scheduler_job_finished_r         (scheduler_t *scheduler, int core_id, int job_number, int time);
+int   scheduler_quantum_expired_r      (scheduler_t *scheduler, int core_id, int time);
+float scheduler_average_turnaround_time_r(scheduler_t *scheduler);
+float scheduler_average_waiting_time_r   (scheduler_t *scheduler);
+float scheduler_average_response_time_r  (scheduler_t *scheduler);
+int   scheduler_deadline_misses_r        (scheduler_t *scheduler);
+float scheduler_average_lateness_r       (scheduler_t *scheduler);
+int   scheduler_maximum_lateness_r       (scheduler_t *scheduler);
+void  scheduler_destroy                (scheduler_t *scheduler);
+
+void  scheduler_show_queue_r           (scheduler_t *scheduler);
+
+void  scheduler_start_up               (int cores, scheme_t scheme);
+int   scheduler_new_job                (int job_number, int time, int running_time, int priority);
+int   scheduler_new_deadline_job       (int job_number, int time, int running_time, int priority, int deadline);
+int   scheduler_job_finished           (int core_id, int job_number, int time);
+int   scheduler_quantum_expired        (int core_id, int time);
+int   scheduler_time_slice             (int core_id);
+float scheduler_average_turnaround_time();
+float scheduler_average_waiting_time   ();
+float scheduler_average_response_time  ();
+int   scheduler_deadline_misses        ();
+float scheduler_average_lateness       ();
+int   scheduler_maximum_lateness       ();
+void  scheduler_clean_up               ();
+
+void  scheduler_show_queue             ();
+
+#endif /* LIBSCHEDULER_H_ */
@@ -0,0 +1,385 @@
+/** @file queuetest.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "libpriqueue/libpriqueue.h"
+
+int compare1(const void * a, const void * b)
+{
+	return ( *(int*)a - *(int*)b );
+}
+
+int compare2(const void * a, const void * b)
+{
+	return ( *(int*)b - *(int*)a );
+}
+
+int compare_fifo(const void * a, const void * b)
+{
+	return -1;
+}
+
+int key1(const void * a)
+{
+	return *(int*)a;
+}
+
+int key2(const void * a)
+{
+	return -*(int*)a;
+}
+
+int key_fifo(const void * a)
+{
+	return 0;
+}
+
+/**
+  Prints the queue in priority order, as a check of priqueue_at().
+ */
+void print_queue(priqueue_t *q)
+{
+	int i;
+	printf("Elements in order queue (size %d):", priqueue_size(q));
+	for (i = 0; i < priqueue_size(q); i++)
+		printf(" %d", *((int *)priqueue_at(q, i)) );
+	printf("\n");
+}
+
+/**
+  Returns the current time of the monotonic clock in seconds.
+ */
+double now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+  Times n offers followed by n polls of pseudo-random keys, from 10^3 up to max_size elements.
+ */
+void benchmark(int max_size)
+{
+	int n;
+	printf("%10s %14s %14s\n", "elements", "offer ns/op", "poll ns/op");
+	for (n = 1000; n <= max_size; n *= 10)
+	{
+		int *values = malloc(n * sizeof(int));
+		unsigned int seed = 12345;
+		int i;
+		for (i = 0; i < n; i++)
+		{
+			seed = seed * 1103515245 + 12345;
+			values[i] = (seed >> 8) % 1000000;
+		}
+
+		priqueue_t q;
+		priqueue_init(&q, compare1);
+
+		double start = now();
+		for (i = 0; i < n; i++)
+			priqueue_offer(&q, &values[i]);
+		double offered = now();
+
+		int previous = -1, ordered = 1;
+		for (i = 0; i < n; i++)
+		{
+			int value = *(int *)priqueue_poll(&q);
+			if (value < previous)
+				ordered = 0;
+			previous = value;
+		}
+		double polled = now();
+
+		printf("%10d %14.1f %14.1f%s\n", n, (offered - start) * 1e9 / n, (polled - offered) * 1e9 / n,
+				ordered ? "" : "  (out of order!)");
+		priqueue_destroy(&q);
+		free(values);
+	}
+}
+
+
+/**
+  A queued job of the scheme benchmark: the key is the remaining time or the priority, and ties
+  are broken by arrival, as in the scheduler's comparers.
+ */
+typedef struct
+{
+	int key;
+	int arrival;
+} bench_job_t;
+
+int compare_job(const void * a, const void * b)
+{
+	const bench_job_t *x = a, *y = b;
+	if (x->key != y->key)
+		return x->key - y->key;
+	return x->arrival - y->arrival;
+}
+
+int key_job(const void * a)
+{
+	return ((const bench_job_t *)a)->key;
+}
+
+/**
+  Times the access pattern of one scheduling scheme on one backend: the queue holds size waiting
+  jobs, and every step polls the next job and offers a job back, as a core finishing a job or a
+  quantum expiring does. Keys are drawn from [0, key_range); a key_range of 0 means FCFS and RR,
+  where every job compares equal and leaves in arrival order.
+
+  @return ns per poll and offer pair; *checksum receives a hash of the order the jobs left in
+ */
+double bench_scheme(priqueue_backend_t backend, int size, int steps, int key_range, unsigned long *checksum)
+{
+	bench_job_t *jobs = malloc(size * sizeof(bench_job_t));
+	unsigned int seed = 12345;
+	int i, arrival = 0;
+	priqueue_t q;
+
+	if (key_range == 0)
+		priqueue_init_backend(&q, compare_fifo, backend, key_fifo);
+	else
+		priqueue_init_backend(&q, compare_job, backend, key_job);
+
+	for (i = 0; i < size; i++)
+	{
+		seed = seed * 1103515245 + 12345;
+		jobs[i].key = key_range ? (int)((seed >> 8) % key_range) : 0;
+		jobs[i].arrival = arrival++;
+		priqueue_offer(&q, &jobs[i]);
+	}
+
+	*checksum = 0;
+	double start = now();
+	for (i = 0; i < steps; i++)
+	{
+		bench_job_t *job = priqueue_poll(&q);
+		*checksum = *checksum * 31 + job->arrival;
+		seed = seed * 1103515245 + 12345;
+		job->key = key_range ? (int)((seed >> 8) % key_range) : 0;
+		job->arrival = arrival++;
+		priqueue_offer(&q, job);
+	}
+	double elapsed = now() - start;
+
+	priqueue_destroy(&q);
+	free(jobs);
+	return elapsed * 1e9 / steps;
+}
+
+/**
+  Runs bench_scheme() for every scheme and every backend that supports it, and checks that all
+  backends serve the jobs in the same order as the binary heap.
+ */
+void benchmark_backends(int steps)
+{
+	const char *schemes[] = { "FCFS/RR", "PRI/PPRI", "SJF/PSJF" };
+	/* Priorities are small integers; remaining times are spread wide. */
+	int key_ranges[] = { 0, 40, 1000000 };
+	int sizes[] = { 100, 10000, 1000000 };
+	int scheme, size, backend;
+
+	printf("%-10s %8s", "scheme", "waiting");
+	for (backend = 0; backend < PRIQUEUE_BACKEND_COUNT; backend++)
+		printf(" %13s", priqueue_backend_name(backend));
+	printf("   (ns per poll+offer)\n");
+
+	for (scheme = 0; scheme < 3; scheme++)
+	{
+		for (size = 0; size < 3; size++)
+		{
+			unsigned long expected = 0, checksum;
+			printf("%-10s %8d", schemes[scheme], sizes[size]);
+			for (backend = 0; backend < PRIQUEUE_BACKEND_COUNT; backend++)
+			{
+				if (backend == PRIQUEUE_FIFO_RING && key_ranges[scheme] != 0)
+				{
+					printf(" %13s", "-");
+					continue;
+				}
+				double ns = bench_scheme(backend, sizes[size], steps, key_ranges[scheme], &checksum);
+				if (backend == PRIQUEUE_BINARY_HEAP)
+					expected = checksum;
+				printf(" %12.1f%s", ns, checksum == expected ? " " : "!");
+			}
+			printf("\n");
+		}
+	}
+	printf("A '!' marks a backend that served the jobs in a different order than the binary heap.\n");
+}
+
+/**
+  Runs random offers, polls, handle removals and key updates against a plain array that is
+  searched for the smallest (key, offer order) on every poll.
+
+  @return 1 if every poll and every removal returned what the array expected
+ */
+int check_handles(priqueue_backend_t backend, int steps)
+{
+	enum { ITEMS = 500 };
+	int keys[ITEMS], handles[ITEMS], order[ITEMS];
+	int i, step, next_order = 0, ok = 1;
+	unsigned int seed = 777;
+	priqueue_t q;
+
+	priqueue_init_backend(&q, compare1, backend, key1);
+	for (i = 0; i < ITEMS; i++)
+		handles[i] = -1;
+
+	for (step = 0; step < steps && ok; step++)
+	{
+		seed = seed * 1103515245 + 12345;
+		int item = (seed >> 8) % ITEMS;
+		int action = (seed >> 20) % 4;
+		seed = seed * 1103515245 + 12345;
+		/* Keys past the last bucket check that the bucket queue clamps them in order. */
+		int key = (seed >> 8) % 300;
+
+		if (handles[item] < 0)
+		{
+			keys[item] = key;
+			order[item] = next_order++;
+			handles[item] = priqueue_offer_handle(&q, &keys[item]);
+		}
+		else if (action == 0)
+		{
+			ok = priqueue_remove_handle(&q, handles[item]) == &keys[item];
+			handles[item] = -1;
+		}
+		else if (action == 1)
+		{
+			keys[item] = key;
+			ok = priqueue_update_key(&q, handles[item]) >= 0;
+		}
+		else if (action == 2)
+		{
+			int best = -1;
+			for (i = 0; i < ITEMS; i++)
+				if (handles[i] >= 0 && (best < 0 || keys[i] < keys[best] || (keys[i] == keys[best] && order[i] < order[best])))
+					best = i;
+			if (best < 0)
+			{
+				ok = priqueue_poll(&q) == NULL;
+				continue;
+			}
+			ok = priqueue_poll(&q) == &keys[best];
+			handles[best] = -1;
+		}
+	}
+	priqueue_destroy(&q);
+	return ok;
+}
+
+/**
+  Runs the checks of the priqueue_t API on one backend. The ordered checks are skipped for the
+  FIFO ring, which only supports comparers that keep the order of insertion.
+ */
+void check_backend(priqueue_backend_t backend)
+{
+	priqueue_t q, q2, fifo;
+	int i, val;
+
+	printf("=== %s ===\n", priqueue_backend_name(backend));
+
+	/* Populate some data... */
+	int *values = malloc(100 * sizeof(int));
+	for (i = 0; i < 100; i++)
+		values[i] = i;
+
+	if (backend != PRIQUEUE_FIFO_RING)
+	{
+		priqueue_init_backend(&q, compare1, backend, key1);
+		priqueue_init_backend(&q2, compare2, backend, key2);
+
+		/* Add 5 values, 3 unique. */
+		priqueue_offer(&q, &values[12]);
+		priqueue_offer(&q, &values[13]);
+		priqueue_offer(&q, &values[14]);
+		priqueue_offer(&q, &values[12]);
+		priqueue_offer(&q, &values[12]);
+		printf("Total elements: %d (expected 5).\n", priqueue_size(&q));
+
+		val = *((int *)priqueue_poll(&q));
+		printf("Top element: %d (expected 12).\n", val);
+		printf("Total elements: %d (expected 4).\n", priqueue_size(&q));
+
+		int vals_removed = priqueue_remove(&q, &values[12]);
+		printf("Elements removed: %d (expected 2).\n", vals_removed);
+		printf("Total elements: %d (expected 2).\n", priqueue_size(&q));
+
+		priqueue_offer(&q, &values[10]);
+		priqueue_offer(&q, &values[30]);
+		priqueue_offer(&q, &values[20]);
+
+		priqueue_offer(&q2, &values[10]);
+		priqueue_offer(&q2, &values[30]);
+		priqueue_offer(&q2, &values[20]);
+
+		printf("Elements in order queue (expected 10 13 14 20 30): ");
+		for (i = 0; i < priqueue_size(&q); i++)
+			printf("%d ", *((int *)priqueue_at(&q, i)) );
+		printf("\n");
+
+		printf("Elements in reverse order queue (expected 30 20 10): ");
+		for (i = 0; i < priqueue_size(&q2); i++)
+			printf("%d ", *((int *)priqueue_at(&q2, i)) );
+		printf("\n");
+
+		val = *((int *)priqueue_remove_at(&q, 2));
+		printf("Removed at 2: %d (expected 14).\n", val);
+		print_queue(&q);
+
+		priqueue_destroy(&q2);
+		priqueue_destroy(&q);
+	}
+
+	/* A constant comparer must keep the order of insertion, also across a removal. */
+	priqueue_init_backend(&fifo, compare_fifo, backend, key_fifo);
+	int fifo_order[] = { 5, 3, 9, 1, 7, 3, 8 };
+	for (i = 0; i < 7; i++)
+		priqueue_offer(&fifo, &values[fifo_order[i]]);
+	priqueue_remove_at(&fifo, 4);
+	printf("FIFO order (expected 5 3 9 1 3 8): ");
+	while (priqueue_size(&fifo) > 0)
+		printf("%d ", *((int *)priqueue_poll(&fifo)) );
+	printf("\n");
+	printf("Poll of empty queue: %s (expected NULL).\n", priqueue_poll(&fifo) == NULL ? "NULL" : "not NULL");
+
+	priqueue_handle_t handle = priqueue_offer_handle(&fifo, &values[4]);
+	priqueue_offer(&fifo, &values[6]);
+	printf("Removed by handle: %d (expected 4).\n", *((int *)priqueue_remove_handle(&fifo, handle)) );
+	printf("Removed by stale handle: %s (expected NULL).\n", priqueue_remove_handle(&fifo, handle) == NULL ? "NULL" : "not NULL");
+	priqueue_destroy(&fifo);
+
+	if (backend != PRIQUEUE_FIFO_RING)
+		printf("Random handle operations: %s (expected ok).\n", check_handles(backend, 200000) ? "ok" : "FAILED");
+
+	free(values);
+}
+
+
+int main(int argc, char **argv)
+{
+	if (argc >= 2 && strcmp(argv[1], "--bench") == 0)
+	{
+		benchmark(argc >= 3 ? atoi(argv[2]) : 10000000);
+		return 0;
+	}
+	if (argc >= 2 && strcmp(argv[1], "--bench-backends") == 0)
+	{
+		benchmark_backends(argc >= 3 ? atoi(argv[2]) : 1000000);
+		return 0;
+	}
+
+	int backend;
+	for (backend = 0; backend < PRIQUEUE_BACKEND_COUNT; backend++)
+		check_backend(backend);
+
+	return 0;
+}
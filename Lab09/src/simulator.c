@@ -0,0 +1,2094 @@
+/*
+ * CS 241
+ * The University of Illinois
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "libscheduler/libscheduler.h"
+#include "libpriqueue/libpriqueue.h"
+
+
+typedef struct _simulator_job_list_t
+{
+	int job_id, arrival_time, run_time, priority;
+	int deadline;     // time by which the job should finish, or NO_DEADLINE
+	int core_id, arrived;
+} simulator_job_list_t;
+
+/*
+ * The levels of -s mlfq, for scheduler_set_mlfq_r().
+ */
+typedef struct _simulator_mlfq_t
+{
+	int levels;
+	int quanta[MLFQ_MAX_LEVELS];
+	int boost_interval;
+} simulator_mlfq_t;
+
+/* Set by -q: print the averages only, not the simulation as it runs. */
+int quiet = 0;
+
+void print_usage(char *program_name)
+{
+	fprintf(stderr, "Usage: %s [-e] [-S] [-q] -c <cores> -s <scheme> <input file>\n", program_name);
+	fprintf(stderr, "       %s -x [-j <threads>] -c <cores>[,<cores>...] -s <scheme>[,<scheme>...] <input file>\n", program_name);
+	fprintf(stderr, "       %s -w <binary trace> <input file>\n", program_name);
+	fprintf(stderr, "       %s -c 2 -s fcfs examples/proc1.csv\n", program_name);
+	fprintf(stderr, "       %s -x -c 1-8 -s fcfs,sjf,rr1,rr4 examples/proc1.csv\n", program_name);
+	fprintf(stderr, "\n");
+	fprintf(stderr, "Acceptable schemes are: fcfs, sjf, psjf, pri, ppri, rr#, mlfq[#/#/...][@#], cfs[#], edf, pedf\n");
+	fprintf(stderr, "  mlfq2/4/8@100  multi-level feedback queue with the quantum of each level and the time between priority boosts\n");
+	fprintf(stderr, "  cfs8           fair scheduling with a target latency of 8; the priority of a job is its nice value\n");
+	fprintf(stderr, "The input file is a CSV trace or a binary trace written by -w. A CSV trace whose header has a fourth\n");
+	fprintf(stderr, "column gives the deadline of each job in it, as a time unit; jobs that leave it empty have none.\n");
+	fprintf(stderr, "  -e  advance the simulation from event to event instead of scanning every job each time unit\n");
+	fprintf(stderr, "  -S  stream the trace into the simulation while reading it (implies -e; the trace must be sorted by arrival)\n");
+	fprintf(stderr, "  -w  convert the input file to a binary trace and exit\n");
+	fprintf(stderr, "  -q, --quiet  print the average times only\n");
+	fprintf(stderr, "  -x, --sweep  simulate every scheme with every number of cores, in parallel, and print the averages as CSV\n");
+	fprintf(stderr, "  -j  number of threads of -x (default: one per processor)\n");
+}
+
+/*
+ * Puts a job that arrived and did not finish on a core. position holds the index in jobs of each
+ * job id, -1 once the job finished, and core_job the job id on each core, -1 if idle. Returns 0 if
+ * job_id is not such a job.
+ */
+int set_active_job(int job_id, int core_id, simulator_job_list_t *jobs, int *position, int job_count, int *core_job)
+{
+	if (job_id < 0 || job_id >= job_count || position[job_id] == -1 || !jobs[position[job_id]].arrived)
+		return 0;
+
+	simulator_job_list_t *job = &jobs[position[job_id]];
+	if (job->core_id != -1)
+		core_job[job->core_id] = -1;
+
+	job->core_id = core_id;
+	core_job[core_id] = job_id;
+	return 1;
+}
+
+/*
+ * Starts the time slice the scheduler gave the job on a core: the clock counts the time units left
+ * until its quantum expires, and stays negative if the job runs until it finishes or is preempted.
+ */
+void start_time_slice(scheduler_t *scheduler, int *quantum_clock, int core_id)
+{
+	int slice = scheduler_time_slice_r(scheduler, core_id);
+	quantum_clock[core_id] = slice > 0 ? slice : -1;
+}
+
+void print_available_jobs(simulator_job_list_t *jobs, int active_jobs)
+{
+	printf("Active jobs are: ");
+
+	int i, first = 1;
+	for (i = 0; i < active_jobs; i++)
+	{
+		if (jobs[i].arrived)
+		{
+			if (first)
+			{
+				printf("%d", jobs[i].job_id);
+				first = 0;
+			}
+			else
+				printf(", %d", jobs[i].job_id);
+		}
+	}
+
+	if (!first)
+		printf("\n");
+}
+
+void print_available_cores(int cores)
+{
+	printf("Active cores are: ");
+
+	int i;
+	for (i = 0; i < cores; i++)
+	{
+		if (i == cores - 1)
+			printf("%d\n", i);
+		else
+			printf("%d, ", i);
+	}
+}
+
+/*
+ * printf() for the progress of the simulation, which -q leaves out.
+ */
+void print_progress(const char *format, ...)
+{
+	va_list args;
+
+	if (quiet)
+		return;
+
+	va_start(args, format);
+	vprintf(format, args);
+	va_end(args);
+}
+
+void print_queue(scheduler_t *scheduler)
+{
+	if (quiet)
+		return;
+
+	printf("  Queue: "); scheduler_show_queue_r(scheduler); printf("\n\n");
+}
+
+/*
+ * Parses the levels of "mlfq2/4/8@100": the quanta from the top level down, then the time between
+ * priority boosts, 0 for none. Either part can be left out. Returns 0, or -1 if they are not valid.
+ */
+int parse_mlfq(const char *spec, simulator_mlfq_t *mlfq)
+{
+	char *end;
+	int i;
+
+	mlfq->levels = MLFQ_DEFAULT_LEVELS;
+	for (i = 0; i < MLFQ_DEFAULT_LEVELS; i++)
+		mlfq->quanta[i] = 2 << i;
+	mlfq->boost_interval = MLFQ_DEFAULT_BOOST;
+
+	if (*spec != '\0' && *spec != '@')
+	{
+		for (mlfq->levels = 0; ; spec = end + 1)
+		{
+			long quantum = strtol(spec, &end, 10);
+			if (end == spec || quantum <= 0 || quantum > 1 << 20 || mlfq->levels == MLFQ_MAX_LEVELS)
+				return -1;
+			mlfq->quanta[mlfq->levels++] = quantum;
+			if (*end != '/')
+				break;
+		}
+		spec = end;
+	}
+
+	if (*spec == '@')
+	{
+		long boost_interval = strtol(spec + 1, &end, 10);
+		if (end == spec + 1 || boost_interval < 0 || boost_interval > 1 << 30)
+			return -1;
+		mlfq->boost_interval = boost_interval;
+		spec = end;
+	}
+
+	return *spec == '\0' ? 0 : -1;
+}
+
+/*
+ * Writes the levels of an MLFQ scheme back in the form parse_mlfq() reads into name, which must
+ * hold 16 characters per level.
+ */
+void format_mlfq(char *name, const simulator_mlfq_t *mlfq)
+{
+	int i;
+
+	name += sprintf(name, "mlfq");
+	for (i = 0; i < mlfq->levels; i++)
+		name += sprintf(name, i == 0 ? "%d" : "/%d", mlfq->quanta[i]);
+	sprintf(name, "@%d", mlfq->boost_interval);
+}
+
+/*
+ * Parses a scheme name such as "fcfs", "rr2", "mlfq2/4/8@100" or "cfs8". The levels of MLFQ go
+ * into mlfq. Returns 0, or -1 if the name is not a scheme.
+ */
+int parse_scheme(const char *name, int *scheme, int *quantum, simulator_mlfq_t *mlfq)
+{
+	if (strcasecmp(name, "FCFS") == 0) { *scheme = FCFS; }
+	else if (strcasecmp(name, "SJF") == 0) { *scheme = SJF; }
+	else if (strcasecmp(name, "PSJF") == 0) { *scheme = PSJF; }
+	else if (strcasecmp(name, "PRI") == 0) { *scheme = PRI; }
+	else if (strcasecmp(name, "PPRI") == 0) { *scheme = PPRI; }
+	else if (strcasecmp(name, "EDF") == 0) { *scheme = EDF; }
+	else if (strcasecmp(name, "PEDF") == 0) { *scheme = PEDF; }
+	else if (strncasecmp(name, "RR", 2) == 0)
+	{
+		*scheme = RR;
+		*quantum = atoi(name + 2);
+	}
+	else if (strncasecmp(name, "MLFQ", 4) == 0)
+	{
+		*scheme = MLFQ;
+		return parse_mlfq(name + 4, mlfq);
+	}
+	else if (strncasecmp(name, "CFS", 3) == 0)
+	{
+		// A latency of 0 leaves the default of the scheduler.
+		*scheme = CFS;
+		*quantum = atoi(name + 3);
+		if (*quantum < 0)
+			return -1;
+	}
+	else
+		return -1;
+
+	return 0;
+}
+
+/*
+ * Writes the label of a job in the timing diagram into label, which must hold 11 characters.
+ */
+void format_job_label(char *label, int job_id)
+{
+	if (job_id < 10)
+		sprintf(label, "%d", job_id);
+	else if (job_id < 10 + 26)
+		sprintf(label, "%c", job_id - 10 + 'a');
+	else if (job_id < 10 + 26 + 26)
+		sprintf(label, "%c", job_id - 10 - 26 + 'A');
+	else
+	{
+		/* Longer labels are cut to nine characters, as the diagram always did. */
+		char number[16];
+		sprintf(number, "(%d)", job_id);
+		sprintf(label, "%.9s", number);
+	}
+}
+
+/*
+ * Timing diagram.
+ *
+ * Each core keeps the list of the time spans during which it ran a job, merging spans of the same
+ * job that follow one another, so the diagram takes memory in proportion to the number of times
+ * a job is put on a core rather than to the length of the run. The diagram is only rendered when
+ * it is printed, with one label per time unit and a '-' for each time unit the core was idle.
+ */
+
+typedef struct _timeline_segment_t
+{
+	int job_id;
+	int start, end; // the job ran from time unit start up to, but not including, end
+} timeline_segment_t;
+
+typedef struct _timeline_t
+{
+	int cores;
+	timeline_segment_t **segments;
+	int *segment_count, *segment_capacity;
+	char *buffer; // the rendered diagram of one core
+	size_t buffer_size;
+	int out_of_memory;
+} timeline_t;
+
+void timeline_init(timeline_t *timeline, int cores)
+{
+	int i;
+	timeline->cores = cores;
+	timeline->segments = malloc(cores * sizeof(timeline_segment_t *));
+	timeline->segment_count = malloc(cores * sizeof(int));
+	timeline->segment_capacity = malloc(cores * sizeof(int));
+	timeline->buffer_size = 1024;
+	timeline->buffer = malloc(timeline->buffer_size);
+	timeline->out_of_memory = 0;
+
+	for (i = 0; i < cores; i++)
+	{
+		timeline->segment_capacity[i] = 16;
+		timeline->segment_count[i] = 0;
+		timeline->segments[i] = malloc(timeline->segment_capacity[i] * sizeof(timeline_segment_t));
+	}
+}
+
+void timeline_destroy(timeline_t *timeline)
+{
+	int i;
+	for (i = 0; i < timeline->cores; i++)
+		free(timeline->segments[i]);
+	free(timeline->segments);
+	free(timeline->segment_count);
+	free(timeline->segment_capacity);
+	free(timeline->buffer);
+}
+
+/*
+ * Records that job_id ran on core_id from time unit start up to end. A span that overlaps or
+ * continues the last span of the same job on that core extends it. Running out of memory is
+ * reported when the diagram is printed.
+ */
+void timeline_run(timeline_t *timeline, int core_id, int job_id, int start, int end)
+{
+	int count = timeline->segment_count[core_id];
+	timeline_segment_t *last = count > 0 ? &timeline->segments[core_id][count - 1] : NULL;
+
+	if (start >= end || timeline->out_of_memory)
+		return;
+
+	if (last != NULL && last->job_id == job_id && start <= last->end)
+	{
+		if (end > last->end)
+			last->end = end;
+		return;
+	}
+
+	if (count == timeline->segment_capacity[core_id])
+	{
+		timeline_segment_t *segments = realloc(timeline->segments[core_id], 2 * count * sizeof(timeline_segment_t));
+		if (segments == NULL)
+		{
+			timeline->out_of_memory = 1;
+			return;
+		}
+		timeline->segments[core_id] = segments;
+		timeline->segment_capacity[core_id] *= 2;
+	}
+
+	timeline->segments[core_id][count].job_id = job_id;
+	timeline->segments[core_id][count].start = start;
+	timeline->segments[core_id][count].end = end;
+	timeline->segment_count[core_id]++;
+}
+
+/*
+ * Renders the first length time units of the diagram of a core. Returns the diagram, which is
+ * valid until the next call, or NULL if out of memory.
+ */
+const char *timeline_render(timeline_t *timeline, int core_id, int length)
+{
+	size_t used = 0;
+	int i, time = 0;
+
+	for (i = 0; i <= timeline->segment_count[core_id] && time < length; i++)
+	{
+		timeline_segment_t *segment = i < timeline->segment_count[core_id] ? &timeline->segments[core_id][i] : NULL;
+		int idle_end = segment != NULL && segment->start < length ? segment->start : length;
+		int end = segment != NULL && segment->end < length ? segment->end : length;
+		char label[11];
+		size_t label_length = 0;
+
+		if (segment != NULL && idle_end < length)
+		{
+			format_job_label(label, segment->job_id);
+			label_length = strlen(label);
+		}
+
+		size_t needed = used + (idle_end - time) + (end - idle_end) * label_length + 1;
+		if (needed > timeline->buffer_size)
+		{
+			while (needed > timeline->buffer_size)
+				timeline->buffer_size *= 2;
+			timeline->buffer = realloc(timeline->buffer, timeline->buffer_size);
+			if (timeline->buffer == NULL)
+			{
+				timeline->out_of_memory = 1;
+				return NULL;
+			}
+		}
+
+		memset(timeline->buffer + used, '-', idle_end - time);
+		used += idle_end - time;
+
+		for (time = idle_end; time < end; time++)
+		{
+			memcpy(timeline->buffer + used, label, label_length);
+			used += label_length;
+		}
+		time = end;
+	}
+
+	timeline->buffer[used] = '\0';
+	return timeline->buffer;
+}
+
+/*
+ * Prints the first length time units of the diagram of every core. Returns 0, or -1 if out of memory.
+ */
+int print_timeline(timeline_t *timeline, int length)
+{
+	int i;
+	if (timeline->out_of_memory)
+		return -1;
+
+	for (i = 0; i < timeline->cores; i++)
+	{
+		const char *diagram = timeline_render(timeline, i, length);
+		if (diagram == NULL)
+			return -1;
+		printf("  Core %2d: %s\n", i, diagram);
+	}
+	return 0;
+}
+
+/*
+ * Prints the state at the end of a time unit. Returns 0, or -1 if out of memory.
+ */
+int print_time_unit(int time, timeline_t *timeline, scheduler_t *scheduler)
+{
+	if (quiet)
+		return timeline->out_of_memory ? -1 : 0;
+
+	printf("At the end of time unit %d...\n", time);
+
+	if (print_timeline(timeline, time + 1) != 0)
+		return -1;
+
+	printf("\n");
+
+	printf("  Queue: ");
+	scheduler_show_queue_r(scheduler);
+	printf("\n");
+	printf("\n");
+	return 0;
+}
+
+/*
+ * Prints the timing diagram of the length time units simulated and the average times, and the
+ * deadline statistics if the trace has deadlines. Returns 0, or -1 if out of memory.
+ */
+int print_final_report(timeline_t *timeline, int length, scheduler_t *scheduler, int deadlines)
+{
+	if (timeline->out_of_memory)
+		return -1;
+
+	if (!quiet)
+	{
+		printf("FINAL TIMING DIAGRAM:\n");
+		if (print_timeline(timeline, length) != 0)
+			return -1;
+
+		printf("\n");
+	}
+
+	printf("Average Waiting Time: %.2f\n", scheduler_average_waiting_time_r(scheduler));
+	printf("Average Turnaround Time: %.2f\n", scheduler_average_turnaround_time_r(scheduler));
+	printf("Average Response Time: %.2f\n", scheduler_average_response_time_r(scheduler));
+	if (deadlines)
+	{
+		printf("Deadline Misses: %d\n", scheduler_deadline_misses_r(scheduler));
+		printf("Average Lateness: %.2f\n", scheduler_average_lateness_r(scheduler));
+		printf("Maximum Lateness: %d\n", scheduler_maximum_lateness_r(scheduler));
+	}
+	return 0;
+}
+
+
+/*
+ * Trace input.
+ *
+ * The input file is memory-mapped and parsed in place, without copying lines out of it. It is
+ * either the CSV trace, whose first line is a header and whose other lines are
+ * "arrival time,running time,priority", or the binary trace written by -w: the 8-byte magic
+ * TRACE_MAGIC followed by one record of three little-endian 32-bit integers per job, in the same
+ * order. A CSV trace whose header has a fourth column has a deadline on each line, which may be
+ * left out; its binary trace starts with TRACE_DEADLINE_MAGIC and has the deadline, or -1 for
+ * none, as a fourth integer of each record. Jobs are handed out one at a time, so a trace can also be fed to the simulation while
+ * it is read (-S); the pages already parsed are then given back to the kernel as the reader
+ * moves on, which keeps the memory use flat however large the trace is.
+ */
+
+#define TRACE_MAGIC "SIMTRC01"
+#define TRACE_DEADLINE_MAGIC "SIMTRC02"
+#define TRACE_MAGIC_SIZE 8
+#define TRACE_RECORD_SIZE 12
+#define TRACE_DEADLINE_RECORD_SIZE 16
+#define TRACE_RELEASE_CHUNK (64 << 20)
+
+typedef struct _trace_reader_t
+{
+	const char *data;
+	size_t size, offset;
+	size_t released;  // bytes before this offset were given back to the kernel
+	int mapped;       // data is an mmap() of the file rather than a malloc() copy
+	int binary;
+	int deadlines;    // the jobs have a deadline field
+	int record_size;  // bytes per job of a binary trace
+	int job_count;    // number of jobs in the whole trace
+	int next_job_id;
+} trace_reader_t;
+
+/*
+ * Returns 1 for the white space atoi() skips.
+ */
+int is_space(char c)
+{
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+/*
+ * Parses an integer field the way atoi() does: white space, an optional sign, then digits. The
+ * field ends at the first character that is not part of the number.
+ */
+int scan_int(const char *p, const char *end)
+{
+	unsigned int value = 0;
+	int negative = 0;
+
+	while (p < end && is_space(*p))
+		p++;
+	if (p < end && (*p == '+' || *p == '-'))
+		negative = (*p++ == '-');
+	while (p < end && *p >= '0' && *p <= '9')
+		value = value * 10 + (*p++ - '0');
+
+	return negative ? -(int)value : (int)value;
+}
+
+int get_le32(const unsigned char *p)
+{
+	return (int)((unsigned int)p[0] | (unsigned int)p[1] << 8 | (unsigned int)p[2] << 16 | (unsigned int)p[3] << 24);
+}
+
+void put_le32(unsigned char *p, int value)
+{
+	p[0] = value & 0xff;
+	p[1] = (value >> 8) & 0xff;
+	p[2] = (value >> 16) & 0xff;
+	p[3] = (value >> 24) & 0xff;
+}
+
+/*
+ * Opens a trace and counts its jobs. Files that cannot be mapped, such as pipes, are read into
+ * memory instead. Returns 0, or 2 after printing an error.
+ */
+int trace_open(trace_reader_t *reader, const char *file_name)
+{
+	struct stat st;
+	int fd = open(file_name, O_RDONLY);
+
+	memset(reader, 0, sizeof(trace_reader_t));
+	if (fd < 0)
+	{
+		fprintf(stderr, "Unable to open file \"%s\".\n", file_name);
+		return 2;
+	}
+
+	if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+	{
+		void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data != MAP_FAILED)
+		{
+			madvise(data, st.st_size, MADV_SEQUENTIAL);
+			reader->data = data;
+			reader->size = st.st_size;
+			reader->mapped = 1;
+		}
+	}
+
+	if (!reader->mapped)
+	{
+		size_t capacity = 0;
+		ssize_t bytes;
+		char *data = NULL;
+		do
+		{
+			if (reader->size == capacity)
+			{
+				capacity = capacity ? 2 * capacity : 65536;
+				data = realloc(data, capacity);
+				if (data == NULL)
+				{
+					fprintf(stderr, "Out of memory.\n");
+					close(fd);
+					return 2;
+				}
+			}
+			bytes = read(fd, data + reader->size, capacity - reader->size);
+			if (bytes > 0)
+				reader->size += bytes;
+		} while (bytes > 0 || (bytes < 0 && errno == EINTR));
+		reader->data = data;
+	}
+	close(fd);
+
+	if (reader->size >= TRACE_MAGIC_SIZE && memcmp(reader->data, TRACE_DEADLINE_MAGIC, TRACE_MAGIC_SIZE) == 0)
+		reader->deadlines = 1;
+	if (reader->deadlines || (reader->size >= TRACE_MAGIC_SIZE && memcmp(reader->data, TRACE_MAGIC, TRACE_MAGIC_SIZE) == 0))
+	{
+		reader->record_size = reader->deadlines ? TRACE_DEADLINE_RECORD_SIZE : TRACE_RECORD_SIZE;
+		if ((reader->size - TRACE_MAGIC_SIZE) % reader->record_size != 0)
+		{
+			fprintf(stderr, "Illegal file format.\n");
+			return 2;
+		}
+		reader->binary = 1;
+		reader->offset = TRACE_MAGIC_SIZE;
+		reader->job_count = (reader->size - TRACE_MAGIC_SIZE) / reader->record_size;
+		return 0;
+	}
+
+	// Skip the header line, then count the remaining lines; the last one may lack its newline.
+	const char *p = reader->data, *end = reader->data + reader->size;
+	const char *newline = p < end ? memchr(p, '\n', end - p) : NULL;
+	reader->offset = newline != NULL ? newline + 1 - p : reader->size;
+
+	// A fourth column in the header is the deadline.
+	const char *q;
+	int commas = 0;
+	for (q = p; q < p + reader->offset; q++)
+		commas += *q == ',';
+	reader->deadlines = commas >= 3;
+
+	for (p += reader->offset; p < end; reader->job_count++)
+	{
+		newline = memchr(p, '\n', end - p);
+		p = newline != NULL ? newline + 1 : end;
+	}
+	return 0;
+}
+
+/*
+ * Gives the pages of the trace before the read offset back to the kernel, one chunk at a time.
+ * They are clean pages of the file, so nothing is lost.
+ */
+void trace_release(trace_reader_t *reader, int all)
+{
+	long page = sysconf(_SC_PAGESIZE);
+	size_t upto = (all ? reader->size : reader->offset) / page * page;
+
+	if (reader->mapped && (all || upto - reader->released >= TRACE_RELEASE_CHUNK) && upto > reader->released)
+	{
+		madvise((char *)reader->data + reader->released, upto - reader->released, MADV_DONTNEED);
+		reader->released = upto;
+	}
+}
+
+/*
+ * Reads the next job of the trace. Returns 1 if a job was read, 0 at the end of the trace, and
+ * -1 if the line is not a job. A CSV line needs three comma-separated fields, and a fourth one
+ * for the deadline if the trace has deadlines. Empty fields are skipped, as strtok() would, and so
+ * are fields of white space only, so a deadline left empty before the end of the line ("2,2,0,"
+ * or "2,2,0,\r") gives no deadline rather than a deadline of 0.
+ */
+int trace_next(trace_reader_t *reader, simulator_job_list_t *job)
+{
+	int fields[4] = { 0, 0, 0, NO_DEADLINE };
+	int field_count = reader->deadlines ? 4 : 3;
+
+	if (reader->offset >= reader->size)
+		return 0;
+
+	if (reader->binary)
+	{
+		const unsigned char *record = (const unsigned char *)reader->data + reader->offset;
+		fields[0] = get_le32(record);
+		fields[1] = get_le32(record + 4);
+		fields[2] = get_le32(record + 8);
+		if (reader->deadlines)
+			fields[3] = get_le32(record + 12);
+		reader->offset += reader->record_size;
+	}
+	else
+	{
+		const char *p = reader->data + reader->offset, *end = reader->data + reader->size;
+		const char *line_end = memchr(p, '\n', end - p);
+		int count = 0;
+
+		line_end = line_end != NULL ? line_end + 1 : end;
+		while (count < field_count)
+		{
+			while (p < line_end && (*p == ',' || is_space(*p)))
+				p++;
+			if (p == line_end)
+				break;
+			fields[count++] = scan_int(p, line_end);
+			while (p < line_end && *p != ',')
+				p++;
+		}
+		reader->offset = line_end - reader->data;
+		if (count < 3)
+			return -1;
+	}
+
+	job->job_id = reader->next_job_id++;
+	job->arrival_time = fields[0];
+	job->run_time = fields[1];
+	job->priority = fields[2];
+	job->deadline = fields[3] < 0 ? NO_DEADLINE : fields[3];
+	job->core_id = -1;
+	job->arrived = 0;
+	return 1;
+}
+
+void trace_close(trace_reader_t *reader)
+{
+	if (reader->mapped)
+		munmap((void *)reader->data, reader->size);
+	else
+		free((void *)reader->data);
+}
+
+/*
+ * Writes a trace in the binary format (-w). Returns 0, or 2 after printing an error.
+ */
+int write_binary_trace(trace_reader_t *reader, const char *file_name)
+{
+	FILE *file = fopen(file_name, "wb");
+	simulator_job_list_t job;
+	unsigned char record[TRACE_DEADLINE_RECORD_SIZE];
+	int record_size = reader->deadlines ? TRACE_DEADLINE_RECORD_SIZE : TRACE_RECORD_SIZE;
+	int status;
+
+	if (file == NULL)
+	{
+		fprintf(stderr, "Unable to open file \"%s\".\n", file_name);
+		return 2;
+	}
+
+	fwrite(reader->deadlines ? TRACE_DEADLINE_MAGIC : TRACE_MAGIC, 1, TRACE_MAGIC_SIZE, file);
+	while ((status = trace_next(reader, &job)) == 1)
+	{
+		put_le32(record, job.arrival_time);
+		put_le32(record + 4, job.run_time);
+		put_le32(record + 8, job.priority);
+		put_le32(record + 12, job.deadline);
+		fwrite(record, 1, record_size, file);
+		trace_release(reader, 0);
+	}
+
+	if (status < 0)
+	{
+		fclose(file);
+		fprintf(stderr, "Illegal file format.\n");
+		return 2;
+	}
+	if (fclose(file) != 0)
+	{
+		fprintf(stderr, "Unable to write file \"%s\".\n", file_name);
+		return 2;
+	}
+	return 0;
+}
+
+
+/*
+ * Maps job ids to their index in the jobs array of the event-driven loop. Open addressing with
+ * linear probing; a key of -1 marks an empty slot.
+ */
+typedef struct _job_index_t
+{
+	int *keys, *values;
+	unsigned int capacity, count;
+} job_index_t;
+
+unsigned int job_index_home(job_index_t *index, int key)
+{
+	return ((unsigned int)key * 2654435761u) & (index->capacity - 1);
+}
+
+void job_index_init(job_index_t *index, unsigned int expected)
+{
+	unsigned int i;
+	index->capacity = 16;
+	while (index->capacity < 2 * expected)
+		index->capacity *= 2;
+	index->count = 0;
+	index->keys = malloc(index->capacity * sizeof(int));
+	index->values = malloc(index->capacity * sizeof(int));
+	for (i = 0; i < index->capacity; i++)
+		index->keys[i] = -1;
+}
+
+void job_index_destroy(job_index_t *index)
+{
+	free(index->keys);
+	free(index->values);
+}
+
+int job_index_get(job_index_t *index, int key)
+{
+	unsigned int slot = job_index_home(index, key);
+	while (index->keys[slot] != -1)
+	{
+		if (index->keys[slot] == key)
+			return index->values[slot];
+		slot = (slot + 1) & (index->capacity - 1);
+	}
+	return -1;
+}
+
+void job_index_put(job_index_t *index, int key, int value)
+{
+	unsigned int slot, i;
+
+	if (2 * (index->count + 1) > index->capacity)
+	{
+		job_index_t grown;
+		job_index_init(&grown, index->capacity);
+		for (i = 0; i < index->capacity; i++)
+			if (index->keys[i] != -1)
+				job_index_put(&grown, index->keys[i], index->values[i]);
+		job_index_destroy(index);
+		*index = grown;
+	}
+
+	slot = job_index_home(index, key);
+	while (index->keys[slot] != -1 && index->keys[slot] != key)
+		slot = (slot + 1) & (index->capacity - 1);
+	if (index->keys[slot] == -1)
+		index->count++;
+	index->keys[slot] = key;
+	index->values[slot] = value;
+}
+
+/*
+ * Removes a key, shifting back the keys after it that probed past its slot so no lookup breaks.
+ */
+void job_index_remove(job_index_t *index, int key)
+{
+	unsigned int mask = index->capacity - 1;
+	unsigned int hole = job_index_home(index, key), next, home;
+
+	while (index->keys[hole] != key)
+	{
+		if (index->keys[hole] == -1)
+			return;
+		hole = (hole + 1) & mask;
+	}
+
+	for (next = (hole + 1) & mask; index->keys[next] != -1; next = (next + 1) & mask)
+	{
+		home = job_index_home(index, index->keys[next]);
+		// The key may fill the hole unless its home lies cyclically in (hole, next].
+		if (((next - home) & mask) >= ((next - hole) & mask))
+		{
+			index->keys[hole] = index->keys[next];
+			index->values[hole] = index->values[next];
+			hole = next;
+		}
+	}
+	index->keys[hole] = -1;
+	index->count--;
+}
+
+
+/*
+ * Event-driven simulation (-e).
+ *
+ * Instead of scanning every job in every time unit, the simulation keeps a time-ordered queue
+ * holding the arrival of each job and the next event of each busy core: the completion of its
+ * job or, under RR, the expiry of its quantum, whichever comes first. A time unit without an
+ * event only extends the timing diagram. The events of one time unit are handled in the order
+ * the time-stepped loop in main() finds them, so both produce the same output.
+ *
+ * When the trace is streamed (-S), the jobs array only holds the jobs that arrived and did not
+ * finish, plus the next job of the trace, whose arrival is the only one queued. The events of one
+ * time unit are still met in the order of main()'s jobs array, whose positions are replayed from
+ * the number of jobs in the trace (see job_position()).
+ */
+
+typedef enum { EVENT_ARRIVAL, EVENT_CORE } simulator_event_kind_t;
+
+typedef struct _simulator_event_t
+{
+	int time;
+	simulator_event_kind_t kind;
+	int id; // job_id of an arrival, core_id of a core event
+} simulator_event_t;
+
+typedef struct _simulator_events_t
+{
+	simulator_job_list_t *jobs;
+	int active_jobs, jobs_capacity;
+	int cores, scheme, quantum;
+	trace_reader_t *reader;         // the trace being streamed, or NULL
+	int trace_jobs;                 // jobs left in main()'s jobs array when streaming
+	job_index_t moved_position;     // position in main()'s array of each job moved there
+	job_index_t moved_job;          // and the other way round
+
+	job_index_t index;              // index of each job in jobs, until it finishes
+	priqueue_t queue;
+	simulator_event_t *arrivals;
+	simulator_event_t *core_events;
+	priqueue_handle_t *core_handles; // queued event of each core, -1 if none
+	int *core_job;                  // job on each core, -1 if idle
+	int *core_start;                // time the job was put on the core
+	int busy_cores;
+	scheduler_t *scheduler;
+	timeline_t *timeline;
+} simulator_events_t;
+
+int compare_events(const void *a, const void *b)
+{
+	return ((const simulator_event_t *)a)->time - ((const simulator_event_t *)b)->time;
+}
+
+int compare_positions(const void *a, const void *b)
+{
+	return *(const int *)a - *(const int *)b;
+}
+
+simulator_job_list_t *find_job(simulator_events_t *sim, int job_id)
+{
+	int i = job_index_get(&sim->index, job_id);
+	return i == -1 ? NULL : &sim->jobs[i];
+}
+
+/*
+ * Returns the position of a job in main()'s jobs array, which orders the events of a time unit.
+ * With the whole trace loaded that is its index in jobs. A streamed trace is not held in full, so
+ * the positions are replayed: jobs start at the position of their job_id (the trace order), and
+ * main() fills the slot of a finished job with the last job of its array, which is usually one
+ * not read yet. Only the jobs that were moved are recorded.
+ */
+int job_position(simulator_events_t *sim, int job_id)
+{
+	if (!sim->reader)
+		return job_index_get(&sim->index, job_id);
+	int position = job_index_get(&sim->moved_position, job_id);
+	return position == -1 ? job_id : position;
+}
+
+/*
+ * Returns the job_id at a position of main()'s jobs array.
+ */
+int job_at_position(simulator_events_t *sim, int position)
+{
+	if (!sim->reader)
+		return sim->jobs[position].job_id;
+	int job_id = job_index_get(&sim->moved_job, position);
+	return job_id == -1 ? position : job_id;
+}
+
+/*
+ * Same check as set_active_job(): the job must have arrived and not finished.
+ */
+int is_active_job(simulator_events_t *sim, int job_id)
+{
+	simulator_job_list_t *job = job_id >= 0 ? find_job(sim, job_id) : NULL;
+	return job != NULL && job->arrived;
+}
+
+/*
+ * Takes the job off a core, charging it for the time units it ran there and adding them to the diagram.
+ */
+void release_core(simulator_events_t *sim, int core_id, int time)
+{
+	int job_id = sim->core_job[core_id];
+	if (job_id == -1)
+		return;
+
+	simulator_job_list_t *job = find_job(sim, job_id);
+	job->run_time -= time - sim->core_start[core_id];
+	job->core_id = -1;
+	sim->core_job[core_id] = -1;
+	sim->busy_cores--;
+	timeline_run(sim->timeline, core_id, job_id, sim->core_start[core_id], time);
+
+	if (sim->core_handles[core_id] != -1)
+	{
+		priqueue_remove_handle(&sim->queue, sim->core_handles[core_id]);
+		sim->core_handles[core_id] = -1;
+	}
+}
+
+/*
+ * Puts a job on an idle core and queues the next event of the core.
+ */
+void assign_core(simulator_events_t *sim, int job_id, int core_id, int time)
+{
+	simulator_job_list_t *job = find_job(sim, job_id);
+	if (job->core_id != -1)
+		release_core(sim, job->core_id, time);
+
+	job->core_id = core_id;
+	sim->core_job[core_id] = job_id;
+	sim->core_start[core_id] = time;
+	sim->busy_cores++;
+
+	int slice = scheduler_time_slice_r(sim->scheduler, core_id);
+	sim->core_events[core_id].time = time + job->run_time;
+	if (slice > 0 && slice < job->run_time)
+		sim->core_events[core_id].time = time + slice;
+	sim->core_handles[core_id] = priqueue_offer_handle(&sim->queue, &sim->core_events[core_id]);
+}
+
+/*
+ * Deletes a finished job from the jobs array the way main() does, by moving the last job into its slot.
+ */
+void remove_job(simulator_events_t *sim, int job_id)
+{
+	int i = job_index_get(&sim->index, job_id);
+	int last = --sim->active_jobs;
+
+	if (sim->reader)
+	{
+		int position = job_position(sim, job_id);
+		int last_position = --sim->trace_jobs;
+		int moved_id = job_at_position(sim, last_position);
+
+		job_index_remove(&sim->moved_position, job_id);
+		job_index_remove(&sim->moved_job, position);
+		job_index_remove(&sim->moved_job, last_position);
+		if (position != last_position)
+		{
+			job_index_put(&sim->moved_position, moved_id, position);
+			job_index_put(&sim->moved_job, position, moved_id);
+		}
+	}
+
+	if (i != last)
+	{
+		memcpy(&sim->jobs[i], &sim->jobs[last], sizeof(simulator_job_list_t));
+		job_index_put(&sim->index, sim->jobs[i].job_id, i);
+	}
+	job_index_remove(&sim->index, job_id);
+}
+
+/*
+ * Reads the next job of a streamed trace into the jobs array and queues its arrival. Returns 0,
+ * or 2 after printing an error.
+ */
+int stream_next_job(simulator_events_t *sim, int time)
+{
+	simulator_job_list_t job;
+	int status = trace_next(sim->reader, &job);
+
+	if (status == 0)
+		return 0;
+	if (status < 0)
+	{
+		fprintf(stderr, "Illegal file format.\n");
+		return 2;
+	}
+	if (job.arrival_time < time || job.run_time <= 0)
+	{
+		fprintf(stderr, "Option -S requires arrival times in increasing order from 0 and running times of at least 1.\n");
+		return 2;
+	}
+	trace_release(sim->reader, 0);
+
+	if (sim->active_jobs == sim->jobs_capacity)
+	{
+		sim->jobs_capacity *= 2;
+		sim->jobs = realloc(sim->jobs, sim->jobs_capacity * sizeof(simulator_job_list_t));
+		if (sim->jobs == NULL)
+		{
+			fprintf(stderr, "Out of memory.\n");
+			return 2;
+		}
+	}
+	sim->jobs[sim->active_jobs] = job;
+	job_index_put(&sim->index, job.job_id, sim->active_jobs++);
+
+	sim->arrivals[0].time = job.arrival_time;
+	sim->arrivals[0].id = job.job_id;
+	priqueue_offer(&sim->queue, &sim->arrivals[0]);
+	return 0;
+}
+
+/*
+ * Runs the simulation on jobs, or on the jobs of reader as they are read if jobs is NULL, with
+ * scheduler and into timeline. Stores the number of time units simulated in length. Returns the
+ * exit status of the simulator.
+ */
+int simulate_events(simulator_job_list_t *jobs, int job_count, trace_reader_t *reader, int cores, int scheme, int quantum,
+		scheduler_t *scheduler, timeline_t *timeline, int *length)
+{
+	simulator_events_t sim;
+	int time, i, core_id, jobs_alive = 0;
+
+	sim.reader = jobs == NULL ? reader : NULL;
+	sim.jobs = jobs;
+	sim.active_jobs = job_count;
+	sim.jobs_capacity = job_count;
+	sim.cores = cores;
+	sim.scheme = scheme;
+	sim.quantum = quantum;
+	sim.arrivals = malloc((sim.reader ? 1 : job_count + 1) * sizeof(simulator_event_t));
+	sim.core_events = malloc(cores * sizeof(simulator_event_t));
+	sim.core_handles = malloc(cores * sizeof(priqueue_handle_t));
+	sim.core_job = malloc(cores * sizeof(int));
+	sim.core_start = malloc(cores * sizeof(int));
+	sim.busy_cores = 0;
+	sim.scheduler = scheduler;
+	sim.timeline = timeline;
+	priqueue_init(&sim.queue, compare_events);
+
+	if (sim.reader)
+	{
+		sim.active_jobs = 0;
+		sim.jobs_capacity = 64;
+		sim.jobs = malloc(sim.jobs_capacity * sizeof(simulator_job_list_t));
+		sim.arrivals[0].kind = EVENT_ARRIVAL;
+		job_index_init(&sim.index, sim.jobs_capacity);
+		sim.trace_jobs = reader->job_count;
+		job_index_init(&sim.moved_position, sim.jobs_capacity);
+		job_index_init(&sim.moved_job, sim.jobs_capacity);
+		if (stream_next_job(&sim, 0) != 0)
+			return 2;
+	}
+	else
+	{
+		job_index_init(&sim.index, job_count);
+		for (i = 0; i < job_count; i++)
+		{
+			job_index_put(&sim.index, i, i);
+			sim.arrivals[i].time = jobs[i].arrival_time;
+			sim.arrivals[i].kind = EVENT_ARRIVAL;
+			sim.arrivals[i].id = i;
+			priqueue_offer(&sim.queue, &sim.arrivals[i]);
+		}
+	}
+
+	// Jobs finishing and arriving in the current time unit, and cores whose quantum expired.
+	int finished, arrived, arriving_capacity = 64;
+	int *finished_jobs = malloc(cores * sizeof(int));
+	int *arriving_jobs = malloc(arriving_capacity * sizeof(int));
+	char *expired = calloc(cores, 1);
+
+	for (i = 0; i < cores; i++)
+	{
+		sim.core_events[i].kind = EVENT_CORE;
+		sim.core_events[i].id = i;
+		sim.core_handles[i] = -1;
+		sim.core_job[i] = -1;
+	}
+
+	for (time = 0; sim.active_jobs > 0; time++)
+	{
+		print_progress("=== [TIME %d] ===\n", time);
+
+		simulator_event_t *event;
+		finished = arrived = 0;
+		while ((event = priqueue_peek(&sim.queue)) != NULL && event->time == time)
+		{
+			priqueue_poll(&sim.queue);
+			if (event->kind == EVENT_ARRIVAL)
+			{
+				if (arrived == arriving_capacity)
+				{
+					arriving_capacity *= 2;
+					arriving_jobs = realloc(arriving_jobs, arriving_capacity * sizeof(int));
+				}
+				arriving_jobs[arrived++] = event->id;
+				if (sim.reader && stream_next_job(&sim, time) != 0)
+					return 2;
+			}
+			else
+			{
+				core_id = event->id;
+				sim.core_handles[core_id] = -1;
+				if (find_job(&sim, sim.core_job[core_id])->run_time == time - sim.core_start[core_id])
+					finished_jobs[finished++] = sim.core_job[core_id];
+				else
+					expired[core_id] = 1;
+			}
+		}
+
+		/*
+		 * 1. Jobs that finished in the last time unit. main() meets them in the order of the jobs
+		 *    array, which changes as finished jobs are deleted, so the job with the lowest position goes next.
+		 */
+		while (finished > 0)
+		{
+			int first = 0;
+			for (i = 1; i < finished; i++)
+				if (job_position(&sim, finished_jobs[i]) < job_position(&sim, finished_jobs[first]))
+					first = i;
+
+			int job_id = finished_jobs[first];
+			finished_jobs[first] = finished_jobs[--finished];
+			core_id = find_job(&sim, job_id)->core_id;
+
+			int new_job_id = scheduler_job_finished_r(scheduler, core_id, job_id, time);
+			release_core(&sim, core_id, time);
+			remove_job(&sim, job_id);
+			jobs_alive--;
+
+			if (new_job_id != -1 && !is_active_job(&sim, new_job_id))
+			{
+				printf("The scheduler_job_finished() selected an invalid job (job_id == %d).\n", new_job_id);
+				print_available_jobs(sim.jobs, sim.active_jobs);
+				return 3;
+			}
+			if (new_job_id != -1)
+				assign_core(&sim, new_job_id, core_id, time);
+
+			print_progress("Job %d, running on core %d, finished. Core %d is now running job %d.\n", job_id, core_id, core_id, new_job_id);
+			print_queue(scheduler);
+		}
+
+		if (sim.active_jobs == 0)
+			break;
+
+		/*
+		 * 2. Quantums that expired in the last time unit. A core that got a new job in step 1 started a new quantum.
+		 */
+		for (core_id = 0; core_id < cores; core_id++)
+		{
+			if (!expired[core_id])
+				continue;
+			expired[core_id] = 0;
+			if (sim.core_job[core_id] == -1 || sim.core_start[core_id] == time)
+				continue;
+
+			int old_job_id = sim.core_job[core_id];
+			int new_job_id = scheduler_quantum_expired_r(scheduler, core_id, time);
+			release_core(&sim, core_id, time);
+
+			if (new_job_id != -1 && !is_active_job(&sim, new_job_id))
+			{
+				printf("The scheduler_quantum_expired() selected an invalid job (job_id == %d).\n", new_job_id);
+				print_available_jobs(sim.jobs, sim.active_jobs);
+				return 3;
+			}
+			if (new_job_id != -1)
+				assign_core(&sim, new_job_id, core_id, time);
+
+			print_progress("Job %d, running on core %d, had its quantum expire. Core %d is now running job %d.\n", old_job_id, core_id, core_id, new_job_id);
+			print_queue(scheduler);
+		}
+
+		/*
+		 * 3. Jobs arriving in this time unit, in the order of the jobs array.
+		 */
+		for (i = 0; i < arrived; i++)
+			arriving_jobs[i] = job_position(&sim, arriving_jobs[i]);
+		qsort(arriving_jobs, arrived, sizeof(int), compare_positions);
+
+		for (i = 0; i < arrived; i++)
+		{
+			simulator_job_list_t *job = find_job(&sim, job_at_position(&sim, arriving_jobs[i]));
+			int new_job_core_id = scheduler_new_deadline_job_r(scheduler, job->job_id, time, job->run_time, job->priority, job->deadline);
+			job->arrived = 1;
+			jobs_alive++;
+
+			if (new_job_core_id >= 0 && new_job_core_id < cores)
+			{
+				print_progress("A new job, job %d (running time=%d, priority=%d), arrived. Job %d is now running on core %d.\n",
+						job->job_id, job->run_time, job->priority, job->job_id, new_job_core_id);
+				print_queue(scheduler);
+
+				release_core(&sim, new_job_core_id, time);
+				assign_core(&sim, job->job_id, new_job_core_id, time);
+			}
+			else if (new_job_core_id == -1)
+			{
+				print_progress("A new job, job %d (running time=%d, priority=%d), arrived. Job %d is set to idle (-1).\n",
+						job->job_id, job->run_time, job->priority, job->job_id);
+				print_queue(scheduler);
+			}
+			else
+			{
+				printf("The scheduler_new_job() selected an invalid core (core_id == %d).\n", new_job_core_id);
+				print_available_cores(cores);
+				return 3;
+			}
+		}
+
+		/*
+		 * 4. Run the time unit and print it. The jobs still running only need to be in the
+		 *    diagram to print it; release_core() adds them when they leave their core.
+		 */
+		if (!quiet)
+			for (i = 0; i < cores; i++)
+				if (sim.core_job[i] != -1)
+					timeline_run(sim.timeline, i, sim.core_job[i], sim.core_start[i], time + 1);
+
+		if (print_time_unit(time, sim.timeline, scheduler) != 0)
+		{
+			fprintf(stderr, "Out of memory.\n");
+			return 3;
+		}
+
+		if (jobs_alive > 0 && sim.busy_cores == 0)
+		{
+			printf("All cores are idle and at least one job remains unscheduled.\n");
+			print_available_jobs(sim.jobs, sim.active_jobs);
+			return 3;
+		}
+
+		/*
+		 * 5. Nothing changes until the next event, so unless every time unit is printed, go straight to it.
+		 */
+		if (quiet && (event = priqueue_peek(&sim.queue)) != NULL)
+			time = event->time - 1;
+	}
+
+	*length = time;
+
+	priqueue_destroy(&sim.queue);
+	job_index_destroy(&sim.index);
+	if (sim.reader)
+	{
+		job_index_destroy(&sim.moved_position);
+		job_index_destroy(&sim.moved_job);
+	}
+	free(finished_jobs);
+	free(arriving_jobs);
+	free(expired);
+	if (sim.reader)
+		free(sim.jobs);
+	free(sim.arrivals);
+	free(sim.core_events);
+	free(sim.core_handles);
+	free(sim.core_job);
+	free(sim.core_start);
+
+	return 0;
+}
+
+
+/*
+ * Parameter sweep (-x).
+ *
+ * The trace is loaded once and every combination of the schemes given to -s and the core counts
+ * given to -c is simulated on a pool of threads. Each simulation runs the event-driven loop on its
+ * own copy of the jobs and its own scheduler_t, so the simulations share nothing but the trace,
+ * which they only read. The results are written as one CSV, in the order of the combinations.
+ */
+
+typedef struct _sweep_task_t
+{
+	int scheme, quantum, cores;
+	simulator_mlfq_t mlfq;
+	int status;
+	float waiting_time, turnaround_time, response_time;
+	int deadline_misses, maximum_lateness;
+	float average_lateness;
+} sweep_task_t;
+
+typedef struct _sweep_t
+{
+	const simulator_job_list_t *jobs;
+	int job_count;
+	sweep_task_t *tasks;
+	int task_count;
+	int next_task;
+	pthread_mutex_t lock;
+} sweep_t;
+
+const char *scheme_name(int scheme)
+{
+	static const char *names[] = { "fcfs", "sjf", "psjf", "pri", "ppri", "rr", "mlfq", "cfs", "edf", "pedf" };
+	return names[scheme];
+}
+
+/*
+ * Creates the scheduler of a scheme, with the levels of mlfq under MLFQ.
+ */
+scheduler_t *create_scheduler(int cores, int scheme, int quantum, const simulator_mlfq_t *mlfq)
+{
+	scheduler_t *scheduler = scheduler_create(cores, scheme, quantum);
+	if (scheduler != NULL && scheme == MLFQ)
+		scheduler_set_mlfq_r(scheduler, mlfq->levels, mlfq->quanta, mlfq->boost_interval);
+	return scheduler;
+}
+
+/*
+ * Runs one combination of the sweep and records its averages. Returns the exit status of the simulation.
+ */
+int run_sweep_task(sweep_t *sweep, sweep_task_t *task)
+{
+	simulator_job_list_t *jobs = malloc((sweep->job_count + 1) * sizeof(simulator_job_list_t));
+	scheduler_t *scheduler = create_scheduler(task->cores, task->scheme, task->quantum, &task->mlfq);
+	timeline_t timeline;
+	int length, status;
+
+	if (jobs == NULL || scheduler == NULL)
+	{
+		free(jobs);
+		if (scheduler != NULL)
+			scheduler_destroy(scheduler);
+		fprintf(stderr, "Out of memory.\n");
+		return 3;
+	}
+
+	memcpy(jobs, sweep->jobs, sweep->job_count * sizeof(simulator_job_list_t));
+	timeline_init(&timeline, task->cores);
+
+	status = simulate_events(jobs, sweep->job_count, NULL, task->cores, task->scheme, task->quantum, scheduler, &timeline, &length);
+	if (status == 0)
+	{
+		task->waiting_time = scheduler_average_waiting_time_r(scheduler);
+		task->turnaround_time = scheduler_average_turnaround_time_r(scheduler);
+		task->response_time = scheduler_average_response_time_r(scheduler);
+		task->deadline_misses = scheduler_deadline_misses_r(scheduler);
+		task->average_lateness = scheduler_average_lateness_r(scheduler);
+		task->maximum_lateness = scheduler_maximum_lateness_r(scheduler);
+	}
+
+	timeline_destroy(&timeline);
+	scheduler_destroy(scheduler);
+	free(jobs);
+	return status;
+}
+
+void *sweep_worker(void *arg)
+{
+	sweep_t *sweep = arg;
+
+	while (1)
+	{
+		pthread_mutex_lock(&sweep->lock);
+		int i = sweep->next_task++;
+		pthread_mutex_unlock(&sweep->lock);
+
+		if (i >= sweep->task_count)
+			return NULL;
+
+		sweep->tasks[i].status = run_sweep_task(sweep, &sweep->tasks[i]);
+	}
+}
+
+/*
+ * Parses a list of core counts such as "1,2,4-8" into cores. Returns the number of core counts,
+ * or -1 if the list is not valid.
+ */
+int parse_core_list(const char *list, int **cores)
+{
+	int count = 0, capacity = 16;
+	const char *p = list;
+
+	*cores = malloc(capacity * sizeof(int));
+
+	while (1)
+	{
+		char *end;
+		long first = strtol(p, &end, 10), last = first;
+
+		if (end == p)
+			return -1;
+		if (*end == '-')
+		{
+			p = end + 1;
+			last = strtol(p, &end, 10);
+			if (end == p)
+				return -1;
+		}
+		if (first <= 0 || last < first || last > 1 << 20)
+			return -1;
+
+		for (; first <= last; first++)
+		{
+			if (count == capacity)
+			{
+				capacity *= 2;
+				*cores = realloc(*cores, capacity * sizeof(int));
+			}
+			(*cores)[count++] = first;
+		}
+
+		if (*end == '\0')
+			return count;
+		if (*end != ',')
+			return -1;
+		p = end + 1;
+	}
+}
+
+/*
+ * Makes one task of every combination of the schemes in scheme_list and the core counts in
+ * core_list. Returns the number of tasks, or -1 after printing an error.
+ */
+int build_sweep_tasks(const char *scheme_list, const char *core_list, sweep_task_t **tasks)
+{
+	int *cores, core_count = parse_core_list(core_list, &cores);
+	int i, task_count = 0;
+
+	if (core_count < 0)
+	{
+		fprintf(stderr, "Option -c <cores> requires a comma-separated list of positive numbers or ranges with -x. (Eg: -c 1,2,4-8)\n");
+		free(cores);
+		return -1;
+	}
+
+	char *schemes = strdup(scheme_list), *save, *name;
+	*tasks = NULL;
+
+	for (name = strtok_r(schemes, ",", &save); name != NULL; name = strtok_r(NULL, ",", &save))
+	{
+		int scheme, quantum = 0;
+		simulator_mlfq_t mlfq;
+		if (parse_scheme(name, &scheme, &quantum, &mlfq) != 0 || (scheme == RR && quantum <= 0))
+		{
+			fprintf(stderr, "Option -s <scheme> requires a comma-separated list of schemes with -x. (Eg: -s fcfs,rr2)\n");
+			free(schemes);
+			free(cores);
+			free(*tasks);
+			return -1;
+		}
+
+		*tasks = realloc(*tasks, (task_count + core_count) * sizeof(sweep_task_t));
+		for (i = 0; i < core_count; i++)
+		{
+			(*tasks)[task_count].scheme = scheme;
+			(*tasks)[task_count].quantum = quantum;
+			(*tasks)[task_count].mlfq = mlfq;
+			(*tasks)[task_count].cores = cores[i];
+			task_count++;
+		}
+	}
+
+	free(schemes);
+	free(cores);
+	return task_count;
+}
+
+/*
+ * Runs the tasks of a sweep on threads threads and prints their results as CSV, with the deadline
+ * statistics if the trace has deadlines. Returns the exit status of the simulator.
+ */
+int run_sweep(const simulator_job_list_t *jobs, int job_count, sweep_task_t *tasks, int task_count, int threads, int deadlines)
+{
+	sweep_t sweep;
+	int i, status = 0;
+
+	sweep.jobs = jobs;
+	sweep.job_count = job_count;
+	sweep.tasks = tasks;
+	sweep.task_count = task_count;
+	sweep.next_task = 0;
+
+	if (threads > task_count)
+		threads = task_count;
+
+	pthread_t *workers = malloc(threads * sizeof(pthread_t));
+	pthread_mutex_init(&sweep.lock, NULL);
+
+	for (i = 0; i < threads; i++)
+	{
+		if (pthread_create(&workers[i], NULL, sweep_worker, &sweep) != 0)
+		{
+			// Run with the threads that did start, or on this one if none did.
+			threads = i;
+			break;
+		}
+	}
+	if (threads == 0)
+		sweep_worker(&sweep);
+	for (i = 0; i < threads; i++)
+		pthread_join(workers[i], NULL);
+
+	pthread_mutex_destroy(&sweep.lock);
+	free(workers);
+
+	printf("scheme,quantum,cores,average_waiting_time,average_turnaround_time,average_response_time%s\n",
+			deadlines ? ",deadline_misses,average_lateness,maximum_lateness" : "");
+	for (i = 0; i < task_count; i++)
+	{
+		sweep_task_t *task = &tasks[i];
+		char name[16 * (MLFQ_MAX_LEVELS + 1)];
+
+		// An MLFQ row names its levels, which have no single quantum.
+		if (task->scheme == MLFQ)
+			format_mlfq(name, &task->mlfq);
+		else
+			strcpy(name, scheme_name(task->scheme));
+
+		if (task->status != 0)
+		{
+			fprintf(stderr, "The simulation of %s with %d core(s) failed.\n", name, task->cores);
+			status = task->status;
+			continue;
+		}
+
+		printf("%s,%d,%d,%.2f,%.2f,%.2f", name, task->quantum, task->cores,
+				task->waiting_time, task->turnaround_time, task->response_time);
+		if (deadlines)
+			printf(",%d,%.2f,%d", task->deadline_misses, task->average_lateness, task->maximum_lateness);
+		printf("\n");
+	}
+
+	return status;
+}
+
+
+int main(int argc, char **argv)
+{
+	int c;
+	static struct option long_options[] =
+	{
+		{ "quiet", no_argument, NULL, 'q' },
+		{ "sweep", no_argument, NULL, 'x' },
+		{ NULL, 0, NULL, 0 }
+	};
+	int cores = 0, scheme = -1, quantum = 0, event_driven = 0, streaming = 0;
+	simulator_mlfq_t mlfq;
+	int sweep = 0, threads = sysconf(_SC_NPROCESSORS_ONLN);
+	char *file_name, *binary_file_name = NULL, *core_list = NULL, *scheme_list = NULL;
+
+	/*
+	 * Parse command line options.
+	 */
+	while ((c = getopt_long(argc, argv, "c:s:eSw:qxj:", long_options, NULL)) != -1)
+	{
+		switch (c)
+		{
+			case 'c':
+				core_list = optarg;
+				break;
+
+			case 's':
+				scheme_list = optarg;
+				break;
+
+			case 'e':
+				event_driven = 1;
+				break;
+
+			case 'S':
+				event_driven = streaming = 1;
+				break;
+
+			case 'w':
+				binary_file_name = optarg;
+				break;
+
+			case 'q':
+				quiet = 1;
+				break;
+
+			case 'x':
+				sweep = quiet = 1;
+				break;
+
+			case 'j':
+				threads = atoi(optarg);
+
+				if (threads <= 0)
+				{
+					fprintf(stderr, "Option -j <threads> requires a positive number.\n");
+					print_usage(argv[0]);
+					return 1;
+				}
+				break;
+
+			case '?':
+				print_usage(argv[0]);
+				return 1;
+
+			default:
+				printf("....\n");
+				break;
+		}
+	}
+
+	if (binary_file_name != NULL && optind == argc - 1)
+	{
+		trace_reader_t reader;
+		int status = trace_open(&reader, argv[optind]);
+		if (status == 0)
+		{
+			status = write_binary_trace(&reader, binary_file_name);
+			trace_close(&reader);
+		}
+		return status;
+	}
+
+	/*
+	 * -c and -s take a single value, or lists of them with -x.
+	 */
+	sweep_task_t *tasks = NULL;
+	int task_count = 0;
+
+	if (sweep)
+	{
+		if (streaming)
+		{
+			fprintf(stderr, "Options -x and -S cannot be used together.\n");
+			print_usage(argv[0]);
+			return 1;
+		}
+
+		if (core_list != NULL && scheme_list != NULL)
+		{
+			task_count = build_sweep_tasks(scheme_list, core_list, &tasks);
+			if (task_count < 0)
+			{
+				print_usage(argv[0]);
+				return 1;
+			}
+		}
+
+		cores = core_list != NULL;
+		scheme = scheme_list != NULL ? FCFS : -1;
+		event_driven = 1;
+	}
+	else
+	{
+		if (core_list != NULL)
+		{
+			cores = atoi(core_list);
+
+			if (cores <= 0)
+			{
+				fprintf(stderr, "Option -c <cores> require a positive number.\n");
+				print_usage(argv[0]);
+				return 1;
+			}
+		}
+
+		if (scheme_list != NULL && parse_scheme(scheme_list, &scheme, &quantum, &mlfq) != 0)
+			scheme = -1;
+		else if (scheme == RR)
+		{
+			if (quantum <= 0)
+			{
+				fprintf(stderr, "Option -s <scheme> requires a positive number for the quantum of RR. (Eg: -s RR2)\n");
+				print_usage(argv[0]);
+				return 1;
+			}
+		}
+	}
+
+	if (cores == 0)
+	{
+		fprintf(stderr, "Required option -c <cores> is not present.\n");
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	if (scheme == -1)
+	{
+		fprintf(stderr, "Required option -s <scheme> is not present.\n");
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	if (optind == argc - 1)
+		file_name = argv[optind];
+	else
+	{
+		fprintf(stderr, "A single input file is required.\n");
+		print_usage(argv[0]);
+		return 1;
+	}
+
+
+	/*
+	 * Open the file, read the file, and populate the jobs data structure. A streamed trace is
+	 * read by the simulation itself.
+	 */
+	trace_reader_t reader;
+	int status = trace_open(&reader, file_name);
+	if (status != 0)
+		return status;
+
+	int job_id = 0;
+	simulator_job_list_t* jobs = NULL;
+
+	if (!streaming)
+	{
+		jobs = malloc((reader.job_count + 1) * sizeof(simulator_job_list_t));
+		if (!jobs)
+		{
+			fprintf(stderr, "Out of memory.\n");
+			return 2;
+		}
+
+		while ((status = trace_next(&reader, &jobs[job_id])) == 1)
+			job_id++;
+
+		if (status < 0)
+		{
+			fprintf(stderr, "Illegal file format.\n");
+			return 2;
+		}
+
+		trace_close(&reader);
+	}
+	else
+	{
+		// Counting the jobs read the whole trace; drop those pages until the simulation gets to them.
+		job_id = reader.job_count;
+		trace_release(&reader, 1);
+	}
+
+	/*
+	 * The event-driven loop only looks at a job when it arrives and when it leaves a core, which
+	 * the time-stepped loop never does for jobs that arrive before time 0 or need no time.
+	 */
+	if (event_driven && !streaming)
+	{
+		int i;
+		for (i = 0; i < job_id; i++)
+		{
+			if (jobs[i].arrival_time < 0 || jobs[i].run_time <= 0)
+			{
+				fprintf(stderr, "Option %s requires arrival times of at least 0 and running times of at least 1.\n", sweep ? "-x" : "-e");
+				return 2;
+			}
+		}
+	}
+
+
+	/*
+	 * Run the simulation.
+	 */
+
+	if (sweep)
+	{
+		status = run_sweep(jobs, job_id, tasks, task_count, threads, reader.deadlines);
+		free(tasks);
+		free(jobs);
+		return status;
+	}
+
+	print_progress("Loaded %d core(s) and %d job(s) using ", cores, job_id);
+	if (scheme == FCFS) { print_progress("First Come First Served (FCFS)"); }
+	else if (scheme == SJF) { print_progress("Non-preemptive Shortest Job First (SJF)"); }
+	else if (scheme == PSJF) { print_progress("Preemptive Shortest Job First (PSJF)"); }
+	else if (scheme == PRI) { print_progress("Non-preemptive Priority (PRI)"); }
+	else if (scheme == PPRI) { print_progress("Preemptive Priority (PPRI)"); }
+	else if (scheme == RR) { print_progress("Round Robin (RR) with a quantum of %d", quantum); }
+	else if (scheme == MLFQ)
+	{
+		int level;
+		print_progress("Multi-Level Feedback Queue (MLFQ) with quanta of %d", mlfq.quanta[0]);
+		for (level = 1; level < mlfq.levels; level++)
+			print_progress("/%d", mlfq.quanta[level]);
+		if (mlfq.boost_interval > 0)
+			print_progress(" and a priority boost every %d", mlfq.boost_interval);
+	}
+	else if (scheme == CFS) { print_progress("Completely Fair Scheduling (CFS) with a target latency of %d", quantum > 0 ? quantum : CFS_DEFAULT_LATENCY); }
+	else if (scheme == EDF) { print_progress("Non-preemptive Earliest Deadline First (EDF)"); }
+	else if (scheme == PEDF) { print_progress("Preemptive Earliest Deadline First (PEDF)"); }
+	print_progress(" scheduling...\n\n");
+
+	scheduler_t *scheduler = create_scheduler(cores, scheme, quantum, &mlfq);
+	if (scheduler == NULL)
+	{
+		fprintf(stderr, "Out of memory.\n");
+		return 2;
+	}
+
+	timeline_t timeline;
+	timeline_init(&timeline, cores);
+
+	if (event_driven)
+	{
+		int length;
+		status = simulate_events(jobs, job_id, &reader, cores, scheme, quantum, scheduler, &timeline, &length);
+		if (status == 0)
+		{
+			if (print_final_report(&timeline, length, scheduler, reader.deadlines) != 0)
+			{
+				fprintf(stderr, "Out of memory.\n");
+				return 3;
+			}
+			scheduler_destroy(scheduler);
+		}
+		timeline_destroy(&timeline);
+		if (streaming)
+			trace_close(&reader);
+		free(jobs);
+		return status;
+	}
+
+
+	int time = 0, i;
+	int job_count = job_id, active_jobs = job_id, jobs_alive = 0;
+
+	int *quantum_clock = malloc(cores * sizeof(int));
+	int *core_job = malloc(cores * sizeof(int));          // job id on each core, -1 if idle
+	int *position = malloc((job_count + 1) * sizeof(int)); // index in jobs of each job id, -1 once finished
+
+	for (i = 0; i < cores; i++)
+	{
+		quantum_clock[i] = -1;
+		core_job[i] = -1;
+	}
+	for (i = 0; i < job_count; i++)
+		position[i] = i;
+
+	while (active_jobs > 0)
+	{
+		print_progress("=== [TIME %d] ===\n", time);
+
+		/*
+		 * 1. Check if any jobs finished in the last time unit.
+		 */
+		for (i = 0; i < active_jobs; i++)
+		{
+			if (jobs[i].run_time == 0)
+			{
+				// Notify the scheduler has finished
+				int job_id = jobs[i].job_id;
+				int core_id = jobs[i].core_id;
+				int new_job_id = scheduler_job_finished_r(scheduler, jobs[i].core_id, jobs[i].job_id, time);
+
+				start_time_slice(scheduler, quantum_clock, core_id);
+				core_job[core_id] = -1;
+
+				// Delete the finished jobs, decrease the number of active jobs
+				position[job_id] = -1;
+				if (i != active_jobs - 1)
+				{
+					memcpy(&jobs[i], &jobs[active_jobs - 1], sizeof(simulator_job_list_t));
+					position[jobs[i].job_id] = i;
+				}
+				active_jobs--;
+				jobs_alive--;
+				i--;
+
+				// Set the new job
+				if ( new_job_id != -1 && !set_active_job(new_job_id, core_id, jobs, position, job_count, core_job) )
+				{
+					printf("The scheduler_job_finished() selected an invalid job (job_id == %d).\n", new_job_id);
+					print_available_jobs(jobs, active_jobs);
+					return 3;
+				}
+				else
+				{
+					print_progress("Job %d, running on core %d, finished. Core %d is now running job %d.\n", job_id, core_id, core_id, new_job_id);
+					print_queue(scheduler);
+				}
+			}
+		}
+
+		/*
+		 * Check to see if we finished our last job.  (If we don't check here, we would run an extra time unit that will be totally idle.)
+		 */
+		if (active_jobs == 0)
+			break;
+
+		/*
+		 * 2. Check of any quantums expired in the last time unit.
+		 */
+		for (i = 0; i < cores; i++)
+		{
+			if (quantum_clock[i] == 0 && core_job[i] != -1)
+			{
+				// Notify the scheduler the quantum has expired
+				int core_id = i;
+				int old_job_id = core_job[i];
+				int new_job_id = scheduler_quantum_expired_r(scheduler, core_id, time);
+
+				jobs[position[old_job_id]].core_id = -1;
+				core_job[core_id] = -1;
+
+				start_time_slice(scheduler, quantum_clock, core_id);
+
+				// Set the new job
+				if ( new_job_id != -1 && !set_active_job(new_job_id, core_id, jobs, position, job_count, core_job) )
+				{
+					printf("The scheduler_quantum_expired() selected an invalid job (job_id == %d).\n", new_job_id);
+					print_available_jobs(jobs, active_jobs);
+					return 3;
+				}
+				else
+				{
+					print_progress("Job %d, running on core %d, had its quantum expire. Core %d is now running job %d.\n", old_job_id, core_id, core_id, new_job_id);
+					print_queue(scheduler);
+				}
+			}
+		}
+
+
+		/*
+		 * 3. Check for any new jobs that arrive in this time unit
+		 */
+		for (i = 0; i < active_jobs; i++)
+		{
+			if (jobs[i].arrival_time == time)
+			{
+				int new_job_core_id = scheduler_new_deadline_job_r(scheduler, jobs[i].job_id, time, jobs[i].run_time, jobs[i].priority, jobs[i].deadline);
+				jobs[i].arrived = 1;
+				jobs_alive++;
+
+				if (new_job_core_id >= 0 && new_job_core_id < cores)
+				{
+					print_progress("A new job, job %d (running time=%d, priority=%d), arrived. Job %d is now running on core %d.\n",
+							jobs[i].job_id, jobs[i].run_time, jobs[i].priority, jobs[i].job_id, new_job_core_id);
+					print_queue(scheduler);
+
+					// Take the core from the job using it, if any.
+					if (core_job[new_job_core_id] != -1)
+						jobs[position[core_job[new_job_core_id]]].core_id = -1;
+
+					// Assign the core to the new job
+					jobs[i].core_id = new_job_core_id;
+					core_job[new_job_core_id] = jobs[i].job_id;
+
+					start_time_slice(scheduler, quantum_clock, new_job_core_id);
+				}
+				else if (new_job_core_id == -1)
+				{
+					print_progress("A new job, job %d (running time=%d, priority=%d), arrived. Job %d is set to idle (-1).\n",
+							jobs[i].job_id, jobs[i].run_time, jobs[i].priority, jobs[i].job_id);
+					print_queue(scheduler);
+				}
+				else
+				{
+					printf("The scheduler_new_job() selected an invalid core (core_id == %d).\n", new_job_core_id);
+					print_available_cores(cores);
+					return 3;
+				}
+			}
+		}
+
+
+		/*
+		 * 4. Run the time unit.
+		 */
+		int cores_working = 0;
+
+		for (i = 0; i < cores; i++)
+		{
+			if (core_job[i] != -1)
+			{
+				simulator_job_list_t *job = &jobs[position[core_job[i]]];
+				assert(job->core_id == i);
+
+				cores_working++;
+				job->run_time--;
+				quantum_clock[i]--;
+
+				timeline_run(&timeline, i, job->job_id, time, time + 1);
+			}
+		}
+
+
+		/*
+		 * 5. Print data!
+		 */
+		if (print_time_unit(time, &timeline, scheduler) != 0)
+		{
+			fprintf(stderr, "Out of memory.\n");
+			return 3;
+		}
+
+
+		/*
+		 * 6. Sanity Checking
+		 *
+		 * - If there's a job alive (needing to be ran) and all CPUs are idle, the scheduler failed to schedule properly.
+		 */
+		if (jobs_alive > 0 && cores_working == 0)
+		{
+			printf("All cores are idle and at least one job remains unscheduled.\n");
+			print_available_jobs(jobs, active_jobs);
+			return 3;
+		}
+
+
+		/*
+		 * 7. Increase time
+		 */
+		time++;
+	}
+
+
+	if (print_final_report(&timeline, time, scheduler, reader.deadlines) != 0)
+	{
+		fprintf(stderr, "Out of memory.\n");
+		return 3;
+	}
+
+	scheduler_destroy(scheduler);
+
+
+	free(quantum_clock);
+	free(core_job);
+	free(position);
+	timeline_destroy(&timeline);
+	free(jobs);
+
+	return 0;
+}
@@ -1,12 +1,25 @@
+#define _GNU_SOURCE
+
+#include <ctype.h>
+#include <errno.h>
+#include <sched.h>
 #include <signal.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <dirent.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <unistd.h>
 #include <termios.h>
+#include <time.h>
+#include <poll.h>
+#include <stdint.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/un.h>
 #include <sys/wait.h>
 
 #define SIZE 1000
@@ -14,7 +27,6 @@
 
 // Declaring several global variables and arrays.
 char *inputBuffer;
-char *arguments[SIZE];
 char *commandList[SIZE];
 char *exportrguments[SIZE];
 char currentDir[SIZE];
@@ -28,12 +40,21 @@ char directory[SIZE];
  * @property {int} Status - The "Status" property in the job struct represents the current status of
  * the job. It is an integer value that can be used to indicate different states/conditions of the job.
  * @property {int} pid - The "pid" property in the "job" struct represents the process ID of the job.
+ * It is also the process group of the job, which holds every stage of a background pipeline.
+ * @property {int} Stages - The number of processes of the job that have not been reaped yet.
+ * @property {long long} TraceStart - The exec time of the job, used for its run span when tracing.
+ * @property {int} ExitStatus - The exit status of the first process of the job, once it is reaped.
+ * @property {int} Quiet - 1 for the iterations of a parallel `for` loop, which are not announced.
  */
 typedef struct job {
     char *Name;
     int Index;
     int Status;
     int pid;
+    int Stages;
+    long long TraceStart;
+    int ExitStatus;
+    int Quiet;
 } job;
 
 
@@ -50,6 +71,354 @@ job foregroundJob;
 int FPID[SIZE];
 int numForegroundProcesses;
 
+/**
+ * The below type defines a struct called "arenaBlock", one chunk of memory of a bump allocator.
+ * @property {arenaBlock} next - The next block of the arena.
+ * @property {size_t} size - The number of usable bytes in `data`.
+ * @property {size_t} used - The number of bytes handed out so far.
+ * @property {char} data - The memory itself.
+ */
+typedef struct arenaBlock {
+    struct arenaBlock *next;
+    size_t size;
+    size_t used;
+    char data[];
+} arenaBlock;
+
+/**
+ * The below type defines a struct called "arena", a bump allocator whose allocations are all released
+ * at once by `arenaReset`.
+ * @property {arenaBlock} first - The first of the blocks kept between resets.
+ * @property {arenaBlock} current - The block allocations are currently taken from.
+ * @property {arenaBlock} oversized - Blocks made for single large requests, freed on every reset.
+ */
+typedef struct arena {
+    arenaBlock *first;
+    arenaBlock *current;
+    arenaBlock *oversized;
+} arena;
+
+#define ARENA_BLOCK_SIZE (64 * 1024)
+#define ARENA_ALIGNMENT 16
+
+// Everything that only lives for one command line (input, expansions, foreground job name)
+arena commandArena;
+
+#define JOB_NAME_SIZE 256
+#define JOB_SLAB_CHUNK 32
+
+/**
+ * The below type defines a union called "jobNameSlot", one fixed-size slot of the slab that holds
+ * the names of long-lived job records. A free slot stores the link of the free list instead.
+ */
+typedef union jobNameSlot {
+    union jobNameSlot *next;
+    char text[JOB_NAME_SIZE];
+} jobNameSlot;
+
+// Free slots of the job name slab
+jobNameSlot *jobNameFreeList;
+
+// Exit status of the last foreground command, returned by `-c` and script mode
+int lastExitStatus;
+// Set when the last foreground command was stopped instead of finishing
+int foregroundStopped;
+
+#define NAME_TABLE_SIZE 64
+
+/**
+ * The below type defines a struct called "nameEntry" for one alias or shell function, chained in the
+ * bucket of a `nameTable`.
+ * @property {char} name - The name of the alias or function.
+ * @property {char} value - The text an alias is replaced by, or the body text of a function.
+ * @property {char} statements - The `;`-separated statements of a function body, split once when the
+ * function is defined.
+ * @property {int} statementCount - The number of statements of the body.
+ * @property {size_t} valueCapacity - The size of the buffer of a variable's value, which is reused when
+ * the value fits.
+ * @property {nameEntry} next - The next entry of the same bucket.
+ */
+typedef struct nameEntry {
+    char *name;
+    char *value;
+    char **statements;
+    int statementCount;
+    size_t valueCapacity;
+    struct nameEntry *next;
+} nameEntry;
+
+// A hash table from names to entries, with the FNV-1a hash of the name picking the bucket
+typedef struct nameTable {
+    nameEntry *buckets[NAME_TABLE_SIZE];
+} nameTable;
+
+nameTable aliasTable;
+nameTable functionTable;
+
+// Variables set by `for` loops, expanded as $name or ${name}
+nameTable variableTable;
+
+#define MAX_POSITIONAL 64
+#define FUNCTION_DEPTH_LIMIT 100
+
+/**
+ * The below type defines a struct called "positionalParameters" holding $0 and $1, $2, ... of the
+ * script or of the function being run.
+ * @property {char} name - The value of $0.
+ * @property {int} count - The number of parameters ($#).
+ * @property {char} values - The parameters.
+ */
+typedef struct positionalParameters {
+    const char *name;
+    int count;
+    char *values[MAX_POSITIONAL];
+} positionalParameters;
+
+positionalParameters positional = { "quash", 0, { NULL } };
+
+// Number of shell function calls currently running, bounded by FUNCTION_DEPTH_LIMIT
+int functionDepth;
+
+#define STATEMENT_DEPTH_LIMIT 256
+
+/**
+ * The below type defines a struct called "scratchBuffer", a buffer that only grows, for the copies of
+ * the statements a function call or a loop runs.
+ * @property {char} text - The buffer, or NULL before its first use.
+ * @property {size_t} capacity - The size of the buffer.
+ */
+typedef struct scratchBuffer {
+    char *text;
+    size_t capacity;
+} scratchBuffer;
+
+// One scratch buffer per nesting level of the running calls and loops, kept for the next one at the level
+scratchBuffer statementScratch[STATEMENT_DEPTH_LIMIT];
+// Number of statementScratch levels in use
+int statementDepth;
+
+// Set while running the last line of a `-c` string or script, where a simple command may replace the shell
+int tailExecAllowed;
+
+// Set in a `--serve` worker, which runs every command of its session and so never replaces itself
+int serverWorker;
+
+/**
+ * The below type defines a struct called "launchAttributes" that describes where and how a launched
+ * command should run. It is filled in from the `taskset`, `nice` and `chrt` prefixes and applied in
+ * the child between fork and exec.
+ * @property {cpu_set_t} cpus - The set of CPUs the command is allowed to run on.
+ * @property {int} hasAffinity - Set to 1 when `cpus` should be applied with sched_setaffinity.
+ * @property {int} niceValue - The niceness increment added to the child with setpriority.
+ * @property {int} hasNice - Set to 1 when `niceValue` should be applied.
+ * @property {int} policy - The scheduling class (SCHED_OTHER, SCHED_FIFO, SCHED_RR, ...).
+ * @property {int} schedPriority - The static priority used together with `policy`.
+ * @property {int} hasPolicy - Set to 1 when `policy` should be applied with sched_setscheduler.
+ */
+typedef struct launchAttributes {
+    cpu_set_t cpus;
+    int hasAffinity;
+    int niceValue;
+    int hasNice;
+    int policy;
+    int schedPriority;
+    int hasPolicy;
+} launchAttributes;
+
+// Attributes set by a bare `taskset`/`nice`/`chrt` builtin, inherited by every later launch
+launchAttributes sessionAttributes;
+
+#define MAX_REDIRECTIONS 16
+// A redirection can touch two descriptors (`&>` writes stdout and stderr)
+#define MAX_SAVED_FDS (2 * MAX_REDIRECTIONS)
+
+// The forms of fd redirection understood by quash
+enum redirectionKind {
+    REDIRECT_INPUT,                 // [N]<file
+    REDIRECT_OUTPUT,                // [N]>file, [N]>|file
+    REDIRECT_APPEND,                // [N]>>file
+    REDIRECT_READ_WRITE,            // [N]<>file
+    REDIRECT_DUPLICATE,             // [N]>&M, [N]<&M
+    REDIRECT_CLOSE,                 // [N]>&-, [N]<&-
+    REDIRECT_OUTPUT_AND_ERROR,      // &>file, >&file
+    REDIRECT_APPEND_OUTPUT_AND_ERROR // &>>file
+};
+
+/**
+ * The below type defines a struct called "redirection" holding one parsed redirection of a command.
+ * @property {int} fd - The descriptor being redirected (0 for `<` forms, 1 for `>` forms by default).
+ * @property {int} kind - One of the `redirectionKind` values.
+ * @property {const char} target - The file name for the forms that open a file.
+ * @property {int} sourceFd - The descriptor copied by `REDIRECT_DUPLICATE`.
+ */
+typedef struct redirection {
+    int fd;
+    int kind;
+    const char *target;
+    int sourceFd;
+} redirection;
+
+/**
+ * The below type defines a struct called "redirectionList" with the redirections of one command in
+ * the order they were written, which is also the order they are applied in.
+ * @property {int} count - The number of redirections.
+ * @property {redirection} items - The redirections.
+ */
+typedef struct redirectionList {
+    int count;
+    redirection items[MAX_REDIRECTIONS];
+} redirectionList;
+
+#define MAX_SUBSTITUTIONS 16
+
+/**
+ * The below type defines a struct called "processSubstitution" for one `<(cmd)` or `>(cmd)` of the
+ * current command.
+ * @property {int} pid - The process running the substituted command.
+ * @property {int} fd - The shell's end of the pipe, passed to the command as `/dev/fd/<fd>`.
+ */
+typedef struct processSubstitution {
+    int pid;
+    int fd;
+} processSubstitution;
+
+// Process substitutions of the command being run; reaped together with it
+processSubstitution substitutions[MAX_SUBSTITUTIONS];
+int substitutionCount;
+
+// Substituted commands of background jobs, reaped by the SIGCHLD handler
+int detachedSubstitutionPids[SIZE];
+int detachedSubstitutionCount;
+
+/**
+ * The below type defines a struct called "traceEvent" holding one recorded span of the
+ * `QUASH_TRACE` mode. Spans are buffered per session and written out as Chrome trace JSON.
+ * @property {char} name - The phase of the span (tokenize, spawn, exec, first-output, run, command).
+ * @property {char} command - The command (or command line) the span belongs to.
+ * @property {int} tid - The process the span describes; each child gets its own track.
+ * @property {long long} start - The monotonic start time in nanoseconds.
+ * @property {long long} duration - The length of the span in nanoseconds.
+ */
+typedef struct traceEvent {
+    const char *name;
+    char command[64];
+    int tid;
+    long long start;
+    long long duration;
+} traceEvent;
+
+/**
+ * The below type defines a struct called "traceLaunch" that carries the timestamps and pipes used to
+ * trace one fork/exec. The exec pipe is close-on-exec, so its read end sees EOF the moment the child
+ * execs; the output pipe is only used when the shell relays the child's stdout to time its first write.
+ */
+typedef struct traceLaunch {
+    long long forkStart;
+    long long forkEnd;
+    long long execStart;
+    int execPipe[2];
+    int outputPipe[2];
+} traceLaunch;
+
+#define TRACE_BUFFER_SIZE 4096
+
+// Tracing state. When QUASH_TRACE is unset, `traceEnabled` is the only thing the launch paths look at.
+int traceEnabled;
+// Set by QUASH_TRACE_OUTPUT: relay foreground stdout through the shell to time the first output
+int traceRelayEnabled;
+char *traceFileName;
+FILE *traceStream;
+pid_t traceSessionPid;
+long long traceOrigin;
+traceEvent traceBuffer[TRACE_BUFFER_SIZE];
+int traceCount;
+int traceWrittenEvents;
+
+/**
+ * The below type defines a struct called "directoryListing", one cached pass over a directory.
+ * All names live in one growing block of the command arena, so a directory with a million entries
+ * costs a handful of allocations instead of a million.
+ * @property {char} path - The directory that was read.
+ * @property {char} names - The block holding every name, each terminated by '\0'.
+ * @property {size_t} offsets - The start of each name inside `names`.
+ * @property {signed char} isDirectory - 1 for directories, 0 for other files, -1 if not known yet.
+ * @property {int} count - The number of entries in the listing.
+ */
+typedef struct directoryListing {
+    char *path;
+    char *names;
+    size_t *offsets;
+    signed char *isDirectory;
+    int count;
+} directoryListing;
+
+#define GLOB_CACHE_SIZE 64
+#define GLOB_READ_SIZE (32 * 1024)
+
+// Directory listings read while expanding the current command line, dropped before the next one
+directoryListing globCache[GLOB_CACHE_SIZE];
+int globCacheCount;
+
+/* Frames of the `--serve` protocol: a type byte, a big-endian 32-bit length, then the payload.
+   A command's status comes in an exit frame, or in a close frame when the session ended with it. */
+#define FRAME_HEADER_SIZE 5
+#define FRAME_COMMAND 'C'
+#define FRAME_STDOUT 'O'
+#define FRAME_STDERR 'E'
+#define FRAME_EXIT 'X'
+#define FRAME_CLOSE 'Q'
+#define SERVER_REQUEST_LIMIT (64 * 1024)
+#define SERVER_CHUNK_SIZE (64 * 1024)
+#define SERVER_CLIENT_LIMIT 64
+// How long a hung-up worker may take to exit before it is killed, and how often it is checked on
+#define SERVER_HANGUP_GRACE_MS 2000
+#define SERVER_REAP_INTERVAL_MS 50
+
+/**
+ * The below type defines a struct called "serverClient", one connection of the `--serve` mode.
+ * @property {int} socket - The connection, or -1 once it is closed.
+ * @property {int} pid - The worker of the session (also its process group), or 0 once it is reaped.
+ * The slot is free when both are unset; a closed connection keeps its slot until its worker is reaped.
+ * @property {long long} hangupDeadline - When a hung-up worker gets SIGKILL, or 0 once it has.
+ * @property {int} output - The read ends of the worker's stdout and stderr pipes, -1 once closed.
+ * @property {int} commands - The write end of the pipe the worker reads its commands from.
+ * @property {int} statuses - The read end of the pipe the worker reports the status of each command
+ * on, -1 once the worker has closed it.
+ * @property {int} running - Set from the moment a command is handed to the worker until its status
+ * has been read.
+ * @property {int} exitReady - Set when the status of a command has been read; its exit frame goes out
+ * once the output the command left in the pipes has been relayed.
+ * @property {uint32_t} exitStatus - That status.
+ * @property {int} closing - Set when the worker has ended; the connection is closed after the last frame.
+ * @property {size_t} requestLength - The number of request bytes received but not yet handed over.
+ * @property {size_t} requestSent - The number of bytes of the first request written to the worker.
+ * @property {size_t} pendingStart - The first byte of `pending` not sent to the client yet.
+ * @property {size_t} pendingEnd - The end of the frame waiting in `pending`.
+ * @property {char} request - Received request bytes, which may hold more than one frame.
+ * @property {char} pending - The one frame being sent. Worker output is only read when it is empty,
+ * so a slow client slows down its own worker and nobody else.
+ */
+typedef struct serverClient {
+    int socket;
+    int pid;
+    long long hangupDeadline;
+    int output[2];
+    int commands;
+    int statuses;
+    int running;
+    int exitReady;
+    uint32_t exitStatus;
+    int closing;
+    size_t requestLength;
+    size_t requestSent;
+    size_t pendingStart;
+    size_t pendingEnd;
+    char request[FRAME_HEADER_SIZE + SERVER_REQUEST_LIMIT + 1];
+    char pending[FRAME_HEADER_SIZE + SERVER_CHUNK_SIZE];
+} serverClient;
+
+serverClient serverClients[SERVER_CLIENT_LIMIT];
+
 
 // The function sets the text color to red.
 void setTextColorRed() {
@@ -97,384 +466,2324 @@ void getCurrentDir() {
 }
 
 /**
- * The function "checkRedirection" checks if any of the arguments contain redirection symbols ("<",
- * ">", or ">>").
- * 
- * @param numArgs The parameter `numArgs` represents the number of arguments passed to the function.
- * @param arguments An array of strings representing the command line arguments passed to the program.
- * 
- * @return 1 if any of the arguments in the array "arguments" is "<", ">", or ">>". Otherwise, it is
- * returning 0.
- */
-int checkRedirection(int numArgs, char *arguments[]) {
-   for (int i = 0; i < numArgs; i++) {
-       if (strcmp(arguments[i], "<") == 0)
-           return 1;
-       else if(strcmp(arguments[i], ">") == 0)
-           return 1;
-       else if(strcmp(arguments[i], ">>") == 0 )
-           return 1;
-   }
-   return 0;
-}
-
-/**
- * The function `redirectionHandler` handles input and output redirection.
- * 
- * @param totalArgs The total number of arguments in the argList array.
- * @param argList An array of strings representing the command and its arguments. The first element
- * (argList[0]) is the command itself, and the rest of the elements are the arguments.
- * 
- * @return an integer value. The return value is 0 if the function executes successfully, and -1 if
- * there is an error.
- */
-int redirectionHandler(int totalArgs, char *argList[]) {    
-    // declaring two character arrays, `inputFile` and `outputFile`, each with a size of 10000 characters.
-    char inputFile[10000], outputFile[10000];
-    int inputPos = 0, outputPos = 0, appendPos = 0;
-    int inputDup, outputDup;
-    int pos = 100;
-    int inputpipeFileDescriptors, outputpipeFileDescriptors;
-
-    /* Iterating through an array of strings called `argList` and checking each string for specific.
-    If a string is equal to "<", it sets the variable `inputPos` to the current index. If a string is
-    equal to ">", it sets the variable `outputPos` to the current index. If a string is equal to ">>",
-    it sets the variable `appendPos` to the current index. */
-    for(int i = 0; i < totalArgs; i++) {
-        if(strcmp(argList[i], "<") == 0) 
-            inputPos = i;
-        if(strcmp(argList[i], ">") == 0) 
-            outputPos = i;
-        if(strcmp(argList[i], ">>") == 0) 
-            appendPos = i;
-    }
-
-
-    /* Checking if the input position is not 0. If it is not 0, it copies the input file name from
-    the argument list into the inputFile variable. It then sets the pos variable to the input
-    position and sets the argument at that position to NULL. */
-    if(inputPos != 0) {
-        strcpy(inputFile, argList[inputPos + 1]);
-        pos = inputPos;
-        argList[pos] = NULL;
-        struct stat fileStatus;
-        if(stat(inputFile, &fileStatus) < 0) {
-            perror("Stat ");
-            return -1;
-        }
-
-        inputDup = dup(STDIN_FILENO);
-        if (inputDup < 0) {
-            perror("Dup ");
-            return -1;
-        }
+ * The function `arenaAlloc` hands out `size` bytes from an arena by bumping a pointer. Blocks are kept
+ * across `arenaReset`, so once the shell has warmed up a command line is processed without calling
+ * malloc. Requests larger than a quarter block get a dedicated block that is freed on reset.
+ *
+ * @param a The arena to allocate from.
+ * @param size The number of bytes needed.
+ *
+ * @return a pointer to the memory, aligned to ARENA_ALIGNMENT.
+ */
+void *arenaAlloc(arena *a, size_t size) {
+    size = (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
 
-        inputpipeFileDescriptors = open(inputFile, O_RDONLY, FILE_PERMISSIONS);
-        if (inputpipeFileDescriptors < 0) {
-            printf("File doesn't exist!\n");
-            return -1;
-        }   
-        if (dup2(inputpipeFileDescriptors, STDIN_FILENO) < 0) {
-            perror("Dup2 ");
-            return -1;
+    if (size > ARENA_BLOCK_SIZE / 4) {
+        arenaBlock *block = malloc(sizeof(arenaBlock) + size);
+        if (block == NULL) {
+            perror("malloc ");
+            exit(EXIT_FAILURE);
         }
+        block->size = block->used = size;
+        block->next = a->oversized;
+        a->oversized = block;
+        return block->data;
     }
-    
-    if(outputPos != 0 || appendPos != 0) {
-        if(outputPos + appendPos <= pos)
-            pos = outputPos + appendPos;
-        strcpy(outputFile, argList[outputPos + appendPos + 1]);
-        argList[pos] = NULL;
-        outputDup = dup(STDOUT_FILENO);
-        if (outputDup < 0) {
-            perror("Dup ");
-            return -1;
-        }
-
-        if(outputPos != 0)
-            outputpipeFileDescriptors = open(outputFile, O_WRONLY | O_CREAT | O_TRUNC, FILE_PERMISSIONS);
-        else
-            outputpipeFileDescriptors = open(outputFile, O_WRONLY | O_CREAT | O_APPEND, FILE_PERMISSIONS);
-
-        if (outputpipeFileDescriptors < 0) {
-            printf("File doesn't exist!\n");
-            return -1;
-        }  
 
-        if(dup2(outputpipeFileDescriptors, STDOUT_FILENO) < 0)
-        {
-            perror("Dup2 ");
-            return -1;
+    /* Moving on to the next retained block (or a brand new one) when the current block is full. */
+    if (a->current == NULL || a->current->used + size > a->current->size) {
+        if (a->current != NULL && a->current->next != NULL) {
+            a->current = a->current->next;
+        } else {
+            arenaBlock *block = malloc(sizeof(arenaBlock) + ARENA_BLOCK_SIZE);
+            if (block == NULL) {
+                perror("malloc ");
+                exit(EXIT_FAILURE);
+            }
+            block->size = ARENA_BLOCK_SIZE;
+            block->next = NULL;
+            if (a->current != NULL)
+                a->current->next = block;
+            else
+                a->first = block;
+            a->current = block;
         }
+        a->current->used = 0;
     }
 
-    /* Creating a child process using the fork() system call. If the fork() call is successful
-    the child process executes the command specified in the argList using the execvp() system
-    call. If the execvp() call fails, an error message is printed and -1 is returned. */
-    pid_t pidValue;
-    pidValue = fork();
-    if(pidValue < 0) {
-        close(outputpipeFileDescriptors);
-        perror("Fork ");
-        return -1;
-    }
-    if(pidValue == 0) {
-        if(execvp(argList[0], argList) < 0) {
-            perror("Execvp ");
-            return -1;
-        }
-    }
-    else {
-        wait(NULL);
-        dup2(inputDup, STDIN_FILENO);
-        dup2(outputDup, STDOUT_FILENO);
-    }   
-    return 0;
+    void *memory = a->current->data + a->current->used;
+    a->current->used += size;
+    return memory;
 }
 
-// Check for the presence of pipes in the arguments
 /**
- * The function checks if there are any pipe characters ("|") in an array of arguments.
- * 
- * @param arguments An array of strings representing command line arguments. Each element in the array
- * is a separate argument.
- * @param argumentCount The parameter "argumentCount" is the number of elements in the "arguments"
- * array.
- * 
- * @return an integer value. If the function finds a pipe symbol "|" in the array of arguments, it
- * returns 1. Otherwise, it returns 0.
+ * The function `arenaGrow` resizes an arena allocation. The most recent allocation of a block is
+ * extended in place when it fits; otherwise the contents are copied to a new allocation.
+ *
+ * @param a The arena holding the allocation.
+ * @param old The allocation to grow, or NULL.
+ * @param oldSize The current size of the allocation.
+ * @param newSize The size needed.
+ *
+ * @return the (possibly moved) allocation.
  */
-int checkForPipes(char* arguments[], int argumentCount) {
-	for (int i = 0; i < argumentCount; i++) {
-       if (strcmp(arguments[i], "|") == 0)
-          return 1;
-  }
-  return 0;
+void *arenaGrow(arena *a, void *old, size_t oldSize, size_t newSize) {
+    size_t alignedOld = (oldSize + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+    size_t alignedNew = (newSize + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+    arenaBlock *block = a->current;
+    if (old != NULL && block != NULL && (char *)old + alignedOld == block->data + block->used &&
+        block->used - alignedOld + alignedNew <= block->size) {
+        block->used = block->used - alignedOld + alignedNew;
+        return old;
+    }
+    void *memory = arenaAlloc(a, newSize);
+    if (old != NULL)
+        memcpy(memory, old, oldSize);
+    return memory;
 }
 
 /**
- * The `piping` function takes a command and the number of arguments, tokenizes the command by pipes,
- * sets up file descriptors for input and output, forks child processes to execute each command, and
- * handles redirection if needed.
- * 
- * @param command The `command` parameter in the `piping` function is a string that represents the
- * entire command to be executed, including any arguments and pipes. It is used to split the command
- * into individual pipe commands.
- * @param argumentCount The parameter `argumentCount` represents the number of arguments passed to the
- * `piping` function. It is used to determine the size of the `commandArgument` array in the
- * `handleForegroundChild` function.
+ * The function `arenaStrdup` copies a string into an arena.
+ *
+ * @param a The arena to allocate from.
+ * @param text The string to copy.
+ *
+ * @return the copy.
  */
+char *arenaStrdup(arena *a, const char *text) {
+    size_t length = strlen(text) + 1;
+    char *copy = arenaAlloc(a, length);
+    memcpy(copy, text, length);
+    return copy;
+}
 
-void piping(char *command, int argumentCount) {  
-    char* pipedCommands[100];
-    int numPipes = 0;
-    tokenizeInput(pipedCommands, command, "|", &numPipes);
-
-    int pipeFileDescriptors[2];
-    int originalInput = dup(STDIN_FILENO);
-    int originalOutput = dup(STDOUT_FILENO);
+/**
+ * The function `arenaReset` releases everything allocated from an arena in one step. Regular blocks
+ * are kept for reuse; only oversized blocks go back to the system.
+ *
+ * @param a The arena to reset.
+ */
+void arenaReset(arena *a) {
+    while (a->oversized != NULL) {
+        arenaBlock *next = a->oversized->next;
+        free(a->oversized);
+        a->oversized = next;
+    }
+    a->current = a->first;
+    if (a->current != NULL)
+        a->current->used = 0;
+}
 
-    /* Implementing a shell command that handles piped commands. It takes a string of
-    piped commands as input and executes them using the `execvp` function. */
-    for (int i = 0; i  < numPipes; i++) {
-        int lenOfEachPipeCommand = 0;
-        char *singlePipeCommand[10000];
-        tokenizeInput(singlePipeCommand, pipedCommands[i], " \t", &lenOfEachPipeCommand);
-        /* Setting up a pipeline for inter-process communication. It is creating multiple pipes
-        and redirecting the standard input and output of each process to the appropriate pipe file
-        descriptors. This allows the processes to pass data between each other through the pipes. */
-        if (i == 0) {
-            pipe(pipeFileDescriptors);
-            dup2(pipeFileDescriptors[1], STDOUT_FILENO); 
-            close(pipeFileDescriptors[1]);
-        }
-        else if(i == numPipes - 1) {
-            dup2(pipeFileDescriptors[0], STDIN_FILENO);
-            dup2(originalOutput,1);
-        }
-        else {
-            dup2(pipeFileDescriptors[0], STDIN_FILENO);
-            pipe(pipeFileDescriptors);
-            dup2(pipeFileDescriptors[1], STDOUT_FILENO); 
-            close(pipeFileDescriptors[1]);
-        }
-        int pid_fork = fork();
-        int status;
-        if(pid_fork == 0) {
-            if(checkRedirection(lenOfEachPipeCommand, singlePipeCommand) == 1) {
-                // Handle redirection if needed
-                redirectionHandler(lenOfEachPipeCommand, singlePipeCommand);
-            }
-            else {
-                execvp(singlePipeCommand[0], singlePipeCommand);
-            }
-            exit(0);
+/*
+ * The function jobNameAlloc takes a name buffer of JOB_NAME_SIZE bytes from the job slab. The slab
+ * only calls malloc when its free list is empty, a chunk of JOB_SLAB_CHUNK slots at a time.
+ */
+char *jobNameAlloc() {
+    if (jobNameFreeList == NULL) {
+        jobNameSlot *chunk = malloc(JOB_SLAB_CHUNK * sizeof(jobNameSlot));
+        if (chunk == NULL) {
+            perror("malloc ");
+            exit(EXIT_FAILURE);
         }
-        else {
-            waitpid(pid_fork, &status, WUNTRACED);
-            dup2(originalInput, STDIN_FILENO);
-            dup2(originalOutput, STDOUT_FILENO);
+        for (int i = 0; i < JOB_SLAB_CHUNK; i++) {
+            chunk[i].next = jobNameFreeList;
+            jobNameFreeList = &chunk[i];
         }
     }
-    return;
+    jobNameSlot *slot = jobNameFreeList;
+    jobNameFreeList = slot->next;
+    return slot->text;
 }
 
 /**
- * The function `customComparator` compares the names of two job objects.
- * 
- * @param p A pointer to the first element to be compared.
- * @param q The parameter `q` is a pointer to a constant void type.
- * 
- * @return the result of the `strcmp` function, which is an integer representing the comparison result
- * of the two strings.
+ * The function `jobNameFree` returns a name buffer to the job slab.
+ *
+ * @param name A buffer obtained from `jobNameAlloc`.
  */
-int customComparator(const void *p, const void *q){
-    return strcmp(((job*)p)->Name, ((job*)q)->Name);
+void jobNameFree(char *name) {
+    jobNameSlot *slot = (jobNameSlot *)name;
+    slot->next = jobNameFreeList;
+    jobNameFreeList = slot;
 }
 
 /**
- * The function handles the execution of a foreground child process.
- * 
- * @param argumentCount The parameter `argumentCount` represents the number of arguments passed to the
- * function, including the name of the command itself.
- * @param commandArgument An array of strings representing the command and its arguments. The last
- * element of the array should be NULL to indicate the end of the arguments.
+ * The function `buildJobName` writes the words of a command, separated by spaces, into a buffer in a
+ * single pass. A name that does not fit is cut off.
+ *
+ * @param name The buffer receiving the name.
+ * @param size The size of the buffer.
+ * @param argumentCount The number of words to use.
+ * @param commandArgument The words of the command.
  */
-int handleForegroundChild(int argumentCount, char *commandArgument[]) {
-    setpgid(0, 0);
-    commandArgument[argumentCount] = NULL;
-
-    tcsetpgrp(STDIN_FILENO, getpgid(0));
-    signal(SIGINT, SIG_DFL);
-    signal(SIGTSTP, SIG_DFL);
-
-    int execvpResult = execvp(commandArgument[0], commandArgument);
-
-    if(execvpResult < 0){
-        printf("Invalid command!\n");
-        exit(EXIT_FAILURE);
+void buildJobName(char *name, size_t size, int argumentCount, char *commandArgument[]) {
+    size_t used = 0;
+    for (int i = 0; i < argumentCount && used + 1 < size; i++) {
+        if (i > 0)
+            name[used++] = ' ';
+        size_t length = strlen(commandArgument[i]);
+        if (used + length + 1 > size)
+            length = size - used - 1;
+        memcpy(name + used, commandArgument[i], length);
+        used += length;
     }
-    exit(EXIT_SUCCESS);
+    name[used] = '\0';
 }
 
-/**
- * Handle the parent process in the foreground
- * 
- * @param pid The parameter `pid` is the process ID of the foreground parent process.
- * @param commandArgument commandArgument is an array of strings that represents the command and its
- * arguments. The first element (commandArgument[0]) is the command itself, and the following elements
- * (commandArgument[1], commandArgument[2], etc.) are the arguments for the command.
- * @param argumentCount The parameter `argumentCount` represents the number of arguments passed to the
- * `handleForegroundParent` function.
+/*
+ * The function reclaimCompletedJobs removes the jobs that have completed from the Jobs array and
+ * returns their names to the slab, so the table never runs out of slots in a long session. SIGCHLD is
+ * blocked while the array is compacted because the handler walks the same array.
  */
-void handleForegroundParent(int pid, char *commandArgument[], int argumentCount) {
-    char foregroundCommand[SIZE];
-    strcpy(foregroundCommand, "");
-    strcat(foregroundCommand, commandArgument[0]);
-
-    foregroundJob.pid = pid;
-    foregroundJob.Name = malloc(strlen(commandArgument[0]) * sizeof(char) + 2);
-    strcpy(foregroundJob.Name, commandArgument[0]);
-    foregroundJob.Index = 0;
-
-    int status;
-    if (waitpid(pid, &status, WUNTRACED) < 0)
-        printf("Invalid command");
-
-    foregroundJob.pid = -1;
-
-    tcsetpgrp(STDIN_FILENO, getpgid(0));
-
-    signal(SIGTTIN, SIG_DFL);
-    signal(SIGTTOU, SIG_DFL);
+void reclaimCompletedJobs() {
+    sigset_t blocked, previous;
+    sigemptyset(&blocked);
+    sigaddset(&blocked, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &blocked, &previous);
 
-    /* Checking if a process has been stopped using the WIFSTOPPED macro. If the process
-    has been stopped. */
-    if(WIFSTOPPED(status)){   
-        int len = strlen(foregroundCommand);
-        for (int i = 1; i < argumentCount - 1; i++) {
-            len += strlen(commandArgument[i]);
+    int kept = 0;
+    for (int i = 0; i < JobsNum; i++) {
+        if (Jobs[i].Status == -1) {
+            jobNameFree(Jobs[i].Name);
+            continue;
         }
+        Jobs[kept++] = Jobs[i];
+    }
+    JobsNum = kept;
 
-        Jobs[JobsNum].pid = pid;
-        Jobs[JobsNum].Name = malloc(len * sizeof(char));
-
-        Jobs[JobsNum].Status = 1;
-        Jobs[JobsNum].Index = JobsNum;
+    sigprocmask(SIG_SETMASK, &previous, NULL);
+}
 
-        strcpy(Jobs[JobsNum].Name, commandArgument[0]);
-        for (int i = 1; i < argumentCount - 1; i++) {
-            strcat(Jobs[JobsNum].Name, " ");
-            strcat(Jobs[JobsNum].Name, arguments[i]);
-        }
+/*
+ * The function nextJobIndex returns the job number for a new job: one past the highest number still
+ * in use, like other shells do.
+ */
+int nextJobIndex() {
+    int index = 0;
+    for (int i = 0; i < JobsNum; i++) {
+        if (Jobs[i].Index + 1 > index)
+            index = Jobs[i].Index + 1;
+    }
+    return index;
+}
 
-        JobsNum++;
-        FPID[numForegroundProcesses] = pid;
-        numForegroundProcesses++;
+/**
+ * The function `addJob` records a background or stopped job in the Jobs array, reusing the slots of
+ * completed jobs first. The caller keeps SIGCHLD blocked from the fork until the job is recorded, so
+ * the handler cannot miss the exit of a job that ends right away.
+ *
+ * @param pid The process group of the job (the pid of its first process).
+ * @param stages The number of processes in the group.
+ * @param name The name of the job, taken from the job slab.
+ *
+ * @return the new job record.
+ */
+job *addJob(int pid, int stages, char *name) {
+    reclaimCompletedJobs();
+    job *added = &Jobs[JobsNum];
+    added->pid = pid;
+    added->Stages = stages;
+    added->Name = name;
+    added->Status = 1;
+    added->TraceStart = 0;
+    added->ExitStatus = 0;
+    added->Quiet = 0;
+    added->Index = nextJobIndex();
+    JobsNum++;
+    return added;
+}
 
-        printf("Process %s with process ID [%d] suspended\n", foregroundCommand, (int)pid );
-        return;
-    } else{
-        /* Checking if the variable "status" is equal to 1. If it is, then it prints a message
-        indicating that a process with the name "foregroundCommand" and process ID "pid" has
-        exited. */
-        if (status == 1)
-            printf("Process %s with process ID [%d] exited \n", foregroundCommand, (int)pid );
+/**
+ * The function `hashName` computes the FNV-1a hash of a name and reduces it to a bucket index.
+ *
+ * @param name The name.
+ *
+ * @return the bucket of the name in a `nameTable`.
+ */
+unsigned int hashName(const char *name) {
+    unsigned int hash = 2166136261u;
+    for (; *name != '\0'; name++) {
+        hash ^= (unsigned char)*name;
+        hash *= 16777619u;
     }
+    return hash & (NAME_TABLE_SIZE - 1);
 }
 
 /**
- * The function executes a foreground process by forking a child process and handling the child and
- * parent processes accordingly.
- * 
- * @param argumentCount The parameter `argumentCount` represents the number of arguments passed to the
- * function. It is of type `int` and is used to determine the number of command line arguments passed
- * to the program.
- * @param commandArgument The `commandArgument` parameter is an array of strings that represents the
- * command and its arguments. Each element in the array is a separate argument passed to the command.
+ * The function `lookupName` finds the entry of a name in a table.
+ *
+ * @param table The alias or function table.
+ * @param name The name to look up.
+ *
+ * @return the entry, or NULL if the name is not defined.
  */
-void executeForegroundProcess(int argumentCount, char *commandArgument[]) {
-    signal(SIGTTIN, SIG_IGN);
-    signal(SIGTTOU, SIG_IGN);
-
-    int pid = fork();
+nameEntry *lookupName(nameTable *table, const char *name) {
+    for (nameEntry *entry = table->buckets[hashName(name)]; entry != NULL; entry = entry->next) {
+        if (strcmp(entry->name, name) == 0)
+            return entry;
+    }
+    return NULL;
+}
 
-    /* Checking if the process ID (pid) is equal to 0. If it is, it calls the function
-    handleForegroundChild with the arguments argumentCount and commandArgument. If the pid is not
-    equal to 0, it calls the function handleForegroundParent with the arguments pid, commandArgument,
-    and argumentCount. After that, it frees the memory allocated for the foregroundJob.Name. */
-    if (pid == 0) {
-        handleForegroundChild(argumentCount, commandArgument);
+/**
+ * The function `defineName` returns the entry of a name, creating an empty one if the name is new.
+ * The previous value of an existing entry is released, so the caller can fill in the new one.
+ *
+ * @param table The alias or function table.
+ * @param name The name to define.
+ *
+ * @return the entry.
+ */
+nameEntry *defineName(nameTable *table, const char *name) {
+    nameEntry *entry = lookupName(table, name);
+    if (entry != NULL) {
+        free(entry->value);
+        free(entry->statements);
     } else {
-        handleForegroundParent(pid, commandArgument, argumentCount);
-        free(foregroundJob.Name);
+        unsigned int bucket = hashName(name);
+        entry = malloc(sizeof(nameEntry));
+        if (entry == NULL) {
+            perror("malloc ");
+            exit(EXIT_FAILURE);
+        }
+        entry->name = strdup(name);
+        entry->next = table->buckets[bucket];
+        table->buckets[bucket] = entry;
     }
+    entry->value = NULL;
+    entry->statements = NULL;
+    entry->statementCount = 0;
+    entry->valueCapacity = 0;
+    return entry;
 }
 
-/*
+/**
+ * The function `removeName` deletes a name from a table.
+ *
+ * @param table The alias or function table.
+ * @param name The name to delete.
+ *
+ * @return 1 if the name was defined, otherwise 0.
+ */
+int removeName(nameTable *table, const char *name) {
+    for (nameEntry **link = &table->buckets[hashName(name)]; *link != NULL; link = &(*link)->next) {
+        nameEntry *entry = *link;
+        if (strcmp(entry->name, name) == 0) {
+            *link = entry->next;
+            free(entry->name);
+            free(entry->value);
+            free(entry->statements);
+            free(entry);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * The function `parseCpuList` parses a taskset-style CPU list such as "0,2-5" into a cpu_set_t.
+ *
+ * @param list The CPU list given after `taskset -c`.
+ * @param cpus The set that receives the parsed CPUs.
+ *
+ * @return 0 if the list is valid, -1 otherwise.
+ */
+int parseCpuList(const char *list, cpu_set_t *cpus) {
+    CPU_ZERO(cpus);
+    const char *cursor = list;
+    while (*cursor != '\0') {
+        char *end;
+        long first = strtol(cursor, &end, 10);
+        long last = first;
+        if (end == cursor || first < 0)
+            return -1;
+        /* A dash introduces a range, so every CPU between `first` and `last` is added. */
+        if (*end == '-') {
+            cursor = end + 1;
+            last = strtol(cursor, &end, 10);
+            if (end == cursor || last < first)
+                return -1;
+        }
+        if (last >= CPU_SETSIZE)
+            return -1;
+        for (long cpu = first; cpu <= last; cpu++)
+            CPU_SET(cpu, cpus);
+        if (*end == ',')
+            end++;
+        else if (*end != '\0')
+            return -1;
+        cursor = end;
+    }
+    return CPU_COUNT(cpus) > 0 ? 0 : -1;
+}
+
+/**
+ * The function `parseCpuMask` parses a taskset-style hexadecimal mask such as "0x5" into a cpu_set_t.
+ *
+ * @param mask The hexadecimal mask, with or without a leading "0x".
+ * @param cpus The set that receives the parsed CPUs.
+ *
+ * @return 0 if the mask is valid, -1 otherwise.
+ */
+int parseCpuMask(const char *mask, cpu_set_t *cpus) {
+    CPU_ZERO(cpus);
+    if (strncmp(mask, "0x", 2) == 0 || strncmp(mask, "0X", 2) == 0)
+        mask += 2;
+    int length = strlen(mask);
+    if (length == 0)
+        return -1;
+    /* Walking the mask from its last digit, every hex digit contributes four CPUs. */
+    for (int i = 0; i < length; i++) {
+        char digit = mask[length - 1 - i];
+        int value;
+        if (digit >= '0' && digit <= '9')
+            value = digit - '0';
+        else if (digit >= 'a' && digit <= 'f')
+            value = digit - 'a' + 10;
+        else if (digit >= 'A' && digit <= 'F')
+            value = digit - 'A' + 10;
+        else
+            return -1;
+        for (int bit = 0; bit < 4; bit++) {
+            if ((value & (1 << bit)) && i * 4 + bit < CPU_SETSIZE)
+                CPU_SET(i * 4 + bit, cpus);
+        }
+    }
+    return CPU_COUNT(cpus) > 0 ? 0 : -1;
+}
+
+/**
+ * The function `parseBoundedInt` parses a whole word as a decimal integer between `low` and `high`.
+ *
+ * @param word The word to parse.
+ * @param low The smallest accepted value.
+ * @param high The largest accepted value.
+ * @param value The parsed value.
+ *
+ * @return 0 if the word is such an integer, -1 otherwise.
+ */
+int parseBoundedInt(const char *word, long low, long high, int *value) {
+    char *end;
+    errno = 0;
+    long parsed = strtol(word, &end, 10);
+    if (end == word || *end != '\0' || errno == ERANGE || parsed < low || parsed > high)
+        return -1;
+    *value = parsed;
+    return 0;
+}
+
+/**
+ * The function `parseLaunchPrefixes` strips leading `taskset`, `nice` and `chrt` prefixes from a
+ * command and records what they ask for in `attributes`. Prefixes can be stacked, for example
+ * `taskset -c 2 nice -n 5 chrt -b 0 make`.
+ *
+ * @param argumentCount A pointer to the number of arguments, updated when prefixes are removed.
+ * @param commandArgument The command and its arguments. Prefix words are shifted out in place.
+ * @param attributes The launch attributes that receive the parsed settings.
+ *
+ * @return 0 on success, -1 if a prefix is malformed.
+ */
+int parseLaunchPrefixes(int *argumentCount, char *commandArgument[], launchAttributes *attributes) {
+    memset(attributes, 0, sizeof(*attributes));
+
+    while (*argumentCount > 0 && commandArgument[0] != NULL) {
+        int consumed = 0;
+
+        /* `taskset -c LIST` or `taskset MASK` pins the command to a set of CPUs. */
+        if (strcmp(commandArgument[0], "taskset") == 0) {
+            if (*argumentCount >= 3 && strcmp(commandArgument[1], "-c") == 0) {
+                if (parseCpuList(commandArgument[2], &attributes->cpus) < 0) {
+                    fprintf(stderr, "taskset: invalid cpu list '%s'\n", commandArgument[2]);
+                    return -1;
+                }
+                consumed = 3;
+            } else if (*argumentCount >= 2 && parseCpuMask(commandArgument[1], &attributes->cpus) == 0) {
+                consumed = 2;
+            } else {
+                fprintf(stderr, "taskset: usage: taskset [-c list | mask] [command]\n");
+                return -1;
+            }
+            attributes->hasAffinity = 1;
+        }
+        /* `nice [-n N | -N]` adds N (10 by default) to the niceness of the command. */
+        else if (strcmp(commandArgument[0], "nice") == 0) {
+            const char *adjustment = NULL;
+            attributes->niceValue = 10;
+            consumed = 1;
+            if (*argumentCount >= 2 && strcmp(commandArgument[1], "-n") == 0) {
+                adjustment = *argumentCount >= 3 ? commandArgument[2] : "";
+                consumed = 3;
+            } else if (*argumentCount >= 2 && commandArgument[1][0] == '-' && commandArgument[1][1] != '\0') {
+                adjustment = commandArgument[1] + 1;
+                consumed = 2;
+            }
+            /* The kernel clamps the niceness to -20..19, so anything within twice that range is accepted. */
+            if (adjustment != NULL && parseBoundedInt(adjustment, -40, 40, &attributes->niceValue) < 0) {
+                fprintf(stderr, "nice: invalid adjustment '%s'\n", adjustment);
+                fprintf(stderr, "nice: usage: nice [-n N | -N] [command]\n");
+                return -1;
+            }
+            attributes->hasNice = 1;
+        }
+        /* `chrt [-f|-r|-o|-b|-i] PRIO` selects the scheduling class, round robin by default. */
+        else if (strcmp(commandArgument[0], "chrt") == 0) {
+            attributes->policy = SCHED_RR;
+            consumed = 1;
+            if (*argumentCount >= 2 && commandArgument[1][0] == '-') {
+                if (strcmp(commandArgument[1], "-f") == 0)
+                    attributes->policy = SCHED_FIFO;
+                else if (strcmp(commandArgument[1], "-r") == 0)
+                    attributes->policy = SCHED_RR;
+                else if (strcmp(commandArgument[1], "-o") == 0)
+                    attributes->policy = SCHED_OTHER;
+                else if (strcmp(commandArgument[1], "-b") == 0)
+                    attributes->policy = SCHED_BATCH;
+                else if (strcmp(commandArgument[1], "-i") == 0)
+                    attributes->policy = SCHED_IDLE;
+                else {
+                    fprintf(stderr, "chrt: unknown policy '%s'\n", commandArgument[1]);
+                    return -1;
+                }
+                consumed = 2;
+            }
+            if (*argumentCount <= consumed) {
+                fprintf(stderr, "chrt: usage: chrt [-f|-r|-o|-b|-i] priority [command]\n");
+                return -1;
+            }
+            if (parseBoundedInt(commandArgument[consumed], 0, 99, &attributes->schedPriority) < 0) {
+                fprintf(stderr, "chrt: invalid priority '%s'\n", commandArgument[consumed]);
+                fprintf(stderr, "chrt: usage: chrt [-f|-r|-o|-b|-i] priority [command]\n");
+                return -1;
+            }
+            consumed++;
+            attributes->hasPolicy = 1;
+        } else {
+            break;
+        }
+
+        /* Shifting the remaining words (and the terminating NULL) over the consumed prefix. */
+        for (int i = consumed; i <= *argumentCount; i++)
+            commandArgument[i - consumed] = commandArgument[i];
+        *argumentCount -= consumed;
+    }
+    return 0;
+}
+
+/**
+ * The function `mergeLaunchAttributes` fills every setting that a command did not give explicitly
+ * from the session defaults.
+ *
+ * @param attributes The per-command attributes, completed in place.
+ */
+void mergeLaunchAttributes(launchAttributes *attributes) {
+    if (!attributes->hasAffinity && sessionAttributes.hasAffinity) {
+        attributes->cpus = sessionAttributes.cpus;
+        attributes->hasAffinity = 1;
+    }
+    if (!attributes->hasNice && sessionAttributes.hasNice) {
+        attributes->niceValue = sessionAttributes.niceValue;
+        attributes->hasNice = 1;
+    }
+    if (!attributes->hasPolicy && sessionAttributes.hasPolicy) {
+        attributes->policy = sessionAttributes.policy;
+        attributes->schedPriority = sessionAttributes.schedPriority;
+        attributes->hasPolicy = 1;
+    }
+}
+
+/**
+ * The function `setSessionAttributes` handles a bare `taskset`, `nice` or `chrt` builtin, i.e. one
+ * without a command, by making its settings the default for every command launched afterwards.
+ *
+ * @param attributes The attributes parsed from the builtin.
+ */
+void setSessionAttributes(const launchAttributes *attributes) {
+    if (attributes->hasAffinity) {
+        sessionAttributes.cpus = attributes->cpus;
+        sessionAttributes.hasAffinity = 1;
+    }
+    if (attributes->hasNice) {
+        sessionAttributes.niceValue = attributes->niceValue;
+        sessionAttributes.hasNice = 1;
+    }
+    if (attributes->hasPolicy) {
+        sessionAttributes.policy = attributes->policy;
+        sessionAttributes.schedPriority = attributes->schedPriority;
+        sessionAttributes.hasPolicy = 1;
+    }
+}
+
+/**
+ * The function `applyLaunchAttributes` runs in a freshly forked child, right before exec, and applies
+ * the CPU affinity, niceness and scheduling class requested for the command. A failure is fatal for
+ * the child so a job never silently runs outside of the placement it asked for.
+ *
+ * @param attributes The attributes of the command, or NULL to use only the session defaults.
+ */
+void applyLaunchAttributes(const launchAttributes *attributes) {
+    launchAttributes effective;
+    if (attributes != NULL)
+        effective = *attributes;
+    else
+        memset(&effective, 0, sizeof(effective));
+    mergeLaunchAttributes(&effective);
+
+    if (effective.hasAffinity && sched_setaffinity(0, sizeof(effective.cpus), &effective.cpus) < 0) {
+        perror("taskset ");
+        _exit(EXIT_FAILURE);
+    }
+    if (effective.hasNice) {
+        /* getpriority() can legitimately return -1, so errno is used to detect failure. */
+        errno = 0;
+        int current = getpriority(PRIO_PROCESS, 0);
+        if ((current == -1 && errno != 0) ||
+            setpriority(PRIO_PROCESS, 0, current + effective.niceValue) < 0) {
+            perror("nice ");
+            _exit(EXIT_FAILURE);
+        }
+    }
+    if (effective.hasPolicy) {
+        struct sched_param parameter;
+        parameter.sched_priority = effective.schedPriority;
+        if (sched_setscheduler(0, effective.policy, &parameter) < 0) {
+            perror("chrt ");
+            _exit(EXIT_FAILURE);
+        }
+    }
+}
+
+/*
+ * The function traceNow returns the monotonic clock in nanoseconds.
+ */
+long long traceNow() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+/**
+ * The function `traceWriteString` writes `text` as a JSON string literal, escaping quotes,
+ * backslashes and control characters.
+ *
+ * @param stream The stream to write to.
+ * @param text The text to write.
+ */
+void traceWriteString(FILE *stream, const char *text) {
+    fputc('"', stream);
+    for (const unsigned char *c = (const unsigned char *)text; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\')
+            fprintf(stream, "\\%c", *c);
+        else if (*c < 0x20)
+            fprintf(stream, "\\u%04x", *c);
+        else
+            fputc(*c, stream);
+    }
+    fputc('"', stream);
+}
+
+/*
+ * The function flushTraceBuffer appends every buffered span to the trace file, opening the file and
+ * writing the JSON header the first time. The stream is flushed right away so a forked child never
+ * inherits unwritten trace data that its own exit() would write a second time.
+ */
+void flushTraceBuffer() {
+    if (traceStream == NULL) {
+        traceStream = fopen(traceFileName, "w");
+        if (traceStream == NULL) {
+            perror("QUASH_TRACE ");
+            traceEnabled = 0;
+            traceCount = 0;
+            return;
+        }
+        fprintf(traceStream, "{\"traceEvents\":[\n");
+    }
+
+    for (int i = 0; i < traceCount; i++) {
+        traceEvent *event = &traceBuffer[i];
+        if (traceWrittenEvents++ > 0)
+            fprintf(traceStream, ",\n");
+        fprintf(traceStream, "{\"name\":\"%s\",\"cat\":\"quash\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,"
+                "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"command\":", event->name, (int)traceSessionPid,
+                event->tid, (event->start - traceOrigin) / 1000.0, event->duration / 1000.0);
+        traceWriteString(traceStream, event->command);
+        fprintf(traceStream, "}}");
+    }
+    traceCount = 0;
+    fflush(traceStream);
+}
+
+/*
+ * The function finishTrace is registered with atexit(). It writes the remaining spans and closes the
+ * JSON document. Forked children run the same atexit handlers, so only the shell itself finishes the file.
+ */
+void finishTrace() {
+    if (!traceEnabled || getpid() != traceSessionPid)
+        return;
+    flushTraceBuffer();
+    if (traceStream != NULL) {
+        fprintf(traceStream, "\n],\"displayTimeUnit\":\"ms\"}\n");
+        fclose(traceStream);
+        traceStream = NULL;
+    }
+}
+
+/*
+ * The function initTrace turns tracing on when the QUASH_TRACE environment variable names a file.
+ * The first-output span needs the child's stdout to go through the shell, which makes it a pipe
+ * instead of the terminal, so it is only recorded when QUASH_TRACE_OUTPUT is set as well.
+ */
+void initTrace() {
+    traceFileName = getenv("QUASH_TRACE");
+    if (traceFileName == NULL || traceFileName[0] == '\0')
+        return;
+    traceEnabled = 1;
+    char *relay = getenv("QUASH_TRACE_OUTPUT");
+    traceRelayEnabled = relay != NULL && relay[0] != '\0' && strcmp(relay, "0") != 0;
+    traceSessionPid = getpid();
+    traceOrigin = traceNow();
+    atexit(finishTrace);
+}
+
+/**
+ * The function `traceSpan` records one span in the session buffer. SIGCHLD is blocked while the
+ * buffer is touched because background jobs record their exit from the SIGCHLD handler.
+ *
+ * @param name The phase of the span.
+ * @param command The command the span belongs to.
+ * @param tid The process the span describes.
+ * @param start The monotonic start time in nanoseconds.
+ * @param end The monotonic end time in nanoseconds.
+ */
+void traceSpan(const char *name, const char *command, int tid, long long start, long long end) {
+    sigset_t blocked, previous;
+    sigemptyset(&blocked);
+    sigaddset(&blocked, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &blocked, &previous);
+
+    if (traceCount == TRACE_BUFFER_SIZE)
+        flushTraceBuffer();
+    if (traceEnabled) {
+        traceEvent *event = &traceBuffer[traceCount++];
+        event->name = name;
+        strncpy(event->command, command != NULL ? command : "", sizeof(event->command) - 1);
+        event->command[sizeof(event->command) - 1] = '\0';
+        event->tid = tid;
+        event->start = start;
+        event->duration = end - start;
+    }
+
+    sigprocmask(SIG_SETMASK, &previous, NULL);
+}
+
+/**
+ * The function `traceBeforeFork` prepares a traced launch: it takes the fork timestamp and creates the
+ * close-on-exec pipe that reports the exec, plus the stdout relay pipe when `relayOutput` is set and
+ * QUASH_TRACE_OUTPUT asked for it.
+ *
+ * @param launch The launch record to fill in.
+ * @param relayOutput 1 if the child's stdout may be relayed through the shell to time its first output.
+ */
+void traceBeforeFork(traceLaunch *launch, int relayOutput) {
+    launch->execPipe[0] = launch->execPipe[1] = -1;
+    launch->outputPipe[0] = launch->outputPipe[1] = -1;
+    if (pipe2(launch->execPipe, O_CLOEXEC) < 0)
+        launch->execPipe[0] = launch->execPipe[1] = -1;
+    if (relayOutput && traceRelayEnabled && pipe2(launch->outputPipe, O_CLOEXEC) < 0)
+        launch->outputPipe[0] = launch->outputPipe[1] = -1;
+    launch->forkStart = traceNow();
+}
+
+/**
+ * The function `traceInChild` runs in the child of a traced launch. It drops the parent's pipe ends
+ * and points stdout at the relay pipe if one was requested.
+ *
+ * @param launch The launch record filled in by `traceBeforeFork`.
+ */
+void traceInChild(traceLaunch *launch) {
+    if (launch->execPipe[0] >= 0)
+        close(launch->execPipe[0]);
+    if (launch->outputPipe[1] >= 0) {
+        close(launch->outputPipe[0]);
+        dup2(launch->outputPipe[1], STDOUT_FILENO);
+        close(launch->outputPipe[1]);
+    }
+}
+
+/**
+ * The function `traceAfterFork` runs in the parent of a traced launch. It records the spawn span and
+ * then blocks until the exec pipe reaches EOF, which happens exactly when the child execs (or exits),
+ * to record the exec span.
+ *
+ * @param launch The launch record filled in by `traceBeforeFork`.
+ * @param pid The process ID of the child.
+ * @param command The name of the command being launched.
+ */
+void traceAfterFork(traceLaunch *launch, int pid, const char *command) {
+    char ignored;
+    launch->forkEnd = traceNow();
+    traceSpan("spawn", command, pid, launch->forkStart, launch->forkEnd);
+
+    if (launch->outputPipe[1] >= 0)
+        close(launch->outputPipe[1]);
+    if (launch->execPipe[0] >= 0) {
+        close(launch->execPipe[1]);
+        while (read(launch->execPipe[0], &ignored, 1) < 0 && errno == EINTR)
+            ;
+        close(launch->execPipe[0]);
+    }
+    launch->execStart = traceNow();
+    traceSpan("exec", command, pid, launch->forkEnd, launch->execStart);
+}
+
+/**
+ * The function `traceRelayOutput` copies the child's stdout from the relay pipe to the shell's stdout
+ * until EOF, recording the time between exec and the first byte of output.
+ *
+ * @param launch The launch record of the child.
+ * @param pid The process ID of the child.
+ * @param command The name of the command.
+ */
+void traceRelayOutput(traceLaunch *launch, int pid, const char *command) {
+    char buffer[4096];
+    int sawOutput = 0;
+    ssize_t bytes;
+
+    if (launch->outputPipe[0] < 0)
+        return;
+    while ((bytes = read(launch->outputPipe[0], buffer, sizeof(buffer))) != 0) {
+        if (bytes < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        if (!sawOutput) {
+            traceSpan("first-output", command, pid, launch->execStart, traceNow());
+            sawOutput = 1;
+        }
+        for (ssize_t written = 0; written < bytes; ) {
+            ssize_t result = write(STDOUT_FILENO, buffer + written, bytes - written);
+            if (result < 0 && errno != EINTR)
+                break;
+            if (result > 0)
+                written += result;
+        }
+    }
+    close(launch->outputPipe[0]);
+    launch->outputPipe[0] = -1;
+}
+
+/*
+ * The function clearGlobCache forgets the cached directory listings. Their memory belongs to the
+ * command arena and is released together with the rest of the command line.
+ */
+void clearGlobCache() {
+    globCacheCount = 0;
+}
+
+/**
+ * The function `hasGlobCharacters` checks if a word contains any of the wildcard characters.
+ *
+ * @param word The word to check.
+ *
+ * @return 1 if the word contains '*', '?' or '[', 0 otherwise.
+ */
+int hasGlobCharacters(const char *word) {
+    return strpbrk(word, "*?[") != NULL;
+}
+
+/**
+ * The function `globMatchBracket` matches one character against a bracket expression such as
+ * "[a-c_]" or "[!0-9]".
+ *
+ * @param pattern Points just after the opening '['.
+ * @param c The character to match.
+ * @param matched Set to 1 if the character is accepted by the expression.
+ *
+ * @return a pointer just after the closing ']', or NULL if the bracket is not closed (in which case
+ * the '[' is treated as a literal character).
+ */
+const char *globMatchBracket(const char *pattern, char c, int *matched) {
+    int negate = 0;
+    *matched = 0;
+    if (*pattern == '!' || *pattern == '^') {
+        negate = 1;
+        pattern++;
+    }
+    /* A ']' right after the opening bracket is part of the set, not its end. */
+    int first = 1;
+    while (*pattern != '\0' && (*pattern != ']' || first)) {
+        char low = *pattern;
+        if (low == '\\' && pattern[1] != '\0')
+            low = *++pattern;
+        char high = low;
+        if (pattern[1] == '-' && pattern[2] != ']' && pattern[2] != '\0') {
+            high = pattern[2];
+            pattern += 2;
+        }
+        if (c >= low && c <= high)
+            *matched = 1;
+        pattern++;
+        first = 0;
+    }
+    if (*pattern != ']')
+        return NULL;
+    if (negate)
+        *matched = !*matched;
+    return pattern + 1;
+}
+
+/**
+ * The function `globMatch` matches a file name against one path component of a pattern, with the
+ * usual `fnmatch` rules: '*' matches any run of characters, '?' any single character and '[...]' a
+ * set. A leading '.' must be matched explicitly.
+ *
+ * @param pattern The pattern component.
+ * @param name The file name.
+ *
+ * @return 1 if the name matches, 0 otherwise.
+ */
+int globMatch(const char *pattern, const char *name) {
+    const char *starPattern = NULL;
+    const char *starName = NULL;
+
+    if (name[0] == '.' && pattern[0] != '.')
+        return 0;
+
+    /* Iterative matching with backtracking to the most recent '*', which keeps the cost linear in
+    practice instead of exponential for patterns with several stars. */
+    while (*name != '\0') {
+        if (*pattern == '*') {
+            while (*pattern == '*')
+                pattern++;
+            if (*pattern == '\0')
+                return 1;
+            starPattern = pattern;
+            starName = name;
+            continue;
+        }
+        int matched = 0;
+        const char *next = pattern + 1;
+        if (*pattern == '?') {
+            matched = 1;
+        } else if (*pattern == '[') {
+            const char *after = globMatchBracket(pattern + 1, *name, &matched);
+            if (after != NULL)
+                next = after;
+            else
+                matched = (*name == '[');
+        } else if (*pattern == '\\' && pattern[1] != '\0') {
+            matched = (pattern[1] == *name);
+            next = pattern + 2;
+        } else if (*pattern != '\0') {
+            matched = (*pattern == *name);
+        }
+
+        if (matched) {
+            pattern = next;
+            name++;
+        } else if (starPattern != NULL) {
+            pattern = starPattern;
+            name = ++starName;
+        } else {
+            return 0;
+        }
+    }
+    while (*pattern == '*')
+        pattern++;
+    return *pattern == '\0';
+}
+
+/**
+ * The function `readDirectoryCached` returns the listing of a directory, reading it only the first
+ * time it is needed on the current command line. The entries are read with getdents64 and copied into
+ * arena memory, which unlike opendir/readdir does not malloc a DIR stream for every directory.
+ *
+ * @param path The directory to list.
+ *
+ * @return the cached listing, or NULL if the directory cannot be opened.
+ */
+directoryListing *readDirectoryCached(const char *path) {
+    for (int i = 0; i < globCacheCount; i++) {
+        if (strcmp(globCache[i].path, path) == 0)
+            return &globCache[i];
+    }
+
+    int directoryDescriptor = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (directoryDescriptor < 0)
+        return NULL;
+
+    /* When the cache is full the oldest listing is forgotten; a command line rarely globs over more
+    than a few directories. */
+    if (globCacheCount == GLOB_CACHE_SIZE) {
+        memmove(&globCache[0], &globCache[1], (GLOB_CACHE_SIZE - 1) * sizeof(directoryListing));
+        globCacheCount--;
+    }
+
+    directoryListing *listing = &globCache[globCacheCount++];
+    size_t namesUsed = 0, namesSize = 4096;
+    size_t entriesSize = 64;
+    listing->path = arenaStrdup(&commandArena, path);
+    listing->names = arenaAlloc(&commandArena, namesSize);
+    listing->offsets = arenaAlloc(&commandArena, entriesSize * sizeof(size_t));
+    listing->isDirectory = arenaAlloc(&commandArena, entriesSize);
+    listing->count = 0;
+
+    /* The raw getdents64 records are only needed while this directory is read, so they share one
+    static buffer rather than taking an oversized block from the arena on every command line. */
+    static char buffer[GLOB_READ_SIZE] __attribute__((aligned(8)));
+    ssize_t bytes;
+    while ((bytes = getdents64(directoryDescriptor, buffer, GLOB_READ_SIZE)) > 0) {
+        for (ssize_t position = 0; position < bytes; ) {
+            struct dirent64 *entry = (struct dirent64 *)(buffer + position);
+            position += entry->d_reclen;
+            if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+                continue;
+
+            size_t length = strlen(entry->d_name) + 1;
+            if (namesUsed + length > namesSize) {
+                size_t newSize = namesSize;
+                while (namesUsed + length > newSize)
+                    newSize *= 2;
+                listing->names = arenaGrow(&commandArena, listing->names, namesUsed, newSize);
+                namesSize = newSize;
+            }
+            if ((size_t)listing->count == entriesSize) {
+                listing->offsets = arenaGrow(&commandArena, listing->offsets, entriesSize * sizeof(size_t),
+                                             2 * entriesSize * sizeof(size_t));
+                listing->isDirectory = arenaGrow(&commandArena, listing->isDirectory, entriesSize, 2 * entriesSize);
+                entriesSize *= 2;
+            }
+            memcpy(listing->names + namesUsed, entry->d_name, length);
+            listing->offsets[listing->count] = namesUsed;
+            /* Symbolic links and file systems without d_type are resolved with stat() only if needed. */
+            if (entry->d_type == DT_DIR)
+                listing->isDirectory[listing->count] = 1;
+            else if (entry->d_type == DT_UNKNOWN || entry->d_type == DT_LNK)
+                listing->isDirectory[listing->count] = -1;
+            else
+                listing->isDirectory[listing->count] = 0;
+            listing->count++;
+            namesUsed += length;
+        }
+    }
+    close(directoryDescriptor);
+    return listing;
+}
+
+/**
+ * The function `globJoinPath` appends a name to a directory path, leaving out the implicit "./".
+ *
+ * @param buffer The buffer receiving the path (PATH_MAX bytes).
+ * @param directory The directory, or "" for the current directory.
+ * @param name The name to append.
+ *
+ * @return 0 on success, -1 if the path would be too long.
+ */
+int globJoinPath(char *buffer, const char *directory, const char *name) {
+    int length;
+    if (directory[0] == '\0')
+        length = snprintf(buffer, PATH_MAX, "%s", name);
+    else if (directory[strlen(directory) - 1] == '/')
+        length = snprintf(buffer, PATH_MAX, "%s%s", directory, name);
+    else
+        length = snprintf(buffer, PATH_MAX, "%s/%s", directory, name);
+    return (length < 0 || length >= PATH_MAX) ? -1 : 0;
+}
+
+/**
+ * The function `globEntryIsDirectory` tells if an entry of a listing is a directory, calling stat()
+ * the first time for entries whose type readdir did not report.
+ *
+ * @param listing The listing holding the entry.
+ * @param index The index of the entry.
+ * @param directory The directory of the listing, as given in the pattern.
+ *
+ * @return 1 if the entry is a directory, 0 otherwise.
+ */
+int globEntryIsDirectory(directoryListing *listing, int index, const char *directory) {
+    if (listing->isDirectory[index] < 0) {
+        char path[PATH_MAX];
+        struct stat fileStatus;
+        listing->isDirectory[index] = 0;
+        if (globJoinPath(path, directory, listing->names + listing->offsets[index]) == 0 &&
+            stat(path, &fileStatus) == 0 && S_ISDIR(fileStatus.st_mode))
+            listing->isDirectory[index] = 1;
+    }
+    return listing->isDirectory[index];
+}
+
+/**
+ * The function `globAddResult` appends a matched path to a growing list of results.
+ *
+ * @param results The list of results.
+ * @param count The number of results, incremented.
+ * @param capacity The capacity of the list, grown as needed.
+ * @param path The path to add; a copy is made in the command arena.
+ */
+void globAddResult(char ***results, int *count, int *capacity, const char *path) {
+    if (*count == *capacity) {
+        int newCapacity = *capacity == 0 ? 16 : *capacity * 2;
+        *results = arenaGrow(&commandArena, *results, *capacity * sizeof(char *), newCapacity * sizeof(char *));
+        *capacity = newCapacity;
+    }
+    (*results)[(*count)++] = arenaStrdup(&commandArena, path);
+}
+
+/**
+ * The function `globAddWord` appends a word, without copying it, to a growing word list.
+ *
+ * @param words The list of words.
+ * @param count The number of words, incremented.
+ * @param capacity The capacity of the list, grown as needed.
+ * @param word The word to add.
+ */
+void globAddWord(char ***words, int *count, int *capacity, char *word) {
+    if (*count == *capacity) {
+        int newCapacity = *capacity == 0 ? 16 : *capacity * 2;
+        *words = arenaGrow(&commandArena, *words, *capacity * sizeof(char *), newCapacity * sizeof(char *));
+        *capacity = newCapacity;
+    }
+    (*words)[(*count)++] = word;
+}
+
+/**
+ * The function `globWalk` expands the pattern components starting at `component` below the
+ * directory `directory`. Components without wildcards are appended without reading the directory,
+ * and a "**" component matches zero or more levels of (non-hidden) subdirectories.
+ *
+ * @param directory The directory reached so far ("" for the current directory).
+ * @param components The components of the pattern.
+ * @param numComponents The number of components.
+ * @param component The component to expand next.
+ * @param results The list receiving the matched paths.
+ * @param count The number of results.
+ * @param capacity The capacity of the result list.
+ */
+void globWalk(const char *directory, char *components[], int numComponents, int component,
+              char ***results, int *count, int *capacity) {
+    char path[PATH_MAX];
+    int last = (component == numComponents - 1);
+    const char *pattern = components[component];
+
+    /* A literal component only needs to exist; there is no reason to list its directory. */
+    if (!hasGlobCharacters(pattern)) {
+        struct stat fileStatus;
+        if (globJoinPath(path, directory, pattern) < 0 || lstat(path, &fileStatus) < 0)
+            return;
+        if (last)
+            globAddResult(results, count, capacity, path);
+        else if (S_ISDIR(fileStatus.st_mode) || (stat(path, &fileStatus) == 0 && S_ISDIR(fileStatus.st_mode)))
+            globWalk(path, components, numComponents, component + 1, results, count, capacity);
+        return;
+    }
+
+    directoryListing *listing = readDirectoryCached(directory[0] == '\0' ? "." : directory);
+    if (listing == NULL)
+        return;
+
+    /* "**" first matches zero directories, then every subdirectory with "**" still pending. */
+    if (strcmp(pattern, "**") == 0) {
+        if (last) {
+            for (int i = 0; i < listing->count; i++) {
+                const char *name = listing->names + listing->offsets[i];
+                if (name[0] == '.' || globJoinPath(path, directory, name) < 0)
+                    continue;
+                globAddResult(results, count, capacity, path);
+                if (globEntryIsDirectory(listing, i, directory)) {
+                    char subdirectory[PATH_MAX];
+                    strcpy(subdirectory, path);
+                    globWalk(subdirectory, components, numComponents, component, results, count, capacity);
+                    listing = readDirectoryCached(directory[0] == '\0' ? "." : directory);
+                    if (listing == NULL)
+                        return;
+                }
+            }
+            return;
+        }
+        globWalk(directory, components, numComponents, component + 1, results, count, capacity);
+        for (int i = 0; i < listing->count; i++) {
+            const char *name = listing->names + listing->offsets[i];
+            if (name[0] == '.' || !globEntryIsDirectory(listing, i, directory) ||
+                globJoinPath(path, directory, name) < 0)
+                continue;
+            char subdirectory[PATH_MAX];
+            strcpy(subdirectory, path);
+            globWalk(subdirectory, components, numComponents, component, results, count, capacity);
+            listing = readDirectoryCached(directory[0] == '\0' ? "." : directory);
+            if (listing == NULL)
+                return;
+        }
+        return;
+    }
+
+    for (int i = 0; i < listing->count; i++) {
+        const char *name = listing->names + listing->offsets[i];
+        if (!globMatch(pattern, name) || globJoinPath(path, directory, name) < 0)
+            continue;
+        if (last) {
+            globAddResult(results, count, capacity, path);
+        } else if (globEntryIsDirectory(listing, i, directory)) {
+            /* `listing` may move if the recursion evicts cache entries, so only `path` is used from here. */
+            char subdirectory[PATH_MAX];
+            strcpy(subdirectory, path);
+            globWalk(subdirectory, components, numComponents, component + 1, results, count, capacity);
+            listing = readDirectoryCached(directory[0] == '\0' ? "." : directory);
+            if (listing == NULL)
+                return;
+        }
+    }
+}
+
+/**
+ * The function `globCompare` orders matched paths for qsort, like the shell's sorted glob output.
+ */
+int globCompare(const void *p, const void *q) {
+    return strcmp(*(char * const *)p, *(char * const *)q);
+}
+
+/**
+ * The function `expandGlobs` performs shell-side wildcard expansion of a command's words. Every word
+ * containing '*', '?' or '[' is replaced by the sorted list of matching paths; a word that matches
+ * nothing is passed on unchanged. Quoted words are never expanded.
+ *
+ * @param argumentCount A pointer to the number of words, updated with the expanded count.
+ * @param words The words of the command.
+ *
+ * @return `words` itself if nothing was expanded, otherwise a new NULL-terminated word list in the
+ * command arena.
+ */
+char **expandGlobs(int *argumentCount, char *words[]) {
+    int needsExpansion = 0;
+    for (int i = 0; i < *argumentCount; i++) {
+        if (hasGlobCharacters(words[i]) && words[i][0] != '\'' && words[i][0] != '"')
+            needsExpansion = 1;
+    }
+    if (!needsExpansion)
+        return words;
+
+    char **expanded = NULL;
+    int expandedCount = 0, expandedCapacity = 0;
+    for (int i = 0; i < *argumentCount; i++) {
+        if (!hasGlobCharacters(words[i]) || words[i][0] == '\'' || words[i][0] == '"') {
+            globAddWord(&expanded, &expandedCount, &expandedCapacity, words[i]);
+            continue;
+        }
+
+        /* Splitting the pattern into path components; an absolute pattern starts from "/". */
+        char pattern[PATH_MAX];
+        char *components[PATH_MAX / 2];
+        int numComponents = 0;
+        snprintf(pattern, sizeof(pattern), "%s", words[i]);
+        tokenizeInput(components, pattern, "/", &numComponents);
+
+        int firstMatch = expandedCount;
+        if (numComponents > 0)
+            globWalk(words[i][0] == '/' ? "/" : "", components, numComponents, 0,
+                     &expanded, &expandedCount, &expandedCapacity);
+        if (expandedCount == firstMatch) {
+            globAddWord(&expanded, &expandedCount, &expandedCapacity, words[i]);
+        } else {
+            qsort(expanded + firstMatch, expandedCount - firstMatch, sizeof(char *), globCompare);
+        }
+    }
+
+    /* One spare slot for the terminating NULL that the launch paths write. */
+    globAddWord(&expanded, &expandedCount, &expandedCapacity, NULL);
+    expandedCount--;
+    *argumentCount = expandedCount;
+    return expanded;
+}
+
+/**
+ * The function `parseRedirectionWord` recognizes a redirection operator at the start of a word, with
+ * an optional descriptor number in front of it ("2>", "2>&1", "<>", "&>", ...).
+ *
+ * @param word The word to look at.
+ * @param parsed Filled in with the descriptor and kind of the redirection. For the duplicating forms
+ * `sourceFd` temporarily holds the number written in front of the operator, or -1 if there was none.
+ *
+ * @return a pointer to the text after the operator (the target, possibly empty when the target is the
+ * next word), or NULL if the word is not a redirection.
+ */
+const char *parseRedirectionWord(const char *word, redirection *parsed) {
+    const char *position = word;
+    int fd = -1;
+
+    if (word[0] == '&' && word[1] == '>') {
+        parsed->fd = STDOUT_FILENO;
+        if (word[2] == '>') {
+            parsed->kind = REDIRECT_APPEND_OUTPUT_AND_ERROR;
+            return word + 3;
+        }
+        parsed->kind = REDIRECT_OUTPUT_AND_ERROR;
+        return word + 2;
+    }
+
+    if (*position >= '0' && *position <= '9') {
+        fd = 0;
+        while (*position >= '0' && *position <= '9' && fd < 100000)
+            fd = fd * 10 + (*position++ - '0');
+    }
+
+    if (*position == '<') {
+        parsed->fd = fd >= 0 ? fd : STDIN_FILENO;
+        if (position[1] == '>') {
+            parsed->kind = REDIRECT_READ_WRITE;
+            return position + 2;
+        }
+        if (position[1] == '&') {
+            parsed->kind = REDIRECT_DUPLICATE;
+            parsed->sourceFd = fd;
+            return position + 2;
+        }
+        parsed->kind = REDIRECT_INPUT;
+        return position + 1;
+    }
+    if (*position == '>') {
+        parsed->fd = fd >= 0 ? fd : STDOUT_FILENO;
+        if (position[1] == '>') {
+            parsed->kind = REDIRECT_APPEND;
+            return position + 2;
+        }
+        if (position[1] == '&') {
+            /* A bare ">&file" sends both stdout and stderr to the file; this is resolved once the
+            target is known. */
+            parsed->kind = REDIRECT_DUPLICATE;
+            parsed->sourceFd = fd;
+            return position + 2;
+        }
+        parsed->kind = REDIRECT_OUTPUT;
+        return position + (position[1] == '|' ? 2 : 1);
+    }
+    return NULL;
+}
+
+/**
+ * The function `parseRedirections` removes the redirections from the words of a command and records
+ * them in a list. Redirections may appear anywhere in the command, and the target may be written in
+ * the same word ("2>err.log") or in the next one ("2> err.log").
+ *
+ * @param argumentCount The number of words, updated to the number left after the redirections.
+ * @param words The words of the command; the remaining words are moved to the front.
+ * @param list The list the redirections are stored in.
+ *
+ * @return 0 on success, or -1 after printing an error if a redirection is malformed.
+ */
+int parseRedirections(int *argumentCount, char *words[], redirectionList *list) {
+    int kept = 0;
+    list->count = 0;
+
+    for (int i = 0; i < *argumentCount; i++) {
+        redirection parsed;
+        parsed.sourceFd = -1;
+        const char *target = parseRedirectionWord(words[i], &parsed);
+        if (target == NULL) {
+            words[kept++] = words[i];
+            continue;
+        }
+        const char *operatorWord = words[i];
+        int explicitFd = parsed.sourceFd;
+
+        if (*target == '\0') {
+            if (i + 1 >= *argumentCount) {
+                fprintf(stderr, "quash: syntax error: missing target for '%s'\n", words[i]);
+                return -1;
+            }
+            target = words[++i];
+        }
+        if (list->count == MAX_REDIRECTIONS) {
+            fprintf(stderr, "quash: too many redirections\n");
+            return -1;
+        }
+
+        /* "N>&M" copies a descriptor and "N>&-" closes one. Without a number in front, ">&file"
+        redirects stdout and stderr to the file. */
+        if (parsed.kind == REDIRECT_DUPLICATE) {
+            char *end;
+            long source = strtol(target, &end, 10);
+            if (strcmp(target, "-") == 0) {
+                parsed.kind = REDIRECT_CLOSE;
+            } else if (*target >= '0' && *target <= '9' && *end == '\0' && source < INT_MAX) {
+                parsed.sourceFd = (int)source;
+            } else if (explicitFd < 0 && parsed.fd == STDOUT_FILENO && strchr(operatorWord, '<') == NULL) {
+                parsed.kind = REDIRECT_OUTPUT_AND_ERROR;
+            } else {
+                fprintf(stderr, "quash: %s: ambiguous redirect\n", target);
+                return -1;
+            }
+        }
+        parsed.target = target;
+        list->items[list->count++] = parsed;
+    }
+    *argumentCount = kept;
+    words[kept] = NULL;
+    return 0;
+}
+
+/**
+ * The function `applyRedirection` performs one redirection in the calling process.
+ *
+ * @param item The redirection to perform.
+ *
+ * @return 0 on success, or -1 after printing an error.
+ */
+int applyRedirection(const redirection *item) {
+    int flags;
+    switch (item->kind) {
+    case REDIRECT_DUPLICATE:
+        if (item->sourceFd != item->fd && dup2(item->sourceFd, item->fd) < 0) {
+            fprintf(stderr, "quash: %d: %s\n", item->sourceFd, strerror(errno));
+            return -1;
+        }
+        return 0;
+    case REDIRECT_CLOSE:
+        close(item->fd);
+        return 0;
+    case REDIRECT_INPUT:
+        flags = O_RDONLY;
+        break;
+    case REDIRECT_READ_WRITE:
+        flags = O_RDWR | O_CREAT;
+        break;
+    case REDIRECT_APPEND:
+    case REDIRECT_APPEND_OUTPUT_AND_ERROR:
+        flags = O_WRONLY | O_CREAT | O_APPEND;
+        break;
+    default:
+        flags = O_WRONLY | O_CREAT | O_TRUNC;
+        break;
+    }
+
+    int file = open(item->target, flags, FILE_PERMISSIONS);
+    if (file < 0) {
+        fprintf(stderr, "quash: %s: %s\n", item->target, strerror(errno));
+        return -1;
+    }
+    if (file != item->fd) {
+        if (dup2(file, item->fd) < 0) {
+            fprintf(stderr, "quash: %d: %s\n", item->fd, strerror(errno));
+            close(file);
+            return -1;
+        }
+    }
+    if (item->kind == REDIRECT_OUTPUT_AND_ERROR || item->kind == REDIRECT_APPEND_OUTPUT_AND_ERROR)
+        dup2(item->fd, STDERR_FILENO);
+    if (file != item->fd)
+        close(file);
+    return 0;
+}
+
+/**
+ * The function `applyRedirections` performs the redirections of a command in order. It runs in the
+ * child between fork and exec, so the shell's own descriptors are never touched for an external
+ * command.
+ *
+ * @param list The redirections of the command.
+ *
+ * @return 0 on success, or -1 if any redirection failed.
+ */
+int applyRedirections(const redirectionList *list) {
+    for (int i = 0; i < list->count; i++) {
+        if (applyRedirection(&list->items[i]) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+/**
+ * The function `redirectionTouches` reports whether a redirection changes a descriptor. It matters
+ * for the forms that write stderr as well as the named descriptor.
+ *
+ * @param item The redirection.
+ * @param fd The descriptor.
+ *
+ * @return 1 if the redirection changes `fd`, otherwise 0.
+ */
+int redirectionTouches(const redirection *item, int fd) {
+    if (item->fd == fd)
+        return 1;
+    return fd == STDERR_FILENO && (item->kind == REDIRECT_OUTPUT_AND_ERROR ||
+                                   item->kind == REDIRECT_APPEND_OUTPUT_AND_ERROR);
+}
+
+/**
+ * The function `restoreShellRedirections` undoes `redirectInShell`, putting back every saved
+ * descriptor and closing the ones that were not open before.
+ *
+ * @param saved The saved descriptors, filled in by `redirectInShell`.
+ * @param savedCount The number of entries of `saved` that were filled in.
+ */
+void restoreShellRedirections(int saved[][2], int savedCount) {
+    fflush(stdout);
+    fflush(stderr);
+    for (int i = savedCount - 1; i >= 0; i--) {
+        if (saved[i][1] >= 0) {
+            dup2(saved[i][1], saved[i][0]);
+            close(saved[i][1]);
+        } else {
+            close(saved[i][0]);
+        }
+    }
+}
+
+/**
+ * The function `redirectInShell` applies the redirections of a builtin to the shell itself. Only the
+ * descriptors the redirections touch are saved, each once, with a close-on-exec copy above the
+ * standard descriptors so children started by the builtin never see it. If a redirection fails, the
+ * ones already applied are undone.
+ *
+ * @param list The redirections of the builtin.
+ * @param saved Receives pairs of (descriptor, saved copy or -1 if it was closed).
+ * @param savedCount Receives the number of saved pairs.
+ *
+ * @return 0 on success, or -1 if a redirection failed.
+ */
+int redirectInShell(const redirectionList *list, int saved[][2], int *savedCount) {
+    *savedCount = 0;
+    fflush(stdout);
+    fflush(stderr);
+
+    for (int i = 0; i < list->count; i++) {
+        int fds[2] = { list->items[i].fd, STDERR_FILENO };
+        int touched = redirectionTouches(&list->items[i], STDERR_FILENO) && fds[0] != STDERR_FILENO ? 2 : 1;
+        for (int j = 0; j < touched; j++) {
+            int alreadySaved = 0;
+            for (int k = 0; k < *savedCount; k++)
+                alreadySaved |= saved[k][0] == fds[j];
+            if (alreadySaved)
+                continue;
+            saved[*savedCount][0] = fds[j];
+            saved[*savedCount][1] = fcntl(fds[j], F_DUPFD_CLOEXEC, 10);
+            (*savedCount)++;
+        }
+        if (applyRedirection(&list->items[i]) < 0) {
+            restoreShellRedirections(saved, *savedCount);
+            *savedCount = 0;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+#define TEE_CHUNK_SIZE 65536
+#define TEE_MAX_OUTPUTS 32
+
+/**
+ * The function `teeWriteAll` writes a whole buffer to a descriptor, retrying short writes.
+ *
+ * @param fd The descriptor to write to.
+ * @param buffer The data.
+ * @param size The number of bytes.
+ *
+ * @return 0 on success, -1 on a write error.
+ */
+int teeWriteAll(int fd, const char *buffer, size_t size) {
+    while (size > 0) {
+        ssize_t written = write(fd, buffer, size);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        buffer += written;
+        size -= written;
+    }
+    return 0;
+}
+
+/**
+ * The function `teeMove` moves exactly `size` bytes from the head of a pipe to an output with splice,
+ * so the data never passes through user space. Outputs that splice refuses (a terminal, or a file
+ * opened with O_APPEND on older kernels) are marked and served with read and write from then on.
+ * If the output fails, the rest of the `size` bytes are still taken from the pipe and dropped, so the
+ * other outputs stay in step.
+ *
+ * @param source The pipe the bytes are taken from.
+ * @param output The output descriptor.
+ * @param useCopy Set to 1 once splice has been refused for this output.
+ * @param size The number of bytes to move.
+ *
+ * @return 0 on success, -1 on an I/O error, with errno set.
+ */
+int teeMove(int source, int output, int *useCopy, size_t size) {
+    char buffer[TEE_CHUNK_SIZE];
+    int failure = 0;
+    while (size > 0) {
+        if (failure == 0 && !*useCopy) {
+            ssize_t moved = splice(source, NULL, output, NULL, size, SPLICE_F_MOVE);
+            if (moved > 0) {
+                size -= moved;
+                continue;
+            }
+            if (moved < 0 && errno == EINTR)
+                continue;
+            if (moved == 0 || errno != EINVAL)
+                failure = moved == 0 ? EIO : errno;
+            else
+                *useCopy = 1;
+            continue;
+        }
+        ssize_t bytes = read(source, buffer, size < sizeof(buffer) ? size : sizeof(buffer));
+        if (bytes < 0 && errno == EINTR)
+            continue;
+        if (bytes <= 0) {
+            errno = bytes == 0 ? EIO : errno;
+            return -1;
+        }
+        if (failure == 0 && teeWriteAll(output, buffer, bytes) < 0)
+            failure = errno;
+        size -= bytes;
+    }
+    if (failure != 0) {
+        errno = failure;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * The function `teeDropOutput` reports an output that failed and removes it from the outputs of tee,
+ * along with its scratch pipe. The outputs after it move down one place.
+ *
+ * @param index The output that failed; errno holds the reason.
+ * @param outputs The output descriptors.
+ * @param names The names of the outputs, for the messages.
+ * @param useCopy The copy flags of the outputs.
+ * @param scratch The scratch pipes of the outputs.
+ * @param numOutputs The number of outputs, decreased by one.
+ */
+void teeDropOutput(int index, int outputs[], char *names[], int useCopy[], int scratch[][2], int *numOutputs) {
+    fprintf(stderr, "tee: %s: %s\n", names[index], strerror(errno));
+    if (outputs[index] != STDOUT_FILENO)
+        close(outputs[index]);
+    if (scratch[index][0] >= 0) {
+        close(scratch[index][0]);
+        close(scratch[index][1]);
+    }
+    for (int i = index; i < *numOutputs - 1; i++) {
+        outputs[i] = outputs[i + 1];
+        names[i] = names[i + 1];
+        useCopy[i] = useCopy[i + 1];
+        scratch[i][0] = scratch[i + 1][0];
+        scratch[i][1] = scratch[i + 1][1];
+    }
+    (*numOutputs)--;
+}
+
+/**
+ * The function `teeBuiltin` copies its standard input to its standard output and to every named file,
+ * like tee(1). It runs as a stage of a pipeline. When standard input is a pipe the data is never
+ * copied through user space: each round duplicates the bytes at the head of the input into one
+ * scratch pipe per extra output with tee(2), then splices the input itself into the last output and
+ * each scratch pipe into its own output. Any other input falls back to read and write.
+ * An output that cannot be written is reported and dropped; the others keep receiving the input until
+ * it ends or no output is left.
+ *
+ * @param argumentCount The number of words of the command.
+ * @param arguments `tee`, an optional `-a` (append instead of truncating) and the file names.
+ *
+ * @return the exit status of the stage: 0, or 1 if a file could not be opened or written.
+ */
+int teeBuiltin(int argumentCount, char *arguments[]) {
+    int outputs[TEE_MAX_OUTPUTS];
+    char *names[TEE_MAX_OUTPUTS];
+    int useCopy[TEE_MAX_OUTPUTS] = { 0 };
+    int scratch[TEE_MAX_OUTPUTS][2];
+    int numOutputs = 0, status = 0;
+    int flags = O_WRONLY | O_CREAT | O_TRUNC;
+
+    names[numOutputs] = "standard output";
+    outputs[numOutputs++] = STDOUT_FILENO;
+    for (int i = 1; i < argumentCount; i++) {
+        if (strcmp(arguments[i], "-a") == 0) {
+            flags = O_WRONLY | O_CREAT | O_APPEND;
+            continue;
+        }
+        if (numOutputs == TEE_MAX_OUTPUTS) {
+            fprintf(stderr, "tee: too many files\n");
+            return 1;
+        }
+        int file = open(arguments[i], flags, FILE_PERMISSIONS);
+        if (file < 0) {
+            fprintf(stderr, "tee: %s: %s\n", arguments[i], strerror(errno));
+            status = 1;
+            continue;
+        }
+        names[numOutputs] = arguments[i];
+        outputs[numOutputs++] = file;
+    }
+
+    /* Every output but the last one gets a scratch pipe to receive its duplicate of the input. The
+    last one has one too, which it uses once an output after it has been dropped. */
+    struct stat inputStatus;
+    int zeroCopy = fstat(STDIN_FILENO, &inputStatus) == 0 && S_ISFIFO(inputStatus.st_mode);
+    for (int i = 0; i < numOutputs; i++)
+        scratch[i][0] = scratch[i][1] = -1;
+    for (int i = 0; zeroCopy && i < numOutputs; i++) {
+        if (pipe2(scratch[i], O_CLOEXEC) < 0)
+            zeroCopy = 0;
+    }
+
+    while (zeroCopy && numOutputs > 0) {
+        /* The scratch pipes start each round empty, so every tee(2) copies the same `size` bytes
+        from the unconsumed head of the input. */
+        ssize_t size;
+        if (numOutputs == 1)
+            size = splice(STDIN_FILENO, NULL, outputs[0], NULL, TEE_CHUNK_SIZE, SPLICE_F_MOVE);
+        else
+            size = tee(STDIN_FILENO, scratch[0][1], TEE_CHUNK_SIZE, 0);
+        if (size < 0 && errno == EINTR)
+            continue;
+        // Nothing has been consumed yet, so an output splice cannot serve is handled by the copy loop
+        if (size < 0 && errno == EINVAL)
+            break;
+        if (size < 0 && numOutputs == 1 && errno != EAGAIN) {
+            // Only the output can have failed: the input is a pipe that splice accepts
+            teeDropOutput(0, outputs, names, useCopy, scratch, &numOutputs);
+            status = 1;
+            continue;
+        }
+        if (size < 0) {
+            perror("tee");
+            return 1;
+        }
+        if (size == 0)
+            return status;
+        if (numOutputs == 1)
+            continue;
+        for (int i = 1; i < numOutputs - 1; i++) {
+            ssize_t copied;
+            while ((copied = tee(STDIN_FILENO, scratch[i][1], size, 0)) < 0 && errno == EINTR)
+                ;
+            if (copied != size) {
+                perror("tee");
+                return 1;
+            }
+        }
+        /* Every move takes its `size` bytes even when its output fails, so the failed outputs are
+        only dropped once the round is over. */
+        int failed[TEE_MAX_OUTPUTS], failures[TEE_MAX_OUTPUTS], numFailed = 0;
+        if (teeMove(STDIN_FILENO, outputs[numOutputs - 1], &useCopy[numOutputs - 1], size) < 0) {
+            failed[numFailed] = numOutputs - 1;
+            failures[numFailed++] = errno;
+        }
+        for (int i = 0; i < numOutputs - 1; i++) {
+            if (teeMove(scratch[i][0], outputs[i], &useCopy[i], size) < 0) {
+                failed[numFailed] = i;
+                failures[numFailed++] = errno;
+            }
+        }
+        // Dropping from the highest index down keeps the lower indexes valid
+        for (int i = 0; i < numFailed; i++) {
+            int highest = i;
+            for (int j = i + 1; j < numFailed; j++)
+                if (failed[j] > failed[highest])
+                    highest = j;
+            int index = failed[highest], failure = failures[highest];
+            failed[highest] = failed[i];
+            failures[highest] = failures[i];
+            errno = failure;
+            teeDropOutput(index, outputs, names, useCopy, scratch, &numOutputs);
+            status = 1;
+        }
+    }
+
+    char buffer[TEE_CHUNK_SIZE];
+    ssize_t bytes;
+    while (numOutputs > 0 && (bytes = read(STDIN_FILENO, buffer, sizeof(buffer))) != 0) {
+        if (bytes < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("tee");
+            return 1;
+        }
+        for (int i = 0; i < numOutputs; i++) {
+            if (teeWriteAll(outputs[i], buffer, bytes) < 0) {
+                teeDropOutput(i--, outputs, names, useCopy, scratch, &numOutputs);
+                status = 1;
+            }
+        }
+    }
+    return status;
+}
+
+// Functions are also run as forked stages
+void callFunction(int argumentCount, char *words[]);
+
+/**
+ * The function `runForkedBuiltin` runs the builtins that behave like an ordinary command (they read
+ * stdin and write stdout, so they are useful as pipeline stages) and shell functions in a forked
+ * child, in place of exec.
+ * It returns only if the command is not one of them.
+ *
+ * @param argumentCount The number of words of the command.
+ * @param arguments The command and its arguments.
+ */
+void runForkedBuiltin(int argumentCount, char *arguments[]) {
+    if (strcmp(arguments[0], "tee") == 0)
+        _exit(teeBuiltin(argumentCount, arguments));
+    /* A function used as a pipeline stage or a background job runs in this forked copy of the
+    shell. Its spans cannot reach the parent's trace buffer. */
+    if (lookupName(&functionTable, arguments[0]) != NULL) {
+        traceEnabled = 0;
+        callFunction(argumentCount, arguments);
+        fflush(stdout);
+        _exit(lastExitStatus);
+    }
+}
+
+// A substituted pipeline is run with the same code as one typed at the prompt
+void piping(char *command, int argumentCount, int background);
+
+// A substituted command is launched with the same code as any other command
+int launchChild(int argumentCount, char *arguments[], const launchAttributes *attributes,
+                const redirectionList *redirections, int foreground);
+
+/**
+ * The function `startProcessSubstitution` runs the command of a `<(cmd)` or `>(cmd)` concurrently with
+ * the command that uses it, connected by an anonymous pipe. The shell keeps the other end of the pipe
+ * as a close-on-exec descriptor, which is handed only to the children that name it in their
+ * arguments. A substituted pipeline is run by a forked copy of the shell.
+ *
+ * @param command The text between the parentheses; it is tokenized in place in the child.
+ * @param readFromCommand 1 for `<(cmd)` (the command writes into the pipe), 0 for `>(cmd)`.
+ *
+ * @return the shell's end of the pipe, or -1 on failure.
+ */
+int startProcessSubstitution(char *command, int readFromCommand) {
+    int substitutionPipe[2];
+    if (substitutionCount == MAX_SUBSTITUTIONS) {
+        fprintf(stderr, "quash: too many process substitutions\n");
+        return -1;
+    }
+    if (pipe2(substitutionPipe, O_CLOEXEC) < 0) {
+        perror("Pipe ");
+        return -1;
+    }
+    int commandEnd = readFromCommand ? substitutionPipe[1] : substitutionPipe[0];
+    int shellEnd = readFromCommand ? substitutionPipe[0] : substitutionPipe[1];
+
+    fflush(stdout);  // a child must not inherit (and later write) buffered output
+    int pid = fork();
+    if (pid == 0) {
+        // The spans of the substituted command cannot reach the shell's trace buffer
+        traceEnabled = 0;
+        dup2(commandEnd, readFromCommand ? STDOUT_FILENO : STDIN_FILENO);
+        close(substitutionPipe[0]);
+        close(substitutionPipe[1]);
+        for (int i = 0; i < substitutionCount; i++)
+            close(substitutions[i].fd);
+        substitutionCount = 0;
+
+        if (strchr(command, '|') != NULL) {
+            piping(command, 0, 0);
+            fflush(stdout);
+            _exit(lastExitStatus);
+        }
+        int wordCount = 0;
+        char *commandWords[SIZE];
+        tokenizeInput(commandWords, command, " \t", &wordCount);
+        redirectionList commandRedirections;
+        if (wordCount == 0 || parseRedirections(&wordCount, commandWords, &commandRedirections) < 0)
+            _exit(EXIT_FAILURE);
+        char **words = expandGlobs(&wordCount, commandWords);
+        launchAttributes commandAttributes;
+        if (parseLaunchPrefixes(&wordCount, words, &commandAttributes) < 0 || wordCount == 0)
+            _exit(EXIT_FAILURE);
+        launchChild(wordCount, words, &commandAttributes, &commandRedirections, 0);
+        fprintf(stderr, "%s: %s\n", words[0], strerror(errno));
+        _exit(127);
+    }
+    close(commandEnd);
+    if (pid < 0) {
+        perror("Fork ");
+        close(shellEnd);
+        return -1;
+    }
+    substitutions[substitutionCount].pid = pid;
+    substitutions[substitutionCount].fd = shellEnd;
+    substitutionCount++;
+    return shellEnd;
+}
+
+/**
+ * The function `expandProcessSubstitutions` starts the command of every `<(cmd)` and `>(cmd)` of a
+ * command line and replaces each of them with the `/dev/fd/N` path of its pipe. The parentheses may
+ * nest, so a substituted command may itself use process substitution or a pipeline.
+ *
+ * @param line The command line.
+ *
+ * @return the line itself when it has no substitutions, a rewritten copy in the command arena, or
+ * NULL after printing an error.
+ */
+char *expandProcessSubstitutions(char *line) {
+    if (strstr(line, "<(") == NULL && strstr(line, ">(") == NULL)
+        return line;
+
+    char *expanded = arenaAlloc(&commandArena, strlen(line) + 1 + MAX_SUBSTITUTIONS * 16);
+    size_t used = 0;
+    for (char *position = line; *position != '\0'; ) {
+        int wordStart = position == line || position[-1] == ' ' || position[-1] == '\t';
+        if (!wordStart || (*position != '<' && *position != '>') || position[1] != '(') {
+            expanded[used++] = *position++;
+            continue;
+        }
+
+        char *close = position + 2;
+        for (int depth = 1; *close != '\0'; close++) {
+            if (*close == '(')
+                depth++;
+            else if (*close == ')' && --depth == 0)
+                break;
+        }
+        if (*close == '\0') {
+            fprintf(stderr, "quash: syntax error: unmatched '('\n");
+            return NULL;
+        }
+
+        size_t length = close - (position + 2);
+        char *command = arenaAlloc(&commandArena, length + 1);
+        memcpy(command, position + 2, length);
+        command[length] = '\0';
+        int fd = startProcessSubstitution(command, *position == '<');
+        if (fd < 0)
+            return NULL;
+        used += sprintf(expanded + used, "/dev/fd/%d", fd);
+        position = close + 1;
+    }
+    expanded[used] = '\0';
+    return expanded;
+}
+
+/**
+ * The function `inheritSubstitutionFds` runs in a child between fork and exec. It clears the
+ * close-on-exec flag of the process substitution pipes that the command names as `/dev/fd/N`, so no
+ * other child holds a pipe end open and delays its end-of-file.
+ *
+ * @param words The command and its arguments, terminated by NULL.
+ */
+void inheritSubstitutionFds(char *words[]) {
+    for (int i = 0; i < substitutionCount; i++) {
+        char path[32];
+        snprintf(path, sizeof(path), "/dev/fd/%d", substitutions[i].fd);
+        for (int j = 0; words[j] != NULL; j++) {
+            if (strcmp(words[j], path) == 0) {
+                fcntl(substitutions[i].fd, F_SETFD, 0);
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * The function `launchChild` runs the command of a forked child; every launched command goes through
+ * it. A foreground child first moves to a process group of its own and takes the terminal, so Ctrl-C
+ * and Ctrl-Z reach it instead of the shell; other children are already in their group. A server
+ * worker has no terminal, so its foreground children stay in its group, where the hangup of the
+ * session and the kill after it reach them. Then the
+ * redirections and launch attributes are applied, the process substitution pipes the command names
+ * are handed over, and a forked builtin, a shell function or the program is run.
+ *
+ * @param argumentCount The number of words of the command.
+ * @param arguments The command and its arguments, terminated by NULL.
+ * @param attributes The CPU affinity and scheduling settings.
+ * @param redirections The fd redirections of the command.
+ * @param foreground 1 if the command runs in the foreground.
+ *
+ * @return only if the program cannot be run, with errno set; the caller reports it.
+ */
+int launchChild(int argumentCount, char *arguments[], const launchAttributes *attributes,
+                const redirectionList *redirections, int foreground) {
+    if (foreground) {
+        if (!serverWorker) {
+            setpgid(0, 0);
+            tcsetpgrp(STDIN_FILENO, getpgid(0));
+        }
+        signal(SIGINT, SIG_DFL);
+        signal(SIGTSTP, SIG_DFL);
+    }
+    if (applyRedirections(redirections) < 0)
+        _exit(EXIT_FAILURE);
+    applyLaunchAttributes(attributes);
+    inheritSubstitutionFds(arguments);
+    runForkedBuiltin(argumentCount, arguments);
+    return execvp(arguments[0], arguments);
+}
+
+/**
+ * The function `finishProcessSubstitutions` closes the shell's ends of the process substitution pipes
+ * once the command using them has been started and waited for, which gives the substituted commands
+ * their end-of-file, and reaps them. The ones of a background job are left to the SIGCHLD handler.
+ *
+ * @param wait 1 to wait for the substituted commands now, 0 to hand them to the SIGCHLD handler.
+ */
+void finishProcessSubstitutions(int wait) {
+    sigset_t blocked, previous;
+    sigemptyset(&blocked);
+    sigaddset(&blocked, SIGCHLD);
+
+    for (int i = 0; i < substitutionCount; i++)
+        close(substitutions[i].fd);
+    for (int i = 0; i < substitutionCount; i++) {
+        if (wait) {
+            while (waitpid(substitutions[i].pid, NULL, 0) < 0 && errno == EINTR)
+                ;
+        } else if (detachedSubstitutionCount < SIZE) {
+            sigprocmask(SIG_BLOCK, &blocked, &previous);
+            detachedSubstitutionPids[detachedSubstitutionCount++] = substitutions[i].pid;
+            sigprocmask(SIG_SETMASK, &previous, NULL);
+        }
+    }
+    substitutionCount = 0;
+}
+
+// Check for the presence of pipes in the arguments
+/**
+ * The function checks if there are any pipe characters ("|") in an array of arguments.
+ * 
+ * @param arguments An array of strings representing command line arguments. Each element in the array
+ * is a separate argument.
+ * @param argumentCount The parameter "argumentCount" is the number of elements in the "arguments"
+ * array.
+ * 
+ * @return an integer value. If the function finds a pipe symbol "|" in the array of arguments, it
+ * returns 1. Otherwise, it returns 0.
+ */
+int checkForPipes(char* arguments[], int argumentCount) {
+	for (int i = 0; i < argumentCount; i++) {
+       if (strcmp(arguments[i], "|") == 0)
+          return 1;
+  }
+  return 0;
+}
+
+/**
+ * The `piping` function takes a command and the number of arguments, tokenizes the command by pipes,
+ * and starts every stage of the pipeline before waiting for any of them, so a stage that writes more
+ * than a pipe buffer never blocks on a reader that has not been started yet. Each child wires its
+ * own pipe ends and applies its own redirections between fork and exec; the shell's descriptors are
+ * never redirected.
+ * 
+ * @param command The `command` parameter in the `piping` function is a string that represents the
+ * entire command to be executed, including any arguments and pipes. It is used to split the command
+ * into individual pipe commands.
+ * @param argumentCount The parameter `argumentCount` represents the number of arguments passed to the
+ * `piping` function. It is used to determine the size of the `commandArgument` array in the
+ * `handleForegroundChild` function.
+ * @param background 1 to run the pipeline as a background job: every stage joins the process group
+ * of the first one, the group is recorded as a single job, and the shell does not wait for it.
+ */
+
+void piping(char *command, int argumentCount, int background) {  
+    char* pipedCommands[100];
+    int numPipes = 0;
+
+    /* A background pipeline is named after its whole command line, before it is split into
+    stages. SIGCHLD stays blocked until the job is recorded. */
+    char *jobName = NULL;
+    sigset_t blocked, previous;
+    if (background) {
+        jobName = jobNameAlloc();
+        snprintf(jobName, JOB_NAME_SIZE, "%s", command);
+        for (size_t end = strlen(jobName); end > 0 && (jobName[end - 1] == ' ' || jobName[end - 1] == '\t'); end--)
+            jobName[end - 1] = '\0';
+        sigemptyset(&blocked);
+        sigaddset(&blocked, SIGCHLD);
+        sigprocmask(SIG_BLOCK, &blocked, &previous);
+    }
+    int processGroup = 0;
+
+    tokenizeInput(pipedCommands, command, "|", &numPipes);
+
+    pid_t stagePids[100];
+    const char *stageNames[100];
+    traceLaunch stageLaunches[100];
+    int numStarted = 0;
+    // Read end of the pipe feeding the next stage
+    int previousOutput = -1;
+
+    for (int i = 0; i  < numPipes; i++) {
+        int lenOfEachPipeCommand = 0;
+        char *stageWords[10000];
+        tokenizeInput(stageWords, pipedCommands[i], " \t", &lenOfEachPipeCommand);
+        redirectionList stageRedirections;
+        if (parseRedirections(&lenOfEachPipeCommand, stageWords, &stageRedirections) < 0)
+            lenOfEachPipeCommand = 0;
+        char **singlePipeCommand = expandGlobs(&lenOfEachPipeCommand, stageWords);
+        // Every stage can carry its own taskset/nice/chrt prefix
+        launchAttributes stageAttributes;
+        if (parseLaunchPrefixes(&lenOfEachPipeCommand, singlePipeCommand, &stageAttributes) < 0)
+            lenOfEachPipeCommand = 0;
+
+        /* The pipe to the next stage is close-on-exec, so only the two stages it connects keep an
+        end of it once they have moved it onto stdin/stdout. */
+        int stagePipe[2] = { -1, -1 };
+        if (i < numPipes - 1 && pipe2(stagePipe, O_CLOEXEC) < 0) {
+            perror("Pipe ");
+            break;
+        }
+
+        /* When tracing, the output of the last stage is relayed through the shell so the time of
+        its first write can be recorded. */
+        traceLaunch *launch = &stageLaunches[numStarted];
+        if (traceEnabled)
+            traceBeforeFork(launch, i == numPipes - 1 && !background);
+        fflush(stdout);
+        int pid_fork = fork();
+        if(pid_fork == 0) {
+            if (traceEnabled)
+                traceInChild(launch);
+            if (background) {
+                sigprocmask(SIG_SETMASK, &previous, NULL);
+                setpgid(0, processGroup);
+            }
+            if (previousOutput >= 0)
+                dup2(previousOutput, STDIN_FILENO);
+            if (stagePipe[1] >= 0)
+                dup2(stagePipe[1], STDOUT_FILENO);
+            // Redirections come after the pipe, so `2>&1 |` sends stderr down the pipe
+            if (lenOfEachPipeCommand == 0)
+                _exit(EXIT_FAILURE);
+            launchChild(lenOfEachPipeCommand, singlePipeCommand, &stageAttributes, &stageRedirections, 0);
+            fprintf(stderr, "%s: %s\n", singlePipeCommand[0], strerror(errno));
+            _exit(127);
+        }
+
+        if (previousOutput >= 0)
+            close(previousOutput);
+        if (stagePipe[1] >= 0)
+            close(stagePipe[1]);
+        previousOutput = stagePipe[0];
+        if (pid_fork < 0) {
+            perror("Fork ");
+            break;
+        }
+        /* The group is set from both sides of the fork, so it is in place whichever runs first. */
+        if (background) {
+            if (processGroup == 0)
+                processGroup = pid_fork;
+            setpgid(pid_fork, processGroup);
+        }
+        stageNames[numStarted] = lenOfEachPipeCommand > 0 ? singlePipeCommand[0] : "";
+        stagePids[numStarted++] = pid_fork;
+        if (traceEnabled)
+            traceAfterFork(launch, pid_fork, stageNames[numStarted - 1]);
+    }
+    if (previousOutput >= 0)
+        close(previousOutput);
+
+    if (background) {
+        if (numStarted == 0) {
+            jobNameFree(jobName);
+        } else {
+            job *started = addJob(processGroup, numStarted, jobName);
+            if (traceEnabled)
+                started->TraceStart = stageLaunches[0].execStart;
+            fprintf(stderr, "Background job started: [%d] %d %s \n", started->Index + 1, started->pid, started->Name);
+        }
+        sigprocmask(SIG_SETMASK, &previous, NULL);
+        return;
+    }
+
+    if (traceEnabled && numStarted > 0)
+        traceRelayOutput(&stageLaunches[numStarted - 1], stagePids[numStarted - 1], stageNames[numStarted - 1]);
+
+    /* Waiting for every stage; the exit status of the pipeline is the one of its last stage. */
+    for (int i = 0; i < numStarted; i++) {
+        int status = 0;
+        while (waitpid(stagePids[i], &status, WUNTRACED) < 0 && errno == EINTR)
+            ;
+        if (traceEnabled)
+            traceSpan("run", stageNames[i], stagePids[i], stageLaunches[i].execStart, traceNow());
+        if (i == numStarted - 1) {
+            if (WIFEXITED(status))
+                lastExitStatus = WEXITSTATUS(status);
+            else if (WIFSIGNALED(status))
+                lastExitStatus = 128 + WTERMSIG(status);
+        }
+    }
+    return;
+}
+
+/**
+ * The function `customComparator` compares the names of two job objects.
+ * 
+ * @param p A pointer to the first element to be compared.
+ * @param q The parameter `q` is a pointer to a constant void type.
+ * 
+ * @return the result of the `strcmp` function, which is an integer representing the comparison result
+ * of the two strings.
+ */
+int customComparator(const void *p, const void *q){
+    return strcmp(((job*)p)->Name, ((job*)q)->Name);
+}
+
+/**
+ * The function handles the execution of a foreground child process.
+ * 
+ * @param argumentCount The parameter `argumentCount` represents the number of arguments passed to the
+ * function, including the name of the command itself.
+ * @param commandArgument An array of strings representing the command and its arguments. The last
+ * element of the array should be NULL to indicate the end of the arguments.
+ * @param attributes The CPU affinity and scheduling settings applied before exec.
+ * @param redirections The fd redirections of the command, applied here in the child.
+ */
+int handleForegroundChild(int argumentCount, char *commandArgument[], const launchAttributes *attributes,
+                          const redirectionList *redirections) {
+    commandArgument[argumentCount] = NULL;
+    int execvpResult = launchChild(argumentCount, commandArgument, attributes, redirections, 1);
+
+    if(execvpResult < 0){
+        printf("Invalid command!\n");
+        exit(EXIT_FAILURE);
+    }
+    exit(EXIT_SUCCESS);
+}
+
+/**
+ * Handle the parent process in the foreground
+ * 
+ * @param pid The parameter `pid` is the process ID of the foreground parent process.
+ * @param commandArgument commandArgument is an array of strings that represents the command and its
+ * arguments. The first element (commandArgument[0]) is the command itself, and the following elements
+ * (commandArgument[1], commandArgument[2], etc.) are the arguments for the command.
+ * @param argumentCount The parameter `argumentCount` represents the number of arguments passed to the
+ * `handleForegroundParent` function.
+ */
+void handleForegroundParent(int pid, char *commandArgument[], int argumentCount) {
+    char foregroundCommand[SIZE];
+    strcpy(foregroundCommand, "");
+    strcat(foregroundCommand, commandArgument[0]);
+
+    foregroundJob.pid = pid;
+    foregroundJob.Name = arenaStrdup(&commandArena, commandArgument[0]);
+    foregroundJob.Index = 0;
+
+    int status = 0;
+    if (waitpid(pid, &status, WUNTRACED) < 0)
+        printf("Invalid command");
+
+    foregroundJob.pid = -1;
+    if (WIFEXITED(status))
+        lastExitStatus = WEXITSTATUS(status);
+    else if (WIFSIGNALED(status))
+        lastExitStatus = 128 + WTERMSIG(status);
+
+    tcsetpgrp(STDIN_FILENO, getpgid(0));
+
+    signal(SIGTTIN, SIG_DFL);
+    signal(SIGTTOU, SIG_DFL);
+
+    /* Checking if a process has been stopped using the WIFSTOPPED macro. If the process
+    has been stopped. */
+    if(WIFSTOPPED(status)){   
+        /* The stopped job becomes a long-lived job record, so its name comes from the job slab. */
+        char *name = jobNameAlloc();
+        buildJobName(name, JOB_NAME_SIZE, argumentCount, commandArgument);
+        addJob(pid, 1, name);
+        foregroundStopped = 1;
+
+        FPID[numForegroundProcesses] = pid;
+        numForegroundProcesses++;
+
+        printf("Process %s with process ID [%d] suspended\n", foregroundCommand, (int)pid );
+        return;
+    } else{
+        /* Checking if the variable "status" is equal to 1. If it is, then it prints a message
+        indicating that a process with the name "foregroundCommand" and process ID "pid" has
+        exited. */
+        if (status == 1)
+            printf("Process %s with process ID [%d] exited \n", foregroundCommand, (int)pid );
+    }
+}
+
+/**
+ * The function executes a foreground process by forking a child process and handling the child and
+ * parent processes accordingly.
+ * 
+ * @param argumentCount The parameter `argumentCount` represents the number of arguments passed to the
+ * function. It is of type `int` and is used to determine the number of command line arguments passed
+ * to the program.
+ * @param commandArgument The `commandArgument` parameter is an array of strings that represents the
+ * command and its arguments. Each element in the array is a separate argument passed to the command.
+ * @param attributes The CPU affinity and scheduling settings of the command.
+ * @param redirections The fd redirections of the command.
+ */
+void executeForegroundProcess(int argumentCount, char *commandArgument[], const launchAttributes *attributes,
+                              const redirectionList *redirections) {
+    signal(SIGTTIN, SIG_IGN);
+    signal(SIGTTOU, SIG_IGN);
+
+    traceLaunch launch;
+    if (traceEnabled)
+        traceBeforeFork(&launch, 1);
+
+    fflush(stdout);
+    int pid = fork();
+
+    /* Checking if the process ID (pid) is equal to 0. If it is, it calls the function
+    handleForegroundChild with the arguments argumentCount and commandArgument. If the pid is not
+    equal to 0, it calls the function handleForegroundParent with the arguments pid, commandArgument,
+    and argumentCount. The foregroundJob.Name lives in the command arena and needs no free. */
+    if (pid == 0) {
+        if (traceEnabled)
+            traceInChild(&launch);
+        handleForegroundChild(argumentCount, commandArgument, attributes, redirections);
+    } else {
+        if (traceEnabled) {
+            traceAfterFork(&launch, pid, commandArgument[0]);
+            traceRelayOutput(&launch, pid, commandArgument[0]);
+        }
+        handleForegroundParent(pid, commandArgument, argumentCount);
+        if (traceEnabled)
+            traceSpan("run", commandArgument[0], pid, launch.execStart, traceNow());
+    }
+}
+
+/*
  * The function handleSIGCHLD is used to handle the SIGCHLD signal, which is sent when a child process
- * terminates, and updates the status of the terminated process in a Jobs array.
+ * terminates, and updates the status of the terminated process in a Jobs array. Only the jobs in the
+ * Jobs array are reaped here; foreground children are waited for by the code that launched them, so
+ * their exit status is never stolen by the handler.
  */
 void handleSIGCHLD() {
-    pid_t pid;
-    pid = waitpid(-1, NULL, WNOHANG);
-    /* Checking if the value of `pid` is less than 0. If it is, the code returns. If not, it iterates
-    through an array of `Jobs` and checks if the `pid` matches the `pid` of any job in the array. If a
-    match is found and the `Status` of the job is not -1, the `Status` is set to -1 and a message is
-    printed indicating that the job has been completed. */
-    if (pid < 0) {
-        return;
-    } else {
-        for(int i = 0; i < JobsNum; i++){
-            if((int)pid == Jobs[i].pid) {
-                if (Jobs[i].Status != -1) {
-                    Jobs[i].Status = -1;
-                    printf("Completed: [%d]   %d   %s \n",  JobsNum , Jobs[i].pid, Jobs[i].Name);
-                    break;
-                }
+    // The interrupted code may be about to look at errno
+    int savedErrno = errno;
+    /* Iterating through the `Jobs` array and polling every job that has not completed yet. If the
+    job has exited, its `Status` is set to -1 and a message is printed indicating that the job has
+    been completed. */
+    for(int i = 0; i < JobsNum; i++){
+        if (Jobs[i].Status == -1)
+            continue;
+        /* Every process of the job is in its process group, so a background pipeline is reaped stage
+        by stage and reported once its last process is gone. */
+        int reaped, status;
+        while (Jobs[i].Stages > 0 && (reaped = waitpid(-Jobs[i].pid, &status, WNOHANG)) != 0) {
+            if (reaped < 0) {
+                if (errno == EINTR)
+                    continue;
+                Jobs[i].Stages = 0;
+            } else {
+                Jobs[i].Stages--;
+                if (reaped == Jobs[i].pid)
+                    Jobs[i].ExitStatus = WIFSIGNALED(status) ? 128 + WTERMSIG(status) : WEXITSTATUS(status);
             }
         }
+        if (Jobs[i].Stages == 0) {
+            Jobs[i].Status = -1;
+            if (traceEnabled)
+                traceSpan("run", Jobs[i].Name, Jobs[i].pid, Jobs[i].TraceStart, traceNow());
+            if (!Jobs[i].Quiet)
+                printf("Completed: [%d]   %d   %s \n",  Jobs[i].Index + 1, Jobs[i].pid, Jobs[i].Name);
+        }
+    }
+    // Reaping the process substitutions that belonged to background jobs
+    for (int i = 0; i < detachedSubstitutionCount; ) {
+        if (waitpid(detachedSubstitutionPids[i], NULL, WNOHANG) != 0)
+            detachedSubstitutionPids[i] = detachedSubstitutionPids[--detachedSubstitutionCount];
+        else
+            i++;
     }
+    errno = savedErrno;
     return;
 }
 
@@ -487,50 +2796,258 @@ void handleSIGCHLD() {
  * @param arguments The `arguments` parameter is an array of strings, where each string represents a
  * command-line argument. The `argumentCount` parameter is an integer that specifies the number of
  * arguments in the `arguments` array.
+ * @param attributes The CPU affinity and scheduling settings of the command.
+ * @param redirections The fd redirections of the command, applied in the child.
  */
-void executeBackgroundProcess(int argumentCount, char *arguments[]) {
+void executeBackgroundProcess(int argumentCount, char *arguments[], const launchAttributes *attributes,
+                              const redirectionList *redirections) {
+    traceLaunch launch;
+    if (traceEnabled)
+        traceBeforeFork(&launch, 0);
+
+    sigset_t blocked, previous;
+    sigemptyset(&blocked);
+    sigaddset(&blocked, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &blocked, &previous);
+
+    fflush(stdout);
     int pid = fork();
 
     /* Checking if the process ID (pid) is equal to 0. If it is, it sets the process group ID to the 
     current process ID using the setpgrp() function. */
     if(pid == 0) {
+        if (traceEnabled)
+            traceInChild(&launch);
+        sigprocmask(SIG_SETMASK, &previous, NULL);
         setpgrp();
         arguments[argumentCount - 1] = NULL; 
-        execvp(arguments[0], arguments); 
+        launchChild(argumentCount - 1, arguments, attributes, redirections, 0);
         exit(EXIT_SUCCESS);
     } else {
-        /* Calculating the total length of the strings in the `arguments` array and storing it in the
-        variable `len`. It then assigns the process ID (`pid`) to the `pid` field of the 'Jobs[JobsNum]'
-        struct. */
-        int len = strlen(arguments[0]);
-        for (int i = 1; i < argumentCount - 1; i++) {
-            len += strlen(arguments[i]);
-        }
-        
-        /* Assigning a value to the "pid" member of the "Jobs" array at index "JobsNum". It is also 
-        allocating memory for the "Name" member of the "Jobs" array at index "JobsNum" and copying the 
-        string value from the "arguments" array at index 0 into the "Name" member. */
-        Jobs[JobsNum].pid = pid;
-        Jobs[JobsNum].Name = malloc(len * sizeof(char) + 2);
-        strcpy(Jobs[JobsNum].Name, arguments[0]);
-
-        /* Concatenating multiple strings together. It starts by initializing a for loop that iterates 
-        from 1  to `argumentCount - 1`. Inside the loop, it uses the `strcat` function to concatenate the 
-        string `" "` and the string `arguments[i]` to the `Jobs[JobsNum].Name` string. This process is 
-        repeated for each iteration of the loop, effectively appending each `arguments[i]` string to the
-        `Jobs[JobsNum].Name` string. */
-        for (int i = 1; i < argumentCount - 1; i++) {
-            strcat(Jobs[JobsNum].Name, " ");
-            strcat(Jobs[JobsNum].Name, arguments[i]);
-        }
-        /* Setting the status of a job to 1, assigning an index to the job, incrementing the number of 
-        jobs, and printing a message indicating that a background job has started. */
-        Jobs[JobsNum].Status = 1;
-        Jobs[JobsNum].Index = JobsNum;
-        JobsNum++;
-        fprintf(stderr, "Background job started: [%d] %d %s \n",JobsNum, Jobs[JobsNum - 1].pid, Jobs[JobsNum - 1].Name);
+        /* Recording the job under its pid, which is also its process group. The name of the job is
+        taken from the job slab and built from the words of the command (without the trailing "&")
+        in a single pass. The job only becomes visible to the SIGCHLD handler in `addJob`, so
+        SIGCHLD stays blocked until then. */
+        setpgid(pid, pid);
+        char *name = jobNameAlloc();
+        buildJobName(name, JOB_NAME_SIZE, argumentCount - 1, arguments);
+        if (traceEnabled)
+            traceAfterFork(&launch, pid, arguments[0]);
+        job *started = addJob(pid, 1, name);
+        if (traceEnabled)
+            started->TraceStart = launch.execStart;
+        sigprocmask(SIG_SETMASK, &previous, NULL);
+        fprintf(stderr, "Background job started: [%d] %d %s \n", started->Index + 1, started->pid, started->Name);
+        return;
+    }
+}
+
+/**
+ * The function `killCommand` sends a signal to a process or to a whole job. It takes the signal
+ * number first, as in `kill 9 1234`; without it SIGTERM is sent. A target written as `%n` names job
+ * n of the `jobs` listing, and the signal goes to its process group so every stage of a background
+ * pipeline receives it.
+ *
+ * @param argumentCount The number of words of the command.
+ * @param arguments `kill`, the optional signal number and the target.
+ */
+void killCommand(int argumentCount, char *arguments[]) {
+    if (argumentCount < 2) {
+        fprintf(stderr, "kill: usage: kill [signal] pid | %%job\n");
+        lastExitStatus = 2;
+        return;
+    }
+    int signalNumber = SIGTERM;
+    const char *target = arguments[1];
+    if (argumentCount > 2) {
+        signalNumber = atoi(arguments[1][0] == '-' ? arguments[1] + 1 : arguments[1]);
+        target = arguments[2];
+    }
+
+    pid_t pid = atoi(target);
+    if (target[0] == '%') {
+        int jobNumber = atoi(target + 1);
+        pid = 0;
+        for (int i = 0; i < JobsNum; i++) {
+            if (Jobs[i].Status != -1 && Jobs[i].Index + 1 == jobNumber)
+                pid = -Jobs[i].pid;
+        }
+        if (pid == 0) {
+            fprintf(stderr, "kill: %s: no such job\n", target);
+            lastExitStatus = 1;
+            return;
+        }
+    }
+    if (kill(pid, signalNumber) < 0) {
+        fprintf(stderr, "kill: %s: %s\n", target, strerror(errno));
+        lastExitStatus = 1;
+    }
+}
+
+/**
+ * The function `compareDurations` orders wall-clock samples for qsort.
+ *
+ * @param p A pointer to the first sample.
+ * @param q A pointer to the second sample.
+ *
+ * @return a negative, zero or positive value like strcmp.
+ */
+int compareDurations(const void *p, const void *q) {
+    long long a = *(const long long *)p, b = *(const long long *)q;
+    return (a > b) - (a < b);
+}
+
+/**
+ * The function `durationPercentile` picks a percentile from sorted samples with the nearest-rank
+ * method.
+ *
+ * @param sorted The samples in ascending order.
+ * @param count The number of samples.
+ * @param percent The percentile, from 0 to 100.
+ *
+ * @return the sample at that rank.
+ */
+long long durationPercentile(const long long *sorted, int count, int percent) {
+    int rank = (percent * count + 99) / 100;
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+// The most runs (or warmup runs) `bench` accepts; every run keeps one wall-time sample
+#define BENCH_RUN_LIMIT 1000000
+
+/**
+ * The function `benchCommand` is the `bench` builtin: `bench -n N [-w W] [--json] command...`. It runs
+ * the command W times to warm up and then N times, each time in a fresh foreground child launched
+ * like any other command, and reports the wall time (min, median, p95, p99, max), the mean user and system time
+ * and the peak resident set size collected from wait4. Redirections of the line apply to the
+ * measured command, not to the report. Interrupting or stopping a run ends the whole benchmark.
+ *
+ * @param argumentCount The number of words of the command.
+ * @param arguments `bench`, its options and the command to measure.
+ * @param attributes The CPU affinity and scheduling settings of the command.
+ * @param redirections The fd redirections of the command, applied in every child.
+ */
+void benchCommand(int argumentCount, char *arguments[], const launchAttributes *attributes,
+                  const redirectionList *redirections) {
+    int runs = 10, warmup = 0, json = 0, first = 1, invalidOption = 0;
+    for (; first < argumentCount && arguments[first][0] == '-'; first++) {
+        int *option = strcmp(arguments[first], "-n") == 0 ? &runs :
+                      strcmp(arguments[first], "-w") == 0 ? &warmup : NULL;
+        if (option != NULL && first + 1 < argumentCount) {
+            if (parseBoundedInt(arguments[++first], option == &runs, BENCH_RUN_LIMIT, option) < 0) {
+                fprintf(stderr, "bench: invalid count '%s'\n", arguments[first]);
+                invalidOption = 1;
+            }
+        } else if (strcmp(arguments[first], "--json") == 0) {
+            json = 1;
+        } else {
+            fprintf(stderr, "bench: unknown option '%s'\n", arguments[first]);
+            invalidOption = 1;
+        }
+    }
+    char **command = arguments + first;
+    int commandCount = argumentCount - first;
+    launchAttributes commandAttributes = *attributes;
+    if (commandCount > 0 && parseLaunchPrefixes(&commandCount, command, &commandAttributes) < 0)
+        commandCount = 0;
+    if (commandCount == 0 || invalidOption) {
+        fprintf(stderr, "bench: usage: bench -n runs [-w warmup] [--json] command [args...]\n");
+        lastExitStatus = 2;
+        return;
+    }
+    command[commandCount] = NULL;
+
+    long long *wall = arenaAlloc(&commandArena, runs * sizeof(long long));
+    double userTotal = 0, systemTotal = 0;
+    long peakRss = 0;
+    int failures = 0, abortStatus = 0;
+    signal(SIGTTIN, SIG_IGN);
+    signal(SIGTTOU, SIG_IGN);
+    for (int i = 0; i < warmup + runs; i++) {
+        struct timespec start, end;
+        struct rusage usage;
+        int status = 0;
+
+        fflush(stdout);
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        int pid = fork();
+        if (pid == 0) {
+            launchChild(commandCount, command, &commandAttributes, redirections, 1);
+            fprintf(stderr, "%s: %s\n", command[0], strerror(errno));
+            _exit(127);
+        }
+        if (pid < 0) {
+            perror("Fork ");
+            abortStatus = 1;
+            break;
+        }
+        while (wait4(pid, &status, WUNTRACED, &usage) < 0 && errno == EINTR)
+            ;
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        /* A stopped run would otherwise stall the benchmark, so it is killed like an interrupted one. */
+        if (WIFSTOPPED(status)) {
+            kill(-pid, SIGKILL);
+            kill(-pid, SIGCONT);
+            while (wait4(pid, &status, 0, &usage) < 0 && errno == EINTR)
+                ;
+            abortStatus = 128 + SIGTSTP;
+        } else if (WIFSIGNALED(status) && WTERMSIG(status) == SIGINT) {
+            abortStatus = 128 + SIGINT;
+        }
+        if (abortStatus != 0) {
+            fprintf(stderr, "\nbench: %s: interrupted\n", command[0]);
+            break;
+        }
+
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            failures += i >= warmup;
+        if (i < warmup)
+            continue;
+        wall[i - warmup] = (end.tv_sec - start.tv_sec) * 1000000000LL + (end.tv_nsec - start.tv_nsec);
+        userTotal += usage.ru_utime.tv_sec * 1e3 + usage.ru_utime.tv_usec / 1e3;
+        systemTotal += usage.ru_stime.tv_sec * 1e3 + usage.ru_stime.tv_usec / 1e3;
+        if (usage.ru_maxrss > peakRss)
+            peakRss = usage.ru_maxrss;
+    }
+    tcsetpgrp(STDIN_FILENO, getpgid(0));
+    signal(SIGTTIN, SIG_DFL);
+    signal(SIGTTOU, SIG_DFL);
+    if (abortStatus != 0) {
+        lastExitStatus = abortStatus;
         return;
     }
+
+    qsort(wall, runs, sizeof(long long), compareDurations);
+    double minimum = wall[0] / 1e6, median = durationPercentile(wall, runs, 50) / 1e6;
+    double p95 = durationPercentile(wall, runs, 95) / 1e6, p99 = durationPercentile(wall, runs, 99) / 1e6;
+    double maximum = wall[runs - 1] / 1e6;
+
+    if (json) {
+        size_t length = 0;
+        for (int i = 0; i < commandCount; i++)
+            length += strlen(command[i]) + 1;
+        char *commandText = arenaAlloc(&commandArena, length);
+        commandText[0] = '\0';
+        for (int i = 0, used = 0; i < commandCount; i++)
+            used += sprintf(commandText + used, i > 0 ? " %s" : "%s", command[i]);
+        printf("{\"command\": ");
+        traceWriteString(stdout, commandText);
+        printf(", \"runs\": %d, \"warmup\": %d, \"failures\": %d, "
+               "\"wall_ms\": {\"min\": %.3f, \"median\": %.3f, \"p95\": %.3f, \"p99\": %.3f, \"max\": %.3f}, "
+               "\"user_ms_mean\": %.3f, \"sys_ms_mean\": %.3f, \"max_rss_kb\": %ld}\n",
+               runs, warmup, failures, minimum, median, p95, p99, maximum,
+               userTotal / runs, systemTotal / runs, peakRss);
+    } else {
+        printf("bench: %s (%d runs, %d warmup", command[0], runs, warmup);
+        if (failures > 0)
+            printf(", %d failed", failures);
+        printf(")\n");
+        printf("  wall    min %.3f ms  median %.3f ms  p95 %.3f ms  p99 %.3f ms  max %.3f ms\n",
+               minimum, median, p95, p99, maximum);
+        printf("  cpu     user %.3f ms  sys %.3f ms (mean)\n", userTotal / runs, systemTotal / runs);
+        printf("  memory  max rss %ld KB\n", peakRss);
+    }
+    lastExitStatus = failures > 0;
 }
 
 /**
@@ -760,31 +3277,938 @@ void echo (int numArguments, char *commandArgument[]){
         printf("\n");
         return;
     }
-}    
+}    
+
+/**
+ * The function `execInPlace` replaces the shell process with a command instead of forking a child for
+ * it. It backs the `exec` builtin and the tail-exec of `-c` strings and scripts. The redirections of
+ * the command are applied to the shell's own descriptors, which the program then inherits, so a
+ * command with redirections is exec'd in place as well. The trace file is finished first because
+ * exec skips the atexit handlers.
+ *
+ * @param argumentCount The number of words of the command.
+ * @param commandArgument The command and its arguments.
+ * @param attributes The CPU affinity and scheduling settings of the command.
+ * @param redirections The fd redirections of the command. They are undone if the exec fails.
+ *
+ * @return only if the exec failed, in which case `lastExitStatus` is set to 127.
+ */
+void execInPlace(int argumentCount, char *commandArgument[], const launchAttributes *attributes,
+                 const redirectionList *redirections) {
+    int saved[MAX_SAVED_FDS][2], savedCount;
+    commandArgument[argumentCount] = NULL;
+    if (redirectInShell(redirections, saved, &savedCount) < 0) {
+        lastExitStatus = 1;
+        return;
+    }
+    if (traceEnabled) {
+        long long now = traceNow();
+        traceSpan("exec", commandArgument[0], (int)traceSessionPid, now, now);
+        finishTrace();
+        traceEnabled = 0;
+    }
+    fflush(stdout);
+    fflush(stderr);
+
+    /* The program inherits the shell's pid, so it must also get the default signal dispositions. */
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTSTP, SIG_DFL);
+    signal(SIGTTIN, SIG_DFL);
+    signal(SIGTTOU, SIG_DFL);
+    signal(SIGCHLD, SIG_DFL);
+    applyLaunchAttributes(attributes);
+    inheritSubstitutionFds(commandArgument);
+
+    execvp(commandArgument[0], commandArgument);
+    int execError = errno;
+    restoreShellRedirections(saved, savedCount);
+    fprintf(stderr, "exec: %s: %s\n", commandArgument[0], strerror(execError));
+    signal(SIGCHLD, handleSIGCHLD);
+    lastExitStatus = 127;
+}
+
+// Function bodies are run statement by statement with the same code as typed statements
+void executeStatement(char *statement, int tailPosition);
+
+/**
+ * The function `commandPosition` tells whether a word at a position is in command position, that is
+ * at the start of the text, after a separator, or after `do`.
+ *
+ * @param text The whole text.
+ * @param position The start of the word.
+ *
+ * @return 1 if the word is in command position, otherwise 0.
+ */
+int commandPosition(const char *text, const char *position) {
+    /* A separator already replaced by a terminator counts as one. */
+    const char *before = position;
+    while (before > text && (before[-1] == ' ' || before[-1] == '\t'))
+        before--;
+    if (before == text || before[-1] == '\0' || strchr(";\n{(|&", before[-1]) != NULL)
+        return 1;
+    return before - text >= 2 && strncmp(before - 2, "do", 2) == 0 &&
+           (before - 2 == text || strchr(" \t;\n", before[-3]) != NULL);
+}
+
+/**
+ * The function `loopKeywordAt` tells whether a `for` or a `done` starts at a position in command
+ * position.
+ *
+ * @param text The whole text.
+ * @param position The position inside it.
+ *
+ * @return 1 for a `for`, -1 for a `done`, otherwise 0.
+ */
+int loopKeywordAt(const char *text, const char *position) {
+    int length, delta;
+    if (strncmp(position, "for", 3) == 0) {
+        length = 3;
+        delta = 1;
+    } else if (strncmp(position, "done", 4) == 0) {
+        length = 4;
+        delta = -1;
+    } else {
+        return 0;
+    }
+    char after = position[length];
+    if (after != '\0' && after != ' ' && after != '\t' && after != ';' && after != '\n')
+        return 0;
+    return commandPosition(text, position) ? delta : 0;
+}
+
+/**
+ * The function `braceAt` tells whether a brace at a position opens or closes a group. Like other
+ * shells, only a `{` word in command position (or after the `()` of a function) opens one, so
+ * `echo {` is an ordinary command. A `}` closes a group when it is a word of its own.
+ *
+ * @param text The whole text.
+ * @param position The position of the brace.
+ *
+ * @return 1 for an opening brace, -1 for a closing one, otherwise 0.
+ */
+int braceAt(const char *text, const char *position) {
+    char after = position[1];
+    if (after != '\0' && after != ' ' && after != '\t' && after != '\n' && after != ';' &&
+        (*position == '{' || strchr(")|&", after) == NULL))
+        return 0;
+    if (*position == '{') {
+        const char *before = position;
+        while (before > text && (before[-1] == ' ' || before[-1] == '\t'))
+            before--;
+        return commandPosition(text, position) || (before > text && before[-1] == ')');
+    }
+    if (*position == '}')
+        return position == text || strchr(" \t;\n{", position[-1]) != NULL || position[-1] == '\0' ? -1 : 0;
+    return 0;
+}
+
+/**
+ * The function `splitStatements` splits a line into its statements at every `;` that is not inside
+ * braces, parentheses or a `for` loop, so a function body, a process substitution or a loop stays in
+ * one piece. A `#` at the start of a word ends the line. Blank statements are dropped.
+ *
+ * @param line The line; the separators are replaced with string terminators.
+ * @param statements Receives the statements.
+ * @param maxStatements The capacity of `statements`.
+ *
+ * @return the number of statements.
+ */
+int splitStatements(char *line, char *statements[], int maxStatements) {
+    int count = 0, depth = 0;
+    char *start = line;
+    for (char *position = line; ; position++) {
+        char c = *position;
+        if (c == '(')
+            depth++;
+        else if (c == ')' && depth > 0)
+            depth--;
+        else if (c == '{' || (c == '}' && depth > 0))
+            depth += braceAt(line, position);
+        else if (c == '#' && depth == 0 && (position == line || position[-1] == ' ' || position[-1] == '\t'))
+            c = *position = '\0';
+        else if (c == 'f' || (c == 'd' && depth > 0))
+            depth += loopKeywordAt(line, position);
+
+        if (c == '\0' || (c == ';' && depth == 0)) {
+            *position = '\0';
+            if (start[strspn(start, " \t")] != '\0' && count < maxStatements)
+                statements[count++] = start;
+            if (c == '\0')
+                break;
+            start = position + 1;
+        }
+    }
+    return count;
+}
+
+/**
+ * The function `blockDepth` counts the brace groups and `for` loops a text leaves open, which tells whether
+ * a function definition or a loop continues on the next line.
+ *
+ * @param text The text.
+ *
+ * @return the number of `{` and `for` without a matching `}` or `done`.
+ */
+int blockDepth(const char *text) {
+    int depth = 0;
+    for (const char *position = text; *position != '\0'; position++) {
+        if (*position == '{' || (*position == '}' && depth > 0))
+            depth += braceAt(text, position);
+        else if (*position == 'f' || (*position == 'd' && depth > 0))
+            depth += loopKeywordAt(text, position);
+    }
+    return depth;
+}
+
+/**
+ * The function `expandAliasRound` replaces the aliases in command position, the first word of the
+ * statement and of every pipeline stage, once. It is run twice per round: first without an output
+ * buffer to measure the result, then to write it.
+ *
+ * @param statement The statement.
+ * @param out The buffer receiving the result, or NULL to only measure it.
+ * @param usedNames The aliases expanded in earlier rounds, which are not expanded again.
+ * @param usedCount The number of entries of `usedNames`.
+ * @param roundNames Receives the aliases expanded in this round.
+ * @param roundCount Receives the number of aliases expanded in this round.
+ *
+ * @return the length of the result.
+ */
+size_t expandAliasRound(const char *statement, char *out, const char *usedNames[], int usedCount,
+                        const char *roundNames[], int *roundCount) {
+    size_t used = 0;
+    int depth = 0;
+    *roundCount = 0;
+
+    for (const char *position = statement; ; ) {
+        const char *word = position + strspn(position, " \t");
+        size_t wordLength = strcspn(word, " \t|;&<>()");
+        nameEntry *alias = NULL;
+        char name[256];
+        if (wordLength > 0 && wordLength < sizeof(name)) {
+            memcpy(name, word, wordLength);
+            name[wordLength] = '\0';
+            alias = lookupName(&aliasTable, name);
+            for (int i = 0; alias != NULL && i < usedCount; i++) {
+                if (usedNames[i] == alias->name)
+                    alias = NULL;
+            }
+        }
+        if (alias != NULL) {
+            size_t valueLength = strlen(alias->value);
+            if (out != NULL) {
+                memcpy(out + used, position, word - position);
+                memcpy(out + used + (word - position), alias->value, valueLength);
+            }
+            used += (word - position) + valueLength;
+            if (*roundCount < 16)
+                roundNames[(*roundCount)++] = alias->name;
+            position = word + wordLength;
+        }
+
+        /* Copying the rest of the stage, up to the `|` that starts the next one. */
+        const char *stageEnd = position;
+        while (*stageEnd != '\0' && !(*stageEnd == '|' && depth == 0)) {
+            if (*stageEnd == '(')
+                depth++;
+            else if (*stageEnd == ')' && depth > 0)
+                depth--;
+            stageEnd++;
+        }
+        if (*stageEnd == '|')
+            stageEnd++;
+        if (out != NULL)
+            memcpy(out + used, position, stageEnd - position);
+        used += stageEnd - position;
+        position = stageEnd;
+        if (*position == '\0')
+            break;
+    }
+    if (out != NULL)
+        out[used] = '\0';
+    return used;
+}
+
+/**
+ * The function `expandAliases` replaces the aliases of a statement. The result is checked again, so
+ * an alias can refer to another one, but an alias is not expanded again once it has been used, which
+ * keeps `alias ls=ls -F` from looping.
+ *
+ * @param statement The statement.
+ *
+ * @return the statement itself if it has no aliases, otherwise a rewritten copy in the arena.
+ */
+char *expandAliases(char *statement) {
+    const char *usedNames[64];
+    int usedCount = 0;
+
+    for (int round = 0; round < 16; round++) {
+        const char *roundNames[16];
+        int roundCount;
+        size_t length = expandAliasRound(statement, NULL, usedNames, usedCount, roundNames, &roundCount);
+        if (roundCount == 0)
+            break;
+        char *expanded = arenaAlloc(&commandArena, length + 1);
+        expandAliasRound(statement, expanded, usedNames, usedCount, roundNames, &roundCount);
+        for (int i = 0; i < roundCount && usedCount < 64; i++)
+            usedNames[usedCount++] = roundNames[i];
+        statement = expanded;
+    }
+    return statement;
+}
+
+/**
+ * The function `defineFunction` stores a function definition, `name() { statement; ... }`. The
+ * body is kept as text: it is split into its statements once, here, and a call runs each of them
+ * through `executeStatement`, so aliases, parameters and wildcards are expanded on every call, with
+ * the values of that moment, exactly as for a typed statement.
+ *
+ * @param statement The statement.
+ *
+ * @return 1 if the statement was a function definition (even a malformed one, which is reported),
+ * otherwise 0.
+ */
+int defineFunction(const char *statement) {
+    const char *position = statement + strspn(statement, " \t");
+    const char *nameStart = position;
+    if (!isalpha((unsigned char)*position) && *position != '_')
+        return 0;
+    while (isalnum((unsigned char)*position) || *position == '_' || *position == '-')
+        position++;
+    int nameLength = position - nameStart;
+    position += strspn(position, " \t");
+    if (position[0] != '(' || position[1] != ')')
+        return 0;
+    position += 2;
+    position += strspn(position, " \t");
+
+    const char *bodyEnd = NULL;
+    if (*position == '{') {
+        int depth = 0;
+        for (const char *scan = position; *scan != '\0'; scan++) {
+            if (*scan == '{' || *scan == '}')
+                depth += braceAt(statement, scan);
+            if (*scan == '}' && depth == 0) {
+                bodyEnd = scan;
+                break;
+            }
+        }
+    }
+    if (bodyEnd == NULL || bodyEnd[1 + strspn(bodyEnd + 1, " \t")] != '\0' || nameLength >= SIZE) {
+        fprintf(stderr, "quash: syntax error in definition of %.*s()\n", nameLength, nameStart);
+        lastExitStatus = 2;
+        return 1;
+    }
+
+    char name[SIZE];
+    memcpy(name, nameStart, nameLength);
+    name[nameLength] = '\0';
+    size_t bodyLength = bodyEnd - (position + 1);
+    char *body = malloc(bodyLength + 1);
+    char *parts[SIZE];
+    memcpy(body, position + 1, bodyLength);
+    body[bodyLength] = '\0';
+    int count = splitStatements(body, parts, SIZE);
+
+    nameEntry *function = defineName(&functionTable, name);
+    function->value = body;
+    function->statements = malloc((count > 0 ? count : 1) * sizeof(char *));
+    memcpy(function->statements, parts, count * sizeof(char *));
+    function->statementCount = count;
+    return 1;
+}
+
+/**
+ * The function `appendText` copies text to an expansion buffer, or only counts it when measuring.
+ *
+ * @param out The buffer, or NULL when measuring.
+ * @param used The length written so far.
+ * @param text The text to append.
+ *
+ * @return the new length.
+ */
+size_t appendText(char *out, size_t used, const char *text) {
+    size_t length = strlen(text);
+    if (out != NULL)
+        memcpy(out + used, text, length);
+    return used + length;
+}
+
+/**
+ * The function `lookupVariable` finds the loop variable named by the text after a `$`, written as
+ * `name` or `{name}`.
+ *
+ * @param text The text after the `$`.
+ * @param length Receives the length of the reference.
+ *
+ * @return the variable, or NULL if the text does not name one.
+ */
+nameEntry *lookupVariable(const char *text, size_t *length) {
+    int braced = *text == '{';
+    const char *start = text + braced;
+    size_t nameLength = 0;
+    char name[256];
+    if (!isalpha((unsigned char)*start) && *start != '_')
+        return NULL;
+    while (isalnum((unsigned char)start[nameLength]) || start[nameLength] == '_')
+        nameLength++;
+    if (nameLength >= sizeof(name) || (braced && start[nameLength] != '}'))
+        return NULL;
+    memcpy(name, start, nameLength);
+    name[nameLength] = '\0';
+    *length = nameLength + 2 * braced;
+    return lookupName(&variableTable, name);
+}
+
+/**
+ * The function `expandParametersInto` writes a statement with $0..$9, $#, $@, $*, $? and the loop
+ * variables replaced. Any other `$` is kept, so `echo $HOME` still reaches the echo builtin unchanged.
+ *
+ * @param statement The statement.
+ * @param out The buffer receiving the result, or NULL to only measure it.
+ *
+ * @return the length of the result.
+ */
+size_t expandParametersInto(const char *statement, char *out) {
+    size_t used = 0;
+    char number[16];
+    for (const char *position = statement; *position != '\0'; position++) {
+        char next = position[1];
+        nameEntry *variable;
+        size_t referenceLength;
+        if (*position == '$' && (variable = lookupVariable(position + 1, &referenceLength)) != NULL) {
+            used = appendText(out, used, variable->value);
+            position += referenceLength;
+            continue;
+        }
+        if (*position != '$' || !(isdigit((unsigned char)next) || next == '#' || next == '@' || next == '*' || next == '?')) {
+            if (out != NULL)
+                out[used] = *position;
+            used++;
+            continue;
+        }
+        position++;
+        if (next == '0') {
+            used = appendText(out, used, positional.name);
+        } else if (isdigit((unsigned char)next)) {
+            if (next - '1' < positional.count)
+                used = appendText(out, used, positional.values[next - '1']);
+        } else if (next == '#' || next == '?') {
+            snprintf(number, sizeof(number), "%d", next == '#' ? positional.count : lastExitStatus);
+            used = appendText(out, used, number);
+        } else {
+            for (int i = 0; i < positional.count; i++) {
+                if (i > 0)
+                    used = appendText(out, used, " ");
+                used = appendText(out, used, positional.values[i]);
+            }
+        }
+    }
+    if (out != NULL)
+        out[used] = '\0';
+    return used;
+}
+
+/**
+ * The function `expandParameters` replaces the positional and special parameters of a statement.
+ *
+ * @param statement The statement.
+ *
+ * @return the statement itself if it has no parameters, otherwise a rewritten copy in the arena.
+ */
+char *expandParameters(char *statement) {
+    if (strchr(statement, '$') == NULL)
+        return statement;
+    char *expanded = arenaAlloc(&commandArena, expandParametersInto(statement, NULL) + 1);
+    expandParametersInto(statement, expanded);
+    return expanded;
+}
+
+/**
+ * The function `setPositionalParameters` sets $0 and the parameters of a script or `-c` string.
+ *
+ * @param name The value of $0.
+ * @param count The number of parameters.
+ * @param values The parameters.
+ */
+void setPositionalParameters(const char *name, int count, char *values[]) {
+    positional.name = name;
+    positional.count = 0;
+    for (int i = 0; i < count && positional.count < MAX_POSITIONAL; i++)
+        positional.values[positional.count++] = values[i];
+}
+
+/**
+ * The function `copyStatements` copies statements into one scratch buffer, which holds the array of
+ * copies followed by their text. The buffer is only reallocated when it is too small.
+ *
+ * @param statements The statements.
+ * @param count The number of statements.
+ * @param scratch The buffer, or NULL.
+ * @param capacity The size of the buffer.
+ *
+ * @return the copies.
+ */
+char **copyStatements(char *statements[], int count, char **scratch, size_t *capacity) {
+    size_t size = (count > 0 ? count : 1) * sizeof(char *);
+    for (int i = 0; i < count; i++)
+        size += strlen(statements[i]) + 1;
+    if (size > *capacity) {
+        char *grown = realloc(*scratch, size);
+        if (grown == NULL) {
+            perror("realloc ");
+            exit(EXIT_FAILURE);
+        }
+        *scratch = grown;
+        *capacity = size;
+    }
+    char **copies = (char **)*scratch;
+    char *text = *scratch + (count > 0 ? count : 1) * sizeof(char *);
+    for (int i = 0; i < count; i++) {
+        size_t length = strlen(statements[i]) + 1;
+        copies[i] = memcpy(text, statements[i], length);
+        text += length;
+    }
+    return copies;
+}
+
+/**
+ * The function `callFunction` runs a shell function in the shell process. The words after the name
+ * become $1, $2, ... for the duration of the call, and every statement of the body goes through
+ * `executeStatement` like a typed one. The statements are copied to the scratch buffer of the
+ * nesting level first because running them modifies the text, and a statement may even redefine the
+ * function. The buffer is kept for the next call at the same level, so once the shell has warmed up
+ * a call runs without malloc, and a function called from a long loop does not grow the command arena.
+ *
+ * @param argumentCount The number of words of the call.
+ * @param words The function name and its arguments.
+ */
+void callFunction(int argumentCount, char *words[]) {
+    nameEntry *function = lookupName(&functionTable, words[0]);
+    if (functionDepth == FUNCTION_DEPTH_LIMIT || statementDepth == STATEMENT_DEPTH_LIMIT) {
+        fprintf(stderr, "quash: %s: maximum function nesting level exceeded\n", words[0]);
+        lastExitStatus = 1;
+        return;
+    }
+
+    int count = function->statementCount;
+    scratchBuffer *scratch = &statementScratch[statementDepth++];
+    char **statements = copyStatements(function->statements, count, &scratch->text, &scratch->capacity);
+
+    positionalParameters saved = positional;
+    positional.count = 0;
+    for (int i = 1; i < argumentCount && positional.count < MAX_POSITIONAL; i++)
+        positional.values[positional.count++] = words[i];
+
+    functionDepth++;
+    lastExitStatus = 0;
+    for (int i = 0; i < count; i++)
+        executeStatement(statements[i], 0);
+    functionDepth--;
+    statementDepth--;
+    positional = saved;
+}
+
+/**
+ * The function `setVariable` sets a variable. The buffer of the old value is reused when the new one
+ * fits, so a loop that sets its variable on every iteration does not call malloc.
+ *
+ * @param name The variable.
+ * @param value Its new value.
+ */
+void setVariable(const char *name, const char *value) {
+    size_t length = strlen(value) + 1;
+    nameEntry *variable = lookupName(&variableTable, name);
+    if (variable == NULL || length > variable->valueCapacity) {
+        variable = defineName(&variableTable, name);
+        variable->value = malloc(length);
+        if (variable->value == NULL) {
+            perror("malloc ");
+            exit(EXIT_FAILURE);
+        }
+        variable->valueCapacity = length;
+    }
+    memcpy(variable->value, value, length);
+}
+
+/**
+ * The function `runLoopBody` runs the body of a `for` loop once, with the loop variable set. The
+ * statements are copied first because running them modifies the text. Every iteration reuses the
+ * scratch buffer of the loop's nesting level for the copies, so a loop neither calls malloc nor
+ * grows the command arena once the shell has warmed up.
+ *
+ * @param name The loop variable.
+ * @param value Its value for this iteration.
+ * @param statements The statements of the body.
+ * @param count The number of statements.
+ * @param forked 1 in the forked copy of a parallel iteration, whose last command may replace it.
+ * @param scratch The scratch buffer of the loop.
+ */
+void runLoopBody(const char *name, const char *value, char *statements[], int count, int forked,
+                 scratchBuffer *scratch) {
+    setVariable(name, value);
+    char **copies = copyStatements(statements, count, &scratch->text, &scratch->capacity);
+    for (int i = 0; i < count; i++)
+        executeStatement(copies[i], forked && i == count - 1);
+}
+
+/**
+ * The function `runForLoop` runs `for [-j N] name in words...; do statements; done`. The words get
+ * parameter and wildcard expansion, and the body runs once per word with $name set to it.
+ * Without `-j` the iterations run in the shell one after the other, and the loop leaves the status
+ * of the last statement. With `-j N` each iteration is a forked copy of the shell recorded as a job,
+ * at most N at a time (`-j 0` means one per online CPU). The loop waits for every iteration, and its
+ * status is that of the first failed iteration in word order. An N that is missing, negative or not
+ * a number is a usage error, with status 2.
+ *
+ * @param statement The statement.
+ *
+ * @return 1 if the statement was a `for` loop (even a malformed one, which is reported), otherwise 0.
+ */
+int runForLoop(char *statement) {
+    char *position = statement + strspn(statement, " \t");
+    if (strncmp(position, "for", 3) != 0 || (position[3] != ' ' && position[3] != '\t'))
+        return 0;
+
+    /* The header ends at the first `;`; the body lies between the `do` after it and the last `done`. */
+    char *headerEnd = strchr(position, ';');
+    char *body = headerEnd != NULL ? headerEnd + strspn(headerEnd, " \t;") : NULL;
+    char *end = position + strlen(position);
+    while (end > position && (end[-1] == ' ' || end[-1] == '\t'))
+        end--;
+    int wellFormed = body != NULL && strncmp(body, "do", 2) == 0 && body[2] != '\0' &&
+                     strchr(" \t;", body[2]) != NULL && end - body >= 7 &&
+                     strncmp(end - 4, "done", 4) == 0 && strchr(" \t;", end[-5]) != NULL;
+
+    char *words[SIZE];
+    int count = 0, first = 1, slots = 0;
+    if (wellFormed) {
+        *headerEnd = '\0';
+        end[-4] = '\0';
+        tokenizeInput(words, expandParameters(position), " \t", &count);
+        if (count > 1 && strcmp(words[1], "-j") == 0) {
+            if (count < 3 || parseBoundedInt(words[2], 0, INT_MAX, &slots) < 0) {
+                if (count >= 3)
+                    fprintf(stderr, "for: invalid job count '%s'\n", words[2]);
+                fprintf(stderr, "for: usage: for [-j N] name in words...; do statements; done\n");
+                lastExitStatus = 2;
+                return 1;
+            }
+            if (slots == 0)
+                slots = (int)sysconf(_SC_NPROCESSORS_ONLN);
+            if (slots > SIZE / 2)
+                slots = SIZE / 2;
+            first = 3;
+        }
+        wellFormed = count >= first + 2 && strcmp(words[first + 1], "in") == 0 &&
+                     (isalpha((unsigned char)words[first][0]) || words[first][0] == '_');
+    }
+    if (!wellFormed) {
+        fprintf(stderr, "quash: syntax error in for loop\n");
+        lastExitStatus = 2;
+        return 1;
+    }
+    if (statementDepth == STATEMENT_DEPTH_LIMIT) {
+        fprintf(stderr, "quash: for: maximum nesting level exceeded\n");
+        lastExitStatus = 1;
+        return 1;
+    }
+
+    char *name = words[first];
+    int valueCount = count - first - 2;
+    char **values = expandGlobs(&valueCount, words + first + 2);
+    char *statements[SIZE];
+    int statementCount = splitStatements(body + 2, statements, SIZE);
+
+    lastExitStatus = 0;
+    if (slots == 0) {
+        scratchBuffer *scratch = &statementScratch[statementDepth++];
+        for (int i = 0; i < valueCount; i++)
+            runLoopBody(name, values[i], statements, statementCount, 0, scratch);
+        statementDepth--;
+        return 1;
+    }
+
+    /* Each job slot holds the pid and the word index of one running iteration. SIGCHLD stays blocked
+    except while waiting, so an iteration cannot end unnoticed between the check and the wait. */
+    int *slotPids = arenaAlloc(&commandArena, slots * sizeof(int));
+    int *slotIterations = arenaAlloc(&commandArena, slots * sizeof(int));
+    int running = 0, next = 0, failures = 0, firstFailure = valueCount, failedStatus = 0;
+    sigset_t blocked, previous;
+    sigemptyset(&blocked);
+    sigaddset(&blocked, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &blocked, &previous);
+
+    while (next < valueCount || running > 0) {
+        if (next < valueCount && running < slots) {
+            fflush(stdout);
+            int pid = fork();
+            if (pid == 0) {
+                sigprocmask(SIG_SETMASK, &previous, NULL);
+                setpgrp();
+                JobsNum = 0;
+                traceEnabled = 0;
+                runLoopBody(name, values[next], statements, statementCount, 1, &statementScratch[statementDepth++]);
+                fflush(stdout);
+                _exit(lastExitStatus);
+            }
+            if (pid < 0) {
+                perror("Fork ");
+                failures++;
+                if (next < firstFailure) {
+                    firstFailure = next;
+                    failedStatus = 1;
+                }
+                next++;
+                continue;
+            }
+            /* Also set here, so the handler never waits on a group the child has not formed yet. */
+            setpgid(pid, pid);
+            char *jobName = jobNameAlloc();
+            snprintf(jobName, JOB_NAME_SIZE, "for %s in %s", name, values[next]);
+            addJob(pid, 1, jobName)->Quiet = 1;
+            slotPids[running] = pid;
+            slotIterations[running++] = next++;
+            continue;
+        }
+
+        sigsuspend(&previous);
+        /* Collecting the finished iterations before `addJob` reclaims their records. */
+        for (int i = 0; i < running; ) {
+            job *finished = NULL;
+            for (int j = 0; j < JobsNum && finished == NULL; j++) {
+                if (Jobs[j].pid == slotPids[i] && Jobs[j].Quiet && Jobs[j].Status == -1)
+                    finished = &Jobs[j];
+            }
+            if (finished == NULL) {
+                i++;
+                continue;
+            }
+            if (finished->ExitStatus != 0) {
+                failures++;
+                if (slotIterations[i] < firstFailure) {
+                    firstFailure = slotIterations[i];
+                    failedStatus = finished->ExitStatus;
+                }
+            }
+            finished->Quiet = 0;
+            running--;
+            slotPids[i] = slotPids[running];
+            slotIterations[i] = slotIterations[running];
+        }
+    }
+    sigprocmask(SIG_SETMASK, &previous, NULL);
+
+    if (failures > 0)
+        fprintf(stderr, "for: %d of %d iterations failed\n", failures, valueCount);
+    lastExitStatus = failedStatus;
+    return 1;
+}
+
+/**
+ * The function `aliasCommand` is the `alias` builtin. Without arguments it lists every alias;
+ * `alias name` shows one, and `alias name=text...` defines one. Since quash has no quoting, the
+ * words after `=` are joined with spaces and a pair of surrounding quotes is removed.
+ *
+ * @param argumentCount The number of words of the command.
+ * @param arguments `alias` and its arguments.
+ */
+void aliasCommand(int argumentCount, char *arguments[]) {
+    if (argumentCount == 1) {
+        for (int i = 0; i < NAME_TABLE_SIZE; i++) {
+            for (nameEntry *entry = aliasTable.buckets[i]; entry != NULL; entry = entry->next)
+                printf("alias %s='%s'\n", entry->name, entry->value);
+        }
+        return;
+    }
+
+    char *equals = strchr(arguments[1], '=');
+    if (equals == NULL) {
+        for (int i = 1; i < argumentCount; i++) {
+            nameEntry *entry = lookupName(&aliasTable, arguments[i]);
+            if (entry != NULL) {
+                printf("alias %s='%s'\n", entry->name, entry->value);
+            } else {
+                fprintf(stderr, "alias: %s: not found\n", arguments[i]);
+                lastExitStatus = 1;
+            }
+        }
+        return;
+    }
+
+    *equals = '\0';
+    char value[SIZE];
+    size_t used = 0;
+    value[0] = '\0';
+    for (int i = 1; i < argumentCount; i++) {
+        const char *part = i == 1 ? equals + 1 : arguments[i];
+        used += snprintf(value + used, sizeof(value) - used, "%s%s", i > 1 ? " " : "", part);
+        if (used >= sizeof(value))
+            used = sizeof(value) - 1;
+    }
+    if (used >= 2 && (value[0] == '\'' || value[0] == '"') && value[used - 1] == value[0]) {
+        value[used - 1] = '\0';
+        memmove(value, value + 1, used - 1);
+    }
+    nameEntry *alias = defineName(&aliasTable, arguments[1]);
+    alias->value = strdup(value);
+}
 
 /**
- * The function `cmdHandler` handles different commands entered by the user, including background
- * processes, piping, redirection, built-in commands (cd, pwd, echo, jobs, ls, exit, quit, export,
- * kill), and executing foreground processes.
- * 
- * @return void, so it is not returning any value.
+ * The function `unaliasCommand` is the `unalias` builtin, which removes aliases.
+ *
+ * @param argumentCount The number of words of the command.
+ * @param arguments `unalias` and the names to remove.
  */
-void cmdHandler() {   
-    int numCommands = 0;
-    tokenizeInput(commandList, inputBuffer, "\n", &numCommands);
+void unaliasCommand(int argumentCount, char *arguments[]) {
+    for (int i = 1; i < argumentCount; i++) {
+        if (!removeName(&aliasTable, arguments[i])) {
+            fprintf(stderr, "unalias: %s: not found\n", arguments[i]);
+            lastExitStatus = 1;
+        }
+    }
+}
 
-    for (int i = 0; i < numCommands; i++) {
-        char tempStr[10000];
-        strcpy(tempStr, commandList[i]);
-        int argumentCount = 0;
-        tokenizeInput(arguments, commandList[i], " \t", &argumentCount);
+/**
+ * The function `isBuiltinLs` tells whether an `ls` command is one of the forms handled by the `ls`
+ * builtin (no argument, `-a` or `-l`). Any other `ls` runs as an ordinary command.
+ *
+ * @param argumentCount The number of words of the command.
+ * @param words The command and its arguments.
+ *
+ * @return 1 if the `ls` builtin handles the command, otherwise 0.
+ */
+int isBuiltinLs(int argumentCount, char *words[]) {
+    if (strcmp(words[0], "ls") != 0)
+        return 0;
+    int fileStatus = argumentCount;
+    if (strchr(words[argumentCount - 1], '#'))
+        fileStatus--;
+    return fileStatus == 1 || (fileStatus == 2 && (strcmp(words[1], "-a") == 0 || strcmp(words[1], "-l") == 0));
+}
+
+/**
+ * The function `isBuiltinCommand` tells whether a command (a builtin or a shell function) runs inside
+ * the shell. It
+ * decides whether redirections are applied to the shell around the call or in a child. `exec`
+ * and `bench` handle their own redirections and are not listed.
+ *
+ * @param argumentCount The number of words of the command.
+ * @param words The command and its arguments.
+ *
+ * @return 1 for a builtin, otherwise 0.
+ */
+int isBuiltinCommand(int argumentCount, char *words[]) {
+    static const char *builtins[] = { "cd", "pwd", "echo", "jobs", "exit", "quit", "export", "kill",
+                                      "alias", "unalias" };
+    if (lookupName(&functionTable, words[0]) != NULL)
+        return 1;
+    for (size_t i = 0; i < sizeof(builtins) / sizeof(builtins[0]); i++) {
+        if (strcmp(words[0], builtins[i]) == 0)
+            return 1;
+    }
+    return isBuiltinLs(argumentCount, words) || strchr(words[0], '#') != NULL;
+}
+
+/**
+ * The function `executeStatement` runs one statement: a simple command, a pipeline or a function
+ * definition, optionally in the background. It handles background processes, piping, redirection,
+ * function calls, built-in commands (cd, pwd, echo, jobs, ls, exit, quit, export, kill, alias) and
+ * executing foreground processes. Function bodies are run through it as well.
+ *
+ * @param statement The text of the statement. It is modified in place.
+ * @param tailPosition 1 if this is the last statement of a `-c` string or script, which may replace
+ * the shell instead of forking when it is a simple external command, with or without redirections.
+ */
+void executeStatement(char *statement, int tailPosition) {
+    char tempStr[10000];
+    char *arguments[SIZE];
+    long long commandStart = traceEnabled ? traceNow() : 0;
+
+    /* A loop is taken apart before any expansion, since its body is expanded anew for every word. */
+    if (runForLoop(statement))
+        return;
+
+    /* Aliases are replaced first, then a function definition is stored without running anything. */
+    statement = expandAliases(statement);
+    if (defineFunction(statement))
+        return;
+
+    // Filling in $1..$9, $#, $@, $* and $? before the statement is split into words
+    statement = expandParameters(statement);
+
+    // Starting the commands of `<(cmd)` and `>(cmd)` first and naming their pipes in the line
+    char *line = expandProcessSubstitutions(statement);
+    if (line == NULL) {
+        finishProcessSubstitutions(1);
+        lastExitStatus = 1;
+        return;
+    }
+    strcpy(tempStr, line);
+    int argumentCount = 0;
+    tokenizeInput(arguments, line, " \t", &argumentCount);
+    if (argumentCount == 0) {
+        finishProcessSubstitutions(1);
+        return;
+    }
+    // `piping` tokenizes tempStr in place, so the command span keeps its own copy of the line
+    char traceCommand[64];
+    if (traceEnabled) {
+        snprintf(traceCommand, sizeof(traceCommand), "%.63s", tempStr);
+        traceSpan("tokenize", traceCommand, (int)traceSessionPid, commandStart, traceNow());
+    }
+
+    // Builtins succeed unless they say otherwise; launched commands report their own status
+    lastExitStatus = 0;
+
+    /* Stripping taskset/nice/chrt prefixes from a simple command. A pipeline is left untouched here
+    because `piping` parses the prefixes of every stage on its own. A prefix without a command acts
+    as a builtin and changes the defaults for every later launch. */
+    char **words = arguments;
+    launchAttributes commandAttributes;
+    memset(&commandAttributes, 0, sizeof(commandAttributes));
+    redirectionList commandRedirections;
+    commandRedirections.count = 0;
+    if (argumentCount > 0 && checkForPipes(words, argumentCount) == 0) {
+        /* Redirections are taken out of the command first, wherever they were written. They are
+        applied in the child of an external command and around the call of a builtin. */
+        if (parseRedirections(&argumentCount, words, &commandRedirections) < 0) {
+            lastExitStatus = 2;
+            return;
+        }
+        if (parseLaunchPrefixes(&argumentCount, words, &commandAttributes) < 0) {
+            lastExitStatus = 2;
+            return;
+        }
+        if (argumentCount == 0) {
+            // A line of only redirections creates (or checks) the files, like in other shells
+            int saved[MAX_SAVED_FDS][2], savedCount;
+            if (redirectInShell(&commandRedirections, saved, &savedCount) < 0)
+                lastExitStatus = 1;
+            else
+                restoreShellRedirections(saved, savedCount);
+            setSessionAttributes(&commandAttributes);
+            return;
+        }
+        // Expanding wildcards in the words of the command (pipelines expand per stage)
+        words = expandGlobs(&argumentCount, words);
+    }
 
     /* Checking if the last argument in the "arguments" array is "&" using the strcmp function. If 
     it is "&", it calls the executeBackgroundProcess function with the argumentCount and arguments as 
     parameters. This suggests that the code is checking if the user wants to execute the process in 
     the background. */
-    if(strcmp(arguments[argumentCount - 1],"&") == 0){
-	    executeBackgroundProcess(argumentCount, arguments);
+    int background = strcmp(words[argumentCount - 1], "&") == 0;
+    /* Pipelines are checked first, so a trailing "&" puts the whole pipeline in the background
+    instead of being handed to the first stage. */
+    if(checkForPipes(words, argumentCount) == 1){ 
+        if (background)
+            *strrchr(tempStr, '&') = '\0';
+        piping(tempStr, argumentCount, background);
+    }
+    else if(background){
+	    executeBackgroundProcess(argumentCount, words, &commandAttributes, &commandRedirections);
+            finishProcessSubstitutions(0);
             return; 
     }
     /**
@@ -793,92 +4217,177 @@ void cmdHandler() {
      * 
      * @param  - `arguments`: an array of strings, where each string represents a command-line argument
      */
-    else if(checkForPipes(arguments, argumentCount) == 1){ 
-        piping(tempStr, argumentCount);
-    } else {
-        // Check redirection
-        if (checkRedirection(argumentCount, arguments) == 1) {
-            redirectionHandler(argumentCount, arguments);
-        } else {
+    else {
+        /* A builtin runs in the shell, so its redirections are applied to the shell's own
+        descriptors and undone right after it returns. */
+        int saved[MAX_SAVED_FDS][2], savedCount = 0;
+        if (commandRedirections.count > 0 && isBuiltinCommand(argumentCount, words)) {
+            if (redirectInShell(&commandRedirections, saved, &savedCount) < 0) {
+                lastExitStatus = 1;
+                return;
+            }
+        }
+        {
 		    // If the list is empty then simply return
-            if (argumentCount == 0 || arguments[0] == NULL){
+            if (argumentCount == 0 || words[0] == NULL){
                 return;
             }
 
+            // Shell functions come before builtins and commands of the same name
+            else if (lookupName(&functionTable, words[0]) != NULL) {
+                callFunction(argumentCount, words);
+            }
+
+            // Check for alias and unalias
+            else if (strcmp(words[0], "alias") == 0) {
+                aliasCommand(argumentCount, words);
+            }
+            else if (strcmp(words[0], "unalias") == 0) {
+                unaliasCommand(argumentCount, words);
+            }
+
+            // Check for bench, whose redirections belong to the measured command
+            else if (strcmp(words[0], "bench") == 0) {
+                benchCommand(argumentCount, words, &commandAttributes, &commandRedirections);
+            }
+
             // Check for cd.
-            else if(strcmp(arguments[0], "cd") == 0) {
-                cd(argumentCount, arguments[1]);
+            else if(strcmp(words[0], "cd") == 0) {
+                cd(argumentCount, words[1]);
             }
 
             // Check for pwd
-            else if(strcmp(arguments[0], "pwd") == 0) {
+            else if(strcmp(words[0], "pwd") == 0) {
                 char myPwd[SIZE];
                 if(getcwd(myPwd, SIZE) == NULL) {
                     perror("");
                     exit(0);
                 }
                 printf("%s\n", myPwd);
-                return;
             }
 
             // Check for echo
-            else if(strcmp(arguments[0], "echo") == 0) {
-                echo (argumentCount, arguments);
+            else if(strcmp(words[0], "echo") == 0) {
+                echo (argumentCount, words);
                 printf("\n");
             }
 
 		     // Check for jobs
-            else if(strcmp(arguments[0], "jobs") == 0) {
-                jobs(argumentCount, arguments);
+            else if(strcmp(words[0], "jobs") == 0) {
+                jobs(argumentCount, words);
             }
 
             // Check for ls
-            else if(strcmp(arguments[0], "ls") == 0) {
+            else if(isBuiltinLs(argumentCount, words)) {
                 int fileStatus = argumentCount;
-                if (strchr(arguments[argumentCount - 1], '#'))
+                if (strchr(words[argumentCount - 1], '#'))
                     fileStatus--;
-                ls(fileStatus, arguments[1]);
+                ls(fileStatus, words[1]);
             }
 
             // Check for exit
-            else if(strcmp(arguments[0], "exit") == 0) {
-                exit(0);
+            else if(strcmp(words[0], "exit") == 0) {
+                exit(argumentCount > 1 ? atoi(words[1]) : 0);
+            }
+
+            // Check for exec, which runs the command in place of the shell
+            else if(strcmp(words[0], "exec") == 0) {
+                if (argumentCount > 1)
+                    execInPlace(argumentCount - 1, words + 1, &commandAttributes, &commandRedirections);
+                // Without a command the redirections stay in effect for the rest of the session
+                else if (applyRedirections(&commandRedirections) < 0)
+                    lastExitStatus = 1;
             }
 		
             // Check for quit
-            else if (strcmp(arguments[0], "quit") == 0){
+            else if (strcmp(words[0], "quit") == 0){
                 exit(0);
             }
 		  
             // Check for export 
-            else if(strcmp(arguments[0], "export") == 0) {
-                export(arguments[1]);
+            else if(strcmp(words[0], "export") == 0) {
+                export(words[1]);
             }
             // Check for comments 
-            else if( (strcmp(arguments[0], "#") == 0) || (strchr(arguments[0], '#'))) {
-                return;
+            else if( (strcmp(words[0], "#") == 0) || (strchr(words[0], '#'))) {
             }
             // Check for kill 
-            else if(strcmp(arguments[0], "kill") == 0) {
-                kill(atoi(arguments[2]), atoi(arguments[1]));
-                return;
+            else if(strcmp(words[0], "kill") == 0) {
+                killCommand(argumentCount, words);
+            }
+            /* In `-c` and script mode the final simple command does not need a shell to come back
+            to, so it is exec'd directly instead of paying for a fork and a waiting parent. Pipelines
+            and background commands never get here; redirections are fine, execInPlace() applies them
+            before the exec. A server worker stays for the next command of its session. */
+            else if (tailPosition && !serverWorker) {
+                execInPlace(argumentCount, words, &commandAttributes, &commandRedirections);
             } else {
-                executeForegroundProcess(argumentCount, arguments);
+                executeForegroundProcess(argumentCount, words, &commandAttributes, &commandRedirections);
             }
         }
+        if (savedCount > 0)
+            restoreShellRedirections(saved, savedCount);
     }
-        // check if any child process terminated
-        signal(SIGCHLD, handleSIGCHLD);
+    /* The substitutions of a stopped command stay with its job, like those of a background job:
+    their writers may never finish while it is stopped, so the shell must not wait for them. */
+    finishProcessSubstitutions(!background && !foregroundStopped);
+    foregroundStopped = 0;
+    if (traceEnabled)
+        traceSpan("command", traceCommand, (int)traceSessionPid, commandStart, traceNow());
+    // check if any child process terminated
+    signal(SIGCHLD, handleSIGCHLD);
+}
+
+/**
+ * The function `cmdHandler` handles the commands entered by the user. The input is split into lines
+ * and every line into its `;`-separated statements, which are run in order by `executeStatement`.
+ * 
+ * @return void, so it is not returning any value.
+ */
+void cmdHandler() {   
+    int numCommands = 0;
+    tokenizeInput(commandList, inputBuffer, "\n", &numCommands);
+
+    for (int i = 0; i < numCommands; i++) {
+        char *statements[SIZE];
+        int numStatements = splitStatements(commandList[i], statements, SIZE);
+        for (int j = 0; j < numStatements; j++)
+            executeStatement(statements[j], tailExecAllowed && i == numCommands - 1 && j == numStatements - 1);
     }
     return;
 }
 
+/*
+ * The function finishCommandLine releases everything the command line allocated (the input buffer,
+ * glob expansions and directory listings, the foreground job name) in one step.
+ */
+void finishCommandLine() {
+    // Substitutions of a line that stopped early (for example on a syntax error) are reaped here
+    finishProcessSubstitutions(1);
+    clearGlobCache();
+    arenaReset(&commandArena);
+}
+
 /*
 The function reads input from the user and clears the terminal screen if the input is "clear".
 */
 void getinputBuffer(){
-    inputBuffer = (char *)malloc(SIZE);
-    fgets(inputBuffer, SIZE, stdin);
+    inputBuffer = arenaAlloc(&commandArena, SIZE);
+    if (fgets(inputBuffer, SIZE, stdin) == NULL)
+        exit(lastExitStatus);  // end of input
+
+    /* A function definition with an open brace or a loop without its `done` continues on the next lines. */
+    size_t used = strlen(inputBuffer);
+    while (blockDepth(inputBuffer) > 0 && used + 1 < SIZE) {
+        if (used > 0 && inputBuffer[used - 1] == '\n')
+            inputBuffer[used - 1] = ';';
+        printf("> ");
+        fflush(stdout);
+        if (fgets(inputBuffer + used, SIZE - used, stdin) == NULL)
+            break;
+        used += strlen(inputBuffer + used);
+    }
+
     if (strcmp(inputBuffer, "clear") == 0) {
         printf("\033[H\033[J");  // clears the current screen in the terminal
     }
@@ -895,20 +4404,723 @@ void print(){
 }
 
 
+/**
+ * The function `runScript` runs a `-c` string or the contents of a script file line by line, without
+ * prompting. Tail-exec is only allowed for the last line that holds a command.
+ *
+ * @param text The commands to run, separated by newlines. The text is modified in place.
+ *
+ * @return the exit status of the last command.
+ */
+int runScript(char *text) {
+    /* A function definition or a loop may span several lines; its lines are joined with `;` separators. */
+    int depth = 0;
+    for (char *position = text; *position != '\0'; position++) {
+        if (*position == '{' || (*position == '}' && depth > 0))
+            depth += braceAt(text, position);
+        else if (*position == 'f' || (*position == 'd' && depth > 0))
+            depth += loopKeywordAt(text, position);
+        else if (*position == '\n' && depth > 0)
+            *position = ';';
+    }
+
+    /* Finding the last line that is not blank, so only that line may replace the shell. */
+    char *lastLine = NULL;
+    for (char *line = text; line != NULL && *line != '\0'; ) {
+        char *end = strchr(line, '\n');
+        char first = line[strspn(line, " \t")];
+        if (first != '\n' && first != '\0')
+            lastLine = line;
+        line = end != NULL ? end + 1 : NULL;
+    }
+
+    char *line = text;
+    while (line != NULL && *line != '\0') {
+        char *end = strchr(line, '\n');
+        if (end != NULL)
+            *end = '\0';
+        signal(SIGCHLD, handleSIGCHLD);
+        tailExecAllowed = (line == lastLine);
+        inputBuffer = line;
+        cmdHandler();
+        finishCommandLine();
+        line = end != NULL ? end + 1 : NULL;
+    }
+    tailExecAllowed = 0;
+    return lastExitStatus;
+}
+
+/**
+ * The function `readScript` reads a whole script file into memory.
+ *
+ * @param fileName The path of the script.
+ *
+ * @return the contents of the file, or NULL if it cannot be read.
+ */
+char *readScript(const char *fileName) {
+    FILE *script = fopen(fileName, "r");
+    if (script == NULL)
+        return NULL;
+    size_t used = 0, size = 4096;
+    char *text = malloc(size);
+    size_t bytes;
+    while ((bytes = fread(text + used, 1, size - used - 1, script)) > 0) {
+        used += bytes;
+        if (size - used - 1 == 0) {
+            size *= 2;
+            text = realloc(text, size);
+        }
+    }
+    text[used] = '\0';
+    fclose(script);
+    return text;
+}
+
+/**
+ * The function `putBigEndian32` stores a 32-bit value most significant byte first, as frame lengths
+ * and exit statuses travel in the `--serve` protocol.
+ *
+ * @param bytes The four bytes to fill in.
+ * @param value The value.
+ */
+void putBigEndian32(char *bytes, uint32_t value) {
+    for (int i = 0; i < 4; i++)
+        bytes[i] = (char)(value >> (24 - 8 * i));
+}
+
+/**
+ * The function `getBigEndian32` reads a value stored by `putBigEndian32`.
+ *
+ * @param bytes The four bytes.
+ *
+ * @return the value.
+ */
+uint32_t getBigEndian32(const char *bytes) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++)
+        value = (value << 8) | (unsigned char)bytes[i];
+    return value;
+}
+
+/**
+ * The function `putFrameHeader` writes the header of a `--serve` protocol frame.
+ *
+ * @param header The five bytes to fill in.
+ * @param type The frame type.
+ * @param length The length of the payload.
+ */
+void putFrameHeader(char *header, char type, uint32_t length) {
+    header[0] = type;
+    putBigEndian32(header + 1, length);
+}
+
+/**
+ * The function `flushServerClient` sends as much of the client's pending frame as the socket takes
+ * without blocking.
+ *
+ * @param client The connection.
+ *
+ * @return 0 on success (even if bytes are left over), -1 if the connection is broken.
+ */
+int flushServerClient(serverClient *client) {
+    while (client->pendingStart < client->pendingEnd) {
+        ssize_t sent = send(client->socket, client->pending + client->pendingStart,
+                            client->pendingEnd - client->pendingStart, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (sent < 0) {
+            if (errno == EINTR)
+                continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+        }
+        client->pendingStart += sent;
+    }
+    client->pendingStart = client->pendingEnd = 0;
+    return 0;
+}
+
+/**
+ * The function `serverMilliseconds` reads the monotonic clock the server times hung-up workers with.
+ *
+ * @return the time in milliseconds.
+ */
+long long serverMilliseconds() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+/**
+ * The function `closeServerClient` drops a connection. Its worker is hung up: it gets SIGHUP and
+ * passes it on to the command it runs and to its jobs, as a shell does when its terminal goes away.
+ * The server never waits for the worker here; the slot stays taken until `reapServerWorker` has
+ * collected it.
+ *
+ * @param client The connection.
+ */
+void closeServerClient(serverClient *client) {
+    for (int i = 0; i < 2; i++) {
+        if (client->output[i] >= 0)
+            close(client->output[i]);
+        client->output[i] = -1;
+    }
+    if (client->commands >= 0)
+        close(client->commands);
+    if (client->statuses >= 0)
+        close(client->statuses);
+    client->commands = client->statuses = -1;
+    if (client->pid > 0) {
+        kill(-client->pid, SIGHUP);
+        client->hangupDeadline = serverMilliseconds() + SERVER_HANGUP_GRACE_MS;
+    }
+    close(client->socket);
+    client->socket = -1;
+    client->requestLength = client->requestSent = client->pendingStart = client->pendingEnd = 0;
+    client->running = client->exitReady = client->closing = 0;
+}
+
+/**
+ * The function `reapServerWorker` collects the worker of a closed connection without blocking. A
+ * worker still running when its grace period is over is killed with its process group.
+ *
+ * @param client The closed connection.
+ */
+void reapServerWorker(serverClient *client) {
+    if (waitpid(client->pid, NULL, WNOHANG) != 0) {
+        client->pid = 0;
+        return;
+    }
+    if (client->hangupDeadline != 0 && serverMilliseconds() >= client->hangupDeadline) {
+        kill(-client->pid, SIGKILL);
+        client->hangupDeadline = 0;
+    }
+}
+
+/**
+ * The function `handleServerHangup` runs in a worker whose client went away. Jobs run in process
+ * groups of their own, so the worker passes the SIGHUP on to them. The foreground command shares the
+ * worker's group and got the signal with it; the worker waits for it to end before it dies itself, so
+ * a command that ignores the hangup is still killed with the group once the grace period is over.
+ *
+ * @param signalNumber The signal, SIGHUP.
+ */
+void handleServerHangup(int signalNumber) {
+    for (int i = 0; i < JobsNum; i++) {
+        if (Jobs[i].Status != -1)
+            kill(-Jobs[i].pid, signalNumber);
+    }
+    if (foregroundJob.pid > 0)
+        waitpid(foregroundJob.pid, NULL, 0);
+    signal(signalNumber, SIG_DFL);
+    raise(signalNumber);
+}
+
+/**
+ * The function `readFully` reads exactly `size` bytes unless the stream ends first.
+ *
+ * @param fd The descriptor to read from.
+ * @param buffer Where the bytes go.
+ * @param size The number of bytes wanted.
+ *
+ * @return 0 on success, -1 on end of file or an error.
+ */
+int readFully(int fd, char *buffer, size_t size) {
+    while (size > 0) {
+        ssize_t bytes = read(fd, buffer, size);
+        if (bytes < 0 && errno == EINTR)
+            continue;
+        if (bytes <= 0)
+            return -1;
+        buffer += bytes;
+        size -= bytes;
+    }
+    return 0;
+}
+
+/**
+ * The function `runServerSession` is the worker of a `--serve` connection. It reads the commands of
+ * the session from the server one at a time and runs each through the same path as a `-c` string,
+ * so what a command leaves behind, such as the directory or an alias, carries over to the next one.
+ * After each command its output is flushed before its status is reported, so by the time the server
+ * reads the status all the output of the command is in the pipes.
+ *
+ * @param commands The pipe the server writes the command frames to, already checked by the server.
+ * @param statuses The pipe the status of each command goes to.
+ */
+void runServerSession(int commands, int statuses) {
+    static char command[SERVER_REQUEST_LIMIT + 1];
+    char header[FRAME_HEADER_SIZE], status[4];
+    while (readFully(commands, header, sizeof(header)) == 0) {
+        uint32_t length = getBigEndian32(header + 1);
+        if (readFully(commands, command, length) < 0)
+            break;
+        command[length] = '\0';
+        putBigEndian32(status, runScript(command));
+        fflush(NULL);
+        if (teeWriteAll(statuses, status, sizeof(status)) < 0)
+            break;
+    }
+    _exit(lastExitStatus);
+}
+
+/**
+ * The function `startServerSession` forks the worker of a new connection. The worker is the resident
+ * shell itself, so a session costs one fork and no new process image, and its commands cost no fork
+ * of their own beyond what running them takes. The worker never touches the socket: its commands come
+ * through one pipe, its stdout and stderr go out through two more, and the status of each command
+ * comes back through a fourth. The server's ends never block.
+ *
+ * @param client The free slot of the connection.
+ * @param connection The accepted socket.
+ * @param listenSocket The listening socket, closed in the worker.
+ *
+ * @return 0 on success, -1 if the worker cannot be started.
+ */
+int startServerSession(serverClient *client, int connection, int listenSocket) {
+    /* The pipes of stdout, stderr, the commands and the statuses, in that order. */
+    int pipes[4][2];
+    for (int i = 0; i < 4; i++) {
+        if (pipe2(pipes[i], O_CLOEXEC) < 0) {
+            while (i-- > 0) {
+                close(pipes[i][0]);
+                close(pipes[i][1]);
+            }
+            return -1;
+        }
+    }
+    fflush(stdout);
+    int pid = fork();
+    if (pid == 0) {
+        setpgid(0, 0);
+        signal(SIGPIPE, SIG_DFL);
+        signal(SIGHUP, handleServerHangup);
+        serverWorker = 1;
+        close(listenSocket);
+        close(connection);
+        for (int i = 0; i < SERVER_CLIENT_LIMIT; i++) {
+            int fds[] = { serverClients[i].socket, serverClients[i].output[0], serverClients[i].output[1],
+                          serverClients[i].commands, serverClients[i].statuses };
+            for (size_t j = 0; j < sizeof(fds) / sizeof(fds[0]); j++) {
+                if (fds[j] >= 0)
+                    close(fds[j]);
+            }
+        }
+        int input = open("/dev/null", O_RDONLY);
+        dup2(input, STDIN_FILENO);
+        dup2(pipes[0][1], STDOUT_FILENO);
+        dup2(pipes[1][1], STDERR_FILENO);
+        if (input > STDERR_FILENO)
+            close(input);
+        /* The worker must not hold the server's ends, or it would never see the end of its commands. */
+        close(pipes[0][0]);
+        close(pipes[0][1]);
+        close(pipes[1][0]);
+        close(pipes[1][1]);
+        close(pipes[2][1]);
+        close(pipes[3][0]);
+        runServerSession(pipes[2][0], pipes[3][1]);
+    }
+    close(pipes[0][1]);
+    close(pipes[1][1]);
+    close(pipes[2][0]);
+    close(pipes[3][1]);
+    if (pid < 0) {
+        close(pipes[0][0]);
+        close(pipes[1][0]);
+        close(pipes[2][1]);
+        close(pipes[3][0]);
+        return -1;
+    }
+    fcntl(pipes[0][0], F_SETFL, O_NONBLOCK);
+    fcntl(pipes[1][0], F_SETFL, O_NONBLOCK);
+    fcntl(pipes[2][1], F_SETFL, O_NONBLOCK);
+    fcntl(pipes[3][0], F_SETFL, O_NONBLOCK);
+
+    client->socket = connection;
+    client->pid = pid;
+    client->output[0] = pipes[0][0];
+    client->output[1] = pipes[1][0];
+    client->commands = pipes[2][1];
+    client->statuses = pipes[3][0];
+    client->hangupDeadline = 0;
+    client->requestLength = client->requestSent = client->pendingStart = client->pendingEnd = 0;
+    client->running = client->exitReady = client->closing = 0;
+    return 0;
+}
+
+/**
+ * The function `sendServerCommand` hands the first complete request of a connection to its worker.
+ * What the pipe does not take at once is written when it has room again.
+ *
+ * @param client The connection, whose previous command has finished.
+ *
+ * @return 0 on success (even if no complete request is buffered or bytes are left over), -1 on a
+ * malformed request or if the worker is gone.
+ */
+int sendServerCommand(serverClient *client) {
+    if (client->requestLength < FRAME_HEADER_SIZE)
+        return 0;
+    uint32_t length = getBigEndian32(client->request + 1);
+    if (client->request[0] != FRAME_COMMAND || length > SERVER_REQUEST_LIMIT)
+        return -1;
+    size_t size = FRAME_HEADER_SIZE + length;
+    if (client->requestLength < size)
+        return 0;
+
+    client->running = 1;
+    while (client->requestSent < size) {
+        ssize_t written = write(client->commands, client->request + client->requestSent, size - client->requestSent);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            return errno == EAGAIN ? 0 : -1;
+        }
+        client->requestSent += written;
+    }
+
+    /* Requests sent ahead stay buffered until this one has finished. */
+    client->requestLength -= size;
+    memmove(client->request, client->request + size, client->requestLength);
+    client->requestSent = 0;
+    return 0;
+}
+
+/**
+ * The function `readServerOutput` reads one chunk of the worker's stdout or stderr into an output
+ * frame, without blocking. A pipe at end of file is closed.
+ *
+ * @param client The connection, with no frame pending.
+ * @param stream 0 for stdout, 1 for stderr.
+ *
+ * @return 1 if a frame was queued, otherwise 0.
+ */
+int readServerOutput(serverClient *client, int stream) {
+    if (client->output[stream] < 0)
+        return 0;
+    ssize_t bytes;
+    while ((bytes = read(client->output[stream], client->pending + FRAME_HEADER_SIZE, SERVER_CHUNK_SIZE)) < 0 &&
+           errno == EINTR)
+        ;
+    if (bytes == 0 || (bytes < 0 && errno != EAGAIN)) {
+        close(client->output[stream]);
+        client->output[stream] = -1;
+    }
+    if (bytes <= 0)
+        return 0;
+    putFrameHeader(client->pending, stream == 0 ? FRAME_STDOUT : FRAME_STDERR, bytes);
+    client->pendingStart = 0;
+    client->pendingEnd = FRAME_HEADER_SIZE + bytes;
+    return 1;
+}
+
+/**
+ * The function `readServerStatus` reads the status the worker reported for a command. A worker that
+ * closed the pipe has ended: once it is reaped, a command it was running is reported with the status
+ * of the worker (128 plus the signal if one killed it), and the connection is marked to close.
+ *
+ * @param client The connection.
+ *
+ * @return 1 if the worker has ended but could not be reaped yet, otherwise 0.
+ */
+int readServerStatus(serverClient *client) {
+    if (client->statuses >= 0) {
+        char status[4];
+        ssize_t bytes;
+        while ((bytes = read(client->statuses, status, sizeof(status))) < 0 && errno == EINTR)
+            ;
+        if (bytes == sizeof(status)) {
+            client->exitReady = 1;
+            client->exitStatus = getBigEndian32(status);
+            return 0;
+        }
+        if (bytes < 0 && errno == EAGAIN)
+            return 0;
+        close(client->statuses);
+        client->statuses = -1;
+    }
+
+    int status = 0;
+    int reaped;
+    while ((reaped = waitpid(client->pid, &status, WNOHANG)) < 0 && errno == EINTR)
+        ;
+    if (reaped == 0)
+        return 1;
+    client->pid = 0;
+    client->closing = 1;
+    if (client->running) {
+        client->exitReady = 1;
+        client->exitStatus = WIFSIGNALED(status) ? 128 + WTERMSIG(status) : WEXITSTATUS(status);
+    }
+    return 0;
+}
+
+/**
+ * The function `serveCommands` is the `--serve` mode: a resident shell accepting command lines over a
+ * Unix domain socket. One poll loop serves every connection. Each connection is a session with a
+ * worker of its own, forked when the client connects, which runs the commands of the session one
+ * after the other; their stdout and stderr are relayed back in frames, each command followed by its
+ * exit status. A `cd` or an alias carries over to the next command of the same connection, but never
+ * to other connections. A worker that ends, for instance through `exit`, ends its connection.
+ *
+ * @param path The path of the socket. A stale socket left at that path is replaced.
+ *
+ * @return 1 if the socket cannot be set up; otherwise the loop does not return.
+ */
+int serveCommands(const char *path) {
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "quash: %s: socket path too long\n", path);
+        return 1;
+    }
+    strcpy(address.sun_path, path);
+    struct stat info;
+    if (lstat(path, &info) == 0 && S_ISSOCK(info.st_mode))
+        unlink(path);
+    int listenSocket = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listenSocket < 0 || bind(listenSocket, (struct sockaddr *)&address, sizeof(address)) < 0 ||
+        listen(listenSocket, SOMAXCONN) < 0) {
+        perror(path);
+        return 1;
+    }
+    for (int i = 0; i < SERVER_CLIENT_LIMIT; i++) {
+        serverClients[i].socket = serverClients[i].commands = serverClients[i].statuses = -1;
+        serverClients[i].output[0] = serverClients[i].output[1] = -1;
+    }
+
+    struct pollfd fds[1 + 5 * SERVER_CLIENT_LIMIT];
+    serverClient *owners[1 + 5 * SERVER_CLIENT_LIMIT];
+    while (1) {
+        /* Moving every connection forward before deciding what to wait for. Workers that have to be
+        reaped are checked on again after a short timeout, as nothing tells the poll when they end. */
+        int count = 0, timeout = -1;
+        fds[count++] = (struct pollfd){ .fd = listenSocket, .events = POLLIN };
+        for (int i = 0; i < SERVER_CLIENT_LIMIT; i++) {
+            serverClient *client = &serverClients[i];
+            if (client->socket < 0 && client->pid > 0)
+                reapServerWorker(client);
+            if (client->socket < 0) {
+                if (client->pid > 0)
+                    timeout = SERVER_REAP_INTERVAL_MS;
+                continue;
+            }
+            if (client->statuses < 0 && client->pid > 0 && readServerStatus(client))
+                timeout = SERVER_REAP_INTERVAL_MS;
+            if (client->pendingEnd > 0 && flushServerClient(client) < 0) {
+                closeServerClient(client);
+                continue;
+            }
+
+            /* The exit frame of a command goes out once the output it left in the pipes is relayed. */
+            if (client->pendingEnd == 0 && client->exitReady && !readServerOutput(client, 0) &&
+                !readServerOutput(client, 1)) {
+                putFrameHeader(client->pending, client->closing ? FRAME_CLOSE : FRAME_EXIT, 4);
+                putBigEndian32(client->pending + FRAME_HEADER_SIZE, client->exitStatus);
+                client->pendingStart = 0;
+                client->pendingEnd = FRAME_HEADER_SIZE + 4;
+                client->exitReady = client->running = 0;
+            }
+            if (client->pendingEnd > 0 && flushServerClient(client) < 0) {
+                closeServerClient(client);
+                continue;
+            }
+            if (client->closing && client->pendingEnd == 0 && !client->exitReady) {
+                closeServerClient(client);
+                continue;
+            }
+            if (!client->closing && (!client->running || client->requestSent > 0) &&
+                sendServerCommand(client) < 0) {
+                closeServerClient(client);
+                continue;
+            }
+
+            /* The socket is always watched, so a client that goes away hangs up its session. */
+            owners[count] = client;
+            if (client->pendingEnd > 0)
+                fds[count++] = (struct pollfd){ .fd = client->socket, .events = POLLOUT };
+            else
+                fds[count++] = (struct pollfd){ .fd = client->socket,
+                                                .events = client->requestLength < sizeof(client->request) - 1 ? POLLIN : 0 };
+            for (int j = 0; j < 2 && client->pendingEnd == 0; j++) {
+                if (client->output[j] >= 0) {
+                    owners[count] = client;
+                    fds[count++] = (struct pollfd){ .fd = client->output[j], .events = POLLIN };
+                }
+            }
+            if (client->statuses >= 0 && !client->exitReady) {
+                owners[count] = client;
+                fds[count++] = (struct pollfd){ .fd = client->statuses, .events = POLLIN };
+            }
+            if (client->requestSent > 0) {
+                owners[count] = client;
+                fds[count++] = (struct pollfd){ .fd = client->commands, .events = POLLOUT };
+            }
+        }
+
+        if (poll(fds, count, timeout) < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("poll");
+            return 1;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            int connection = accept4(listenSocket, NULL, NULL, SOCK_CLOEXEC);
+            int slot = 0;
+            while (slot < SERVER_CLIENT_LIMIT && (serverClients[slot].socket >= 0 || serverClients[slot].pid > 0))
+                slot++;
+            if (connection >= 0 && (slot == SERVER_CLIENT_LIMIT ||
+                                    startServerSession(&serverClients[slot], connection, listenSocket) < 0))
+                close(connection);
+        }
+
+        for (int i = 1; i < count; i++) {
+            serverClient *client = owners[i];
+            if (fds[i].revents == 0 || client->socket < 0)
+                continue;
+            if (fds[i].fd == client->socket && client->pendingEnd > 0) {
+                if (flushServerClient(client) < 0)
+                    closeServerClient(client);
+            } else if (fds[i].fd == client->socket) {
+                /* The socket stays blocking for the client's sake, so it is only read when poll says so. */
+                ssize_t received = 0;
+                if (fds[i].revents & POLLIN)
+                    received = recv(client->socket, client->request + client->requestLength,
+                                    sizeof(client->request) - 1 - client->requestLength, MSG_DONTWAIT);
+                if (received == 0 || (received < 0 && errno != EAGAIN && errno != EINTR))
+                    closeServerClient(client);
+                else if (received > 0)
+                    client->requestLength += received;
+            } else if (fds[i].fd == client->statuses) {
+                readServerStatus(client);
+            } else if (fds[i].fd == client->commands) {
+                if (sendServerCommand(client) < 0)
+                    closeServerClient(client);
+            } else if (client->pendingEnd == 0) {
+                /* One chunk per wakeup, so the frame is sent before more output is read. */
+                if (readServerOutput(client, fds[i].fd == client->output[0] ? 0 : 1) && flushServerClient(client) < 0)
+                    closeServerClient(client);
+            }
+        }
+    }
+}
+
+/**
+ * The function `clientCommand` sends one command line to a `--serve` shell and copies its output to
+ * stdout and stderr as it arrives.
+ *
+ * @param connection The connected socket.
+ * @param command The command line.
+ * @param closed Set when the command ended the session, e.g. with `exit`.
+ *
+ * @return the exit status of the command, or -1 if the connection fails.
+ */
+int clientCommand(int connection, const char *command, int *closed) {
+    char header[FRAME_HEADER_SIZE];
+    size_t length = strlen(command);
+    if (length > SERVER_REQUEST_LIMIT) {
+        fprintf(stderr, "quash: command longer than %d bytes\n", SERVER_REQUEST_LIMIT);
+        return -1;
+    }
+    putFrameHeader(header, FRAME_COMMAND, length);
+    if (teeWriteAll(connection, header, sizeof(header)) < 0 || teeWriteAll(connection, command, length) < 0)
+        return -1;
+
+    char buffer[SERVER_CHUNK_SIZE];
+    while (readFully(connection, header, sizeof(header)) == 0) {
+        uint32_t size = getBigEndian32(header + 1);
+        if (header[0] == FRAME_EXIT || header[0] == FRAME_CLOSE) {
+            char status[4];
+            if (size != 4 || readFully(connection, status, 4) < 0)
+                return -1;
+            *closed = header[0] == FRAME_CLOSE;
+            return (int)getBigEndian32(status);
+        }
+        if (size > sizeof(buffer) || readFully(connection, buffer, size) < 0)
+            return -1;
+        teeWriteAll(header[0] == FRAME_STDERR ? STDERR_FILENO : STDOUT_FILENO, buffer, size);
+    }
+    return -1;
+}
+
+/**
+ * The function `runClient` is the `--client` mode. The words after the socket path form one command;
+ * without them, every line of stdin is sent as a command over the same connection, until one of them
+ * ends the session.
+ *
+ * @param path The socket of a `--serve` shell.
+ * @param count The number of command words.
+ * @param words The command words.
+ *
+ * @return the exit status of the last command, or 255 if the server cannot be reached.
+ */
+int runClient(const char *path, int count, char *words[]) {
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+    strncpy(address.sun_path, path, sizeof(address.sun_path) - 1);
+    int connection = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (connection < 0 || connect(connection, (struct sockaddr *)&address, sizeof(address)) < 0) {
+        perror(path);
+        return 255;
+    }
+    // A server that went away shows up as a failed write, not as a signal
+    signal(SIGPIPE, SIG_IGN);
+
+    int status = 0;
+    int closed = 0;
+    if (count > 0) {
+        char command[SERVER_REQUEST_LIMIT + 1];
+        size_t used = 0;
+        for (int i = 0; i < count && used < SERVER_REQUEST_LIMIT; i++)
+            used += snprintf(command + used, sizeof(command) - used, i > 0 ? " %s" : "%s", words[i]);
+        status = clientCommand(connection, command, &closed);
+    } else {
+        char *line = NULL;
+        size_t size = 0;
+        ssize_t length;
+        while (status >= 0 && !closed && (length = getline(&line, &size, stdin)) > 0) {
+            if (line[length - 1] == '\n')
+                line[length - 1] = '\0';
+            status = clientCommand(connection, line, &closed);
+        }
+        free(line);
+    }
+    close(connection);
+    return status < 0 ? 255 : status;
+}
+
 /**
  * The main function of the Quash program, which initializes variables, sets up signal handling, gets
- * user input, and handles commands.
+ * user input, and handles commands. `quash -c 'commands'` and `quash script` run non-interactively;
+ * `quash --serve socket` and `quash --client socket [command]` run the command server and its client.
  * 
  * @return The main function is returning 0.
  */
-int main(){
+int main(int argc, char *argv[]){
+    JobsNum = 0;
+    numForegroundProcesses = 0;
+    initTrace();
+
+    /* Running a `-c` string or a script file without a prompt, then exiting with its status. */
+    if (argc >= 3 && strcmp(argv[1], "--serve") == 0) {
+        return serveCommands(argv[2]);
+    } else if (argc >= 3 && strcmp(argv[1], "--client") == 0) {
+        return runClient(argv[2], argc - 3, argv + 3);
+    } else if (argc >= 3 && strcmp(argv[1], "-c") == 0) {
+        // As in other shells, the words after the command string become $0, $1, ...
+        if (argc >= 4)
+            setPositionalParameters(argv[3], argc - 4, argv + 4);
+        return runScript(strdup(argv[2]));
+    } else if (argc >= 2) {
+        setPositionalParameters(argv[1], argc - 2, argv + 2);
+        char *script = readScript(argv[1]);
+        if (script == NULL) {
+            perror(argv[1]);
+            return 127;
+        }
+        return runScript(script);
+    }
+
 /* print the message "Welcome to Quash...." followed
 by two new lines. */
 	printf("Welcome to Quash.... \n \n"); // print "Welcome to Quash...." followed by two new lines.
 
-    JobsNum = 0;
-    numForegroundProcesses = 0;
-
     /* An infinite loop that continuously prompts the user for input and handles the input commands. It 
     sets up a signal handler for the SIGCHLD signal, which is used to handle child processes. It then 
     calls functions to get the current directory, print the prompt in red, get the input buffer, handle 
@@ -920,7 +5132,7 @@ by two new lines. */
         print();  // Calls print function to print prompt in red
         getinputBuffer();
         cmdHandler();   
-        free(inputBuffer);
+        finishCommandLine();
    }
    return(0);
 }